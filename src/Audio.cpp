@@ -0,0 +1,497 @@
+#include "Audio.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <iterator>
+
+#ifdef USE_SDL_MIXER
+#include <SDL_mixer.h>
+#endif
+
+#include "Profiler.h"
+
+namespace {
+// 同步转换的开头时长，之后由后台线程每次转换四分之一秒；开始播放前至少要解码出这么长
+constexpr int kInstantStartSeconds = 2;
+// 重采样输出可能比按比例估算多出几帧
+constexpr size_t kResampleSlackFrames = 4096;
+
+bool IsWav(const unsigned char* header, size_t size) {
+    return size >= 12 && std::memcmp(header, "RIFF", 4) == 0 && std::memcmp(header + 8, "WAVE", 4) == 0;
+}
+
+// 把DataReader包装成SDL_RWops，SDL_LoadWAV_RW与Mix_LoadWAV_RW直接从中拉取数据
+DataReader* ReaderOf(SDL_RWops* context) {
+    return static_cast<DataReader*>(context->hidden.unknown.data1);
+}
+
+Sint64 SDLCALL ReaderSize(SDL_RWops* context) {
+    return static_cast<Sint64>(ReaderOf(context)->Size());
+}
+
+Sint64 SDLCALL ReaderSeek(SDL_RWops* context, Sint64 offset, int whence) {
+    DataReader* reader = ReaderOf(context);
+    Sint64 base = 0;
+    if (whence == RW_SEEK_CUR) {
+        base = static_cast<Sint64>(reader->Tell());
+    } else if (whence == RW_SEEK_END) {
+        base = static_cast<Sint64>(reader->Size());
+    }
+    Sint64 target = base + offset;
+    if (target < 0 || !reader->Seek(static_cast<uint64_t>(target))) {
+        return SDL_SetError("Failed to seek audio source.");
+    }
+    return target;
+}
+
+size_t SDLCALL ReaderRead(SDL_RWops* context, void* ptr, size_t size, size_t maxnum) {
+    if (size == 0) {
+        return 0;
+    }
+    return ReaderOf(context)->Read(static_cast<unsigned char*>(ptr), size * maxnum) / size;
+}
+
+size_t SDLCALL ReaderWrite(SDL_RWops*, const void*, size_t, size_t) {
+    SDL_SetError("Audio source is read-only.");
+    return 0;
+}
+
+int SDLCALL ReaderClose(SDL_RWops* context) {
+    SDL_FreeRW(context);
+    return 0;
+}
+}
+
+std::shared_ptr<AudioClip> AudioClip::Decode(std::shared_ptr<const std::vector<unsigned char>> file,
+                                             const AudioFormat& format, std::string& error) {
+    PROFILE_ZONE("AudioClip::Decode");
+    if (!file || file->empty()) {
+        error = "Audio file is empty.";
+        return nullptr;
+    }
+    std::shared_ptr<AudioClip> clip(new AudioClip(format));
+    clip->memoryBytes_.store(file->size(), std::memory_order_relaxed);
+    clip->file_ = std::move(file);
+    bool wav = IsWav(clip->file_->data(), clip->file_->size());
+    return Start(std::move(clip), wav, error);
+}
+
+std::shared_ptr<AudioClip> AudioClip::Decode(std::unique_ptr<DataReader> source, const AudioFormat& format,
+                                             std::string& error) {
+    PROFILE_ZONE("AudioClip::Decode");
+    if (!source || source->Size() == 0) {
+        error = "Audio file is empty.";
+        return nullptr;
+    }
+    unsigned char header[12] = {};
+    size_t headerBytes = source->Read(header, sizeof(header));
+    if (!source->Seek(0)) {
+        error = "Failed to read audio file: " + source->GetError();
+        return nullptr;
+    }
+    std::shared_ptr<AudioClip> clip(new AudioClip(format));
+    clip->source_ = std::move(source);
+    return Start(std::move(clip), IsWav(header, headerBytes), error);
+}
+
+std::shared_ptr<AudioClip> AudioClip::Start(std::shared_ptr<AudioClip> clip, bool wav, std::string& error) {
+    if (wav) {
+        if (!clip->BeginWav(error)) {
+            return nullptr;
+        }
+        // 开头几秒在调用线程转换完，返回后即可开始播放
+        size_t initialBytes = clip->wavFrameBytes_ * static_cast<size_t>(clip->wavFreq_) * kInstantStartSeconds;
+        if (!clip->ConvertWavChunk(initialBytes)) {
+            clip->FinishWav();
+            return clip;
+        }
+    } else {
+#ifndef USE_SDL_MIXER
+        error = "Only WAV audio is supported in this build.";
+        return nullptr;
+#endif
+    }
+    AudioClip* raw = clip.get();
+    clip->decoder_ = std::thread([raw]() { raw->DecoderLoop(); });
+    return clip;
+}
+
+AudioClip::~AudioClip() {
+    Cancel();
+    if (decoder_.joinable()) {
+        decoder_.join();
+    }
+    if (stream_) {
+        SDL_FreeAudioStream(stream_);
+    }
+    if (wavBuffer_) {
+        SDL_FreeWAV(wavBuffer_);
+    }
+#ifdef USE_SDL_MIXER
+    if (chunk_) {
+        Mix_FreeChunk(chunk_);
+    }
+#endif
+}
+
+SDL_RWops* AudioClip::OpenSource() {
+    if (file_) {
+        return SDL_RWFromConstMem(file_->data(), static_cast<int>(file_->size()));
+    }
+    SDL_RWops* context = SDL_AllocRW();
+    if (!context) {
+        return nullptr;
+    }
+    context->size = &ReaderSize;
+    context->seek = &ReaderSeek;
+    context->read = &ReaderRead;
+    context->write = &ReaderWrite;
+    context->close = &ReaderClose;
+    context->type = SDL_RWOPS_UNKNOWN;
+    context->hidden.unknown.data1 = source_.get();
+    return context;
+}
+
+void AudioClip::ReleaseSource() {
+    file_.reset();
+    source_.reset();
+}
+
+bool AudioClip::SourceFailed(std::string& error) const {
+    if (!source_ || source_->GetError().empty()) {
+        return false;
+    }
+    error = source_->GetError();
+    return true;
+}
+
+bool AudioClip::BeginWav(std::string& error) {
+    // WAV整块载入后用AudioStream按块转换到设备格式；源文件数据随即不再需要
+    SDL_AudioSpec spec{};
+    if (!SDL_LoadWAV_RW(OpenSource(), 1, &spec, &wavBuffer_, &wavLength_)) {
+        if (!SourceFailed(error)) {
+            error = std::string("Failed to load WAV: ") + SDL_GetError();
+        }
+        return false;
+    }
+    // 源读取出错时SDL只看到数据提前结束，可能仍然"载入成功"
+    if (SourceFailed(error)) {
+        return false;
+    }
+    ReleaseSource();
+    wavFrameBytes_ = static_cast<size_t>(spec.channels) * (SDL_AUDIO_BITSIZE(spec.format) / 8);
+    wavFreq_ = spec.freq;
+    if (wavFrameBytes_ == 0 || wavFreq_ <= 0) {
+        error = "Unsupported WAV format.";
+        return false;
+    }
+    stream_ = SDL_NewAudioStream(spec.format, spec.channels, spec.freq, format_.format,
+                                 static_cast<Uint8>(format_.channels), format_.freq);
+    if (!stream_) {
+        error = std::string("Failed to create audio stream: ") + SDL_GetError();
+        return false;
+    }
+    size_t sourceFrames = wavLength_ / wavFrameBytes_;
+    size_t frames = sourceFrames * static_cast<size_t>(format_.freq) / static_cast<size_t>(wavFreq_) +
+                    kResampleSlackFrames;
+    capacityBytes_ = frames * format_.FrameBytes();
+    data_.reset(new Uint8[capacityBytes_]);
+    samples_.store(data_.get(), std::memory_order_release);
+    memoryBytes_.store(capacityBytes_ + wavLength_, std::memory_order_relaxed);
+    return true;
+}
+
+bool AudioClip::ConvertWavChunk(size_t sourceBytes) {
+    size_t remaining = wavLength_ - wavOffset_;
+    size_t count = std::min(sourceBytes - sourceBytes % wavFrameBytes_, remaining);
+    if (count > 0) {
+        SDL_AudioStreamPut(stream_, wavBuffer_ + wavOffset_, static_cast<int>(count));
+        wavOffset_ += static_cast<Uint32>(count);
+    }
+    DrainStream();
+    return wavOffset_ < wavLength_;
+}
+
+void AudioClip::FinishWav() {
+    SDL_AudioStreamFlush(stream_);
+    DrainStream();
+    SDL_FreeAudioStream(stream_);
+    stream_ = nullptr;
+    SDL_FreeWAV(wavBuffer_);
+    wavBuffer_ = nullptr;
+    memoryBytes_.store(capacityBytes_, std::memory_order_relaxed);
+    finished_.store(true, std::memory_order_release);
+}
+
+void AudioClip::DrainStream() {
+    // 只搬整帧；先写数据再发布帧数，回调读到的帧一定已经写完
+    size_t frameBytes = format_.FrameBytes();
+    size_t decoded = decodedFrames_.load(std::memory_order_relaxed);
+    for (;;) {
+        int available = SDL_AudioStreamAvailable(stream_);
+        size_t room = capacityBytes_ - decoded * frameBytes;
+        size_t want = std::min(static_cast<size_t>(std::max(available, 0)), room);
+        want -= want % frameBytes;
+        if (want == 0) {
+            break;
+        }
+        int got = SDL_AudioStreamGet(stream_, data_.get() + decoded * frameBytes, static_cast<int>(want));
+        if (got <= 0) {
+            break;
+        }
+        decoded += static_cast<size_t>(got) / frameBytes;
+        decodedFrames_.store(decoded, std::memory_order_release);
+    }
+}
+
+void AudioClip::DecoderLoop() {
+    PROFILE_THREAD_NAME("AudioDecoder");
+    PROFILE_ZONE("AudioClip::DecoderLoop");
+    if (stream_) {
+        size_t chunkBytes = wavFrameBytes_ * static_cast<size_t>(wavFreq_) / 4;
+        while (!cancel_.load(std::memory_order_relaxed) && ConvertWavChunk(chunkBytes)) {
+        }
+        FinishWav();
+        return;
+    }
+#ifdef USE_SDL_MIXER
+    // 混音器没有分段解码的接口，只能整首解码；输出已是Mix_OpenAudio的格式，与播放器一致。
+    // 播放器此时可能正在回调里读取，样本指针与帧数都经原子变量发布，已交出的数据不再改动
+    chunk_ = Mix_LoadWAV_RW(OpenSource(), 1);
+    std::string sourceError;
+    if (SourceFailed(sourceError)) {
+        std::printf("Failed to read audio: %s\n", sourceError.c_str());
+    } else if (chunk_) {
+        capacityBytes_ = chunk_->alen;
+        samples_.store(chunk_->abuf, std::memory_order_release);
+        decodedFrames_.store(capacityBytes_ / format_.FrameBytes(), std::memory_order_release);
+    } else {
+        std::printf("Failed to decode audio: %s\n", Mix_GetError());
+    }
+#endif
+    ReleaseSource();
+    memoryBytes_.store(capacityBytes_, std::memory_order_relaxed);
+    finished_.store(true, std::memory_order_release);
+}
+
+AudioPlayer::~AudioPlayer() {
+    Close();
+}
+
+bool AudioPlayer::Open(std::string& error) {
+#ifdef USE_SDL_MIXER
+    int freq = 0;
+    Uint16 format = 0;
+    int channels = 0;
+    if (!Mix_QuerySpec(&freq, &format, &channels)) {
+        error = std::string("Mixer is not open: ") + Mix_GetError();
+        return false;
+    }
+    format_.freq = freq;
+    format_.format = format;
+    format_.channels = channels;
+    format_.silence = 0;
+    if (format_.format != AUDIO_S16SYS) {
+        error = "Mixer output format is not S16.";
+        return false;
+    }
+    Mix_HookMusic(&AudioPlayer::Callback, this);
+    hooked_ = true;
+#else
+    SDL_AudioSpec want{};
+    want.freq = 48000;
+    want.format = AUDIO_S16SYS;
+    want.channels = 2;
+    want.samples = 1024;
+    want.callback = &AudioPlayer::Callback;
+    want.userdata = this;
+    SDL_AudioSpec have{};
+    device_ = SDL_OpenAudioDevice(nullptr, 0, &want, &have, SDL_AUDIO_ALLOW_FREQUENCY_CHANGE);
+    if (device_ == 0) {
+        error = std::string("Failed to open audio device: ") + SDL_GetError();
+        return false;
+    }
+    format_.freq = have.freq;
+    format_.format = have.format;
+    format_.channels = have.channels;
+    format_.silence = have.silence;
+    // 设备常开，暂停时回调输出静音，开始播放不必等设备启动
+    SDL_PauseAudioDevice(device_, 0);
+#endif
+    stretch_.Configure(format_.freq, format_.channels);
+    return true;
+}
+
+void AudioPlayer::Close() {
+#ifdef USE_SDL_MIXER
+    if (hooked_) {
+        Mix_HookMusic(nullptr, nullptr);
+        hooked_ = false;
+    }
+#else
+    if (device_ != 0) {
+        SDL_CloseAudioDevice(device_);
+        device_ = 0;
+    }
+#endif
+    std::shared_ptr<AudioClip> clip;
+    std::vector<std::shared_ptr<AudioClip>> retired;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        clip = std::move(clip_);
+        retired.swap(retired_);
+        playing_ = false;
+    }
+    if (clip) {
+        clip->Cancel();
+    }
+}
+
+void AudioPlayer::SetClip(std::shared_ptr<AudioClip> clip) {
+    // 释放（可能要等解码线程退出）放在锁外，不阻塞音频回调
+    std::vector<std::shared_ptr<AudioClip>> released;
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (clip_ && clip_ != clip) {
+        // 预览与正式播放可能共用预取缓存里的同一个clip，还有其他持有者时让它继续解码
+        if (clip_.use_count() == 1) {
+            clip_->Cancel();
+        }
+        retired_.push_back(std::move(clip_));
+    }
+    auto firstFinished = std::stable_partition(retired_.begin(), retired_.end(),
+                                               [](const std::shared_ptr<AudioClip>& c) { return !c->Finished(); });
+    std::move(firstFinished, retired_.end(), std::back_inserter(released));
+    retired_.erase(firstFinished, retired_.end());
+    clip_ = std::move(clip);
+    positionFrames_ = 0.0;
+    playing_ = false;
+    stretch_.Reset(0.0);
+}
+
+void AudioPlayer::Play() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    playing_ = clip_ != nullptr;
+}
+
+void AudioPlayer::Pause() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    playing_ = false;
+}
+
+void AudioPlayer::Seek(double ms) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    positionFrames_ = std::floor(std::max(0.0, ms) * format_.freq / 1000.0 + 0.5);
+    stretch_.Reset(positionFrames_);
+}
+
+double AudioPlayer::GetPositionMs() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return positionFrames_ * 1000.0 / format_.freq;
+}
+
+bool AudioPlayer::IsBuffered(double ms) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!clip_ || clip_->Finished()) {
+        return true;
+    }
+    double frames = (std::max(0.0, ms) / 1000.0 + kInstantStartSeconds * rate_) * format_.freq;
+    return static_cast<double>(clip_->DecodedFrames()) >= frames;
+}
+
+void AudioPlayer::SetLoop(bool loop) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    loop_ = loop;
+}
+
+void AudioPlayer::SetRate(double rate, bool preservePitch) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (rate == rate_ && preservePitch == preservePitch_) {
+        return;
+    }
+    rate_ = rate;
+    preservePitch_ = preservePitch;
+    stretch_.Reset(positionFrames_);
+}
+
+void AudioPlayer::Callback(void* userdata, Uint8* stream, int len) {
+    static_cast<AudioPlayer*>(userdata)->Fill(stream, len);
+}
+
+void AudioPlayer::Fill(Uint8* stream, int len) {
+    // 1倍速只有拷贝：解码没追上的部分输出静音，位置照常前进，与谱面时钟保持一致
+    std::memset(stream, format_.silence, static_cast<size_t>(len));
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!clip_ || !playing_) {
+        return;
+    }
+    size_t frameBytes = format_.FrameBytes();
+    size_t frames = static_cast<size_t>(len) / frameBytes;
+    if (rate_ != 1.0) {
+        size_t available = clip_->DecodedFrames();
+        if (FillScaled(*clip_, available, stream, frames) && clip_->Finished() &&
+            positionFrames_ >= static_cast<double>(available)) {
+            if (loop_ && available > 0) {
+                positionFrames_ = 0.0;
+                stretch_.Reset(0.0);
+            } else {
+                playing_ = false;
+            }
+        }
+        return;
+    }
+    size_t written = 0;
+    while (written < frames) {
+        size_t available = clip_->DecodedFrames();
+        size_t position = static_cast<size_t>(positionFrames_);
+        if (position >= available) {
+            if (clip_->Finished()) {
+                if (loop_ && available > 0) {
+                    positionFrames_ = 0.0;
+                    continue;
+                }
+                playing_ = false;
+            } else {
+                // 解码还没到这里：输出的静音同样算作播放过，解码追上后从对应位置接上
+                positionFrames_ = static_cast<double>(position + (frames - written));
+            }
+            break;
+        }
+        size_t count = std::min(frames - written, available - position);
+        std::memcpy(stream + written * frameBytes, clip_->Data() + position * frameBytes, count * frameBytes);
+        positionFrames_ = static_cast<double>(position + count);
+        written += count;
+    }
+}
+
+bool AudioPlayer::FillScaled(const AudioClip& clip, size_t available, Uint8* stream, size_t frames) {
+    // 这次回调要读到的源帧必须都已解码（解码完成后越界部分按静音处理）
+    double span = frames * rate_ + static_cast<double>(stretch_.LookaheadFrames());
+    if (!clip.Finished() && positionFrames_ + span > static_cast<double>(available)) {
+        // 输出静音，位置照常按速率前进；拉伸器的重叠状态已不连续，从新位置重新开始
+        positionFrames_ += frames * rate_;
+        stretch_.Reset(positionFrames_);
+        return false;
+    }
+    const int16_t* source = reinterpret_cast<const int16_t*>(clip.Data());
+    int16_t* out = reinterpret_cast<int16_t*>(stream);
+    if (preservePitch_) {
+        stretch_.Process(source, available, rate_, out, frames);
+        positionFrames_ += frames * rate_;
+        return true;
+    }
+    // 不保持音调：相邻两帧线性插值
+    int channels = format_.channels;
+    for (size_t i = 0; i < frames; ++i) {
+        size_t index = static_cast<size_t>(positionFrames_);
+        float t = static_cast<float>(positionFrames_ - static_cast<double>(index));
+        for (int c = 0; c < channels; ++c) {
+            float a = index < available ? source[index * channels + c] : 0.0f;
+            float b = index + 1 < available ? source[(index + 1) * channels + c] : a;
+            out[i * channels + c] = static_cast<int16_t>(a + (b - a) * t);
+        }
+        positionFrames_ += rate_;
+    }
+    return true;
+}
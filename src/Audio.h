@@ -0,0 +1,137 @@
+#pragma once
+
+#include <SDL.h>
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Package.h"
+#include "TimeStretch.h"
+
+struct Mix_Chunk;
+
+struct AudioFormat {
+    // 输出设备的PCM格式，缓存直接按此格式存放，回调里只做拷贝
+    int freq = 48000;
+    SDL_AudioFormat format = AUDIO_S16SYS;
+    int channels = 2;
+    Uint8 silence = 0;
+
+    size_t FrameBytes() const { return static_cast<size_t>(channels) * (SDL_AUDIO_BITSIZE(format) / 8); }
+};
+
+class AudioClip {
+public:
+    // 把内存中的音频文件解码成设备格式PCM：WAV开头几秒同步转换，其余由后台线程追加；
+    // 混音器构建下压缩格式只能在后台整首解码，完成前没有可播放的帧（调用方用AudioPlayer::IsBuffered等待）。
+    // 文件数据在解码结束前由clip持有
+    static std::shared_ptr<AudioClip> Decode(std::shared_ptr<const std::vector<unsigned char>> file,
+                                             const AudioFormat& format, std::string& error);
+    // 同上，源数据由解码器从reader按需拉取（包内条目边读边解压），不先整个读进内存
+    static std::shared_ptr<AudioClip> Decode(std::unique_ptr<DataReader> source, const AudioFormat& format,
+                                             std::string& error);
+    ~AudioClip();
+    AudioClip(const AudioClip&) = delete;
+    AudioClip& operator=(const AudioClip&) = delete;
+
+    // 已可播放的帧数（只增不减，之前的数据不会再改动）
+    size_t DecodedFrames() const { return decodedFrames_.load(std::memory_order_acquire); }
+    bool Finished() const { return finished_.load(std::memory_order_acquire); }
+    // 当前占用的内存：PCM缓存，加上解码结束前仍持有的源数据（预取缓存据此淘汰）
+    size_t MemoryBytes() const { return memoryBytes_.load(std::memory_order_relaxed); }
+    // 请求后台解码尽早停止（已解码部分仍然有效）
+    void Cancel() { cancel_.store(true, std::memory_order_relaxed); }
+    // 先读DecodedFrames再读Data：帧数非0时数据指针一定已发布且不再改变
+    const Uint8* Data() const { return samples_.load(std::memory_order_acquire); }
+    const AudioFormat& Format() const { return format_; }
+
+private:
+    explicit AudioClip(const AudioFormat& format) : format_(format) {}
+    // 两种源共用的后续流程：WAV开头同步转换，然后启动后台解码
+    static std::shared_ptr<AudioClip> Start(std::shared_ptr<AudioClip> clip, bool wav, std::string& error);
+    // 在源数据上打开一个SDL_RWops（关闭它不会释放源）
+    SDL_RWops* OpenSource();
+    void ReleaseSource();
+    // 读取源出错时返回true并写入error（SDL只会看到读取提前结束）
+    bool SourceFailed(std::string& error) const;
+    bool BeginWav(std::string& error);
+    // 转换最多sourceBytes字节的WAV数据，返回是否还有剩余
+    bool ConvertWavChunk(size_t sourceBytes);
+    void FinishWav();
+    // 把重采样流中已就绪的数据搬进缓存并发布
+    void DrainStream();
+    void DecoderLoop();
+
+    AudioFormat format_;
+    std::shared_ptr<const std::vector<unsigned char>> file_;
+    std::unique_ptr<DataReader> source_;
+    // 容量在解码开始前一次定好，回调读取期间不会重新分配；不做清零，页面按需提交
+    std::unique_ptr<Uint8[]> data_;
+    // 混音器整首解码的结果直接使用，不再拷贝
+    Mix_Chunk* chunk_ = nullptr;
+    // 指向data_或chunk_的样本，只在发布第一批帧之前设置一次
+    std::atomic<const Uint8*> samples_{nullptr};
+    size_t capacityBytes_ = 0;
+    std::atomic<size_t> memoryBytes_{0};
+    std::atomic<size_t> decodedFrames_{0};
+    std::atomic<bool> finished_{false};
+    std::atomic<bool> cancel_{false};
+    Uint8* wavBuffer_ = nullptr;
+    Uint32 wavLength_ = 0;
+    Uint32 wavOffset_ = 0;
+    size_t wavFrameBytes_ = 0;
+    int wavFreq_ = 0;
+    SDL_AudioStream* stream_ = nullptr;
+    std::thread decoder_;
+};
+
+class AudioPlayer {
+public:
+    AudioPlayer() = default;
+    ~AudioPlayer();
+    AudioPlayer(const AudioPlayer&) = delete;
+    AudioPlayer& operator=(const AudioPlayer&) = delete;
+
+    // 打开输出：混音器构建挂在Mix_HookMusic上（需已Mix_OpenAudio），否则自己打开设备回调
+    bool Open(std::string& error);
+    void Close();
+    const AudioFormat& Format() const { return format_; }
+
+    // 换曲并停在开头；旧clip只由播放器持有且仍在解码时先取消（预取缓存里共享的不取消），留到解码线程结束后再释放
+    void SetClip(std::shared_ptr<AudioClip> clip);
+    void Play();
+    void Pause();
+    // 以帧为单位定位，超出已解码部分时先输出静音（位置照常前进），解码追上后从当时的位置接上
+    void Seek(double ms);
+    double GetPositionMs() const;
+    // 从ms处开始的几秒（按当前速率）是否已解码；没有音频或已解码完时为true。开始播放前据此等待解码
+    bool IsBuffered(double ms) const;
+    // 播放到结尾后从头循环（选歌预览）
+    void SetLoop(bool loop);
+    // 播放速率：preservePitch时经WSOLA变速不变调，否则线性插值直接变速（音调随之变化）
+    void SetRate(double rate, bool preservePitch);
+
+private:
+    static void Callback(void* userdata, Uint8* stream, int len);
+    void Fill(Uint8* stream, int len);
+    // 非1倍速时写出frames帧；源数据不足时返回false（输出静音，位置照常前进）
+    bool FillScaled(const AudioClip& clip, size_t available, Uint8* stream, size_t frames);
+
+    AudioFormat format_;
+    SDL_AudioDeviceID device_ = 0;
+    bool hooked_ = false;
+    mutable std::mutex mutex_;
+    std::shared_ptr<AudioClip> clip_;
+    std::vector<std::shared_ptr<AudioClip>> retired_;
+    // 源位置（帧）；变速时每输出一帧前进rate_帧，可以是小数
+    double positionFrames_ = 0.0;
+    bool playing_ = false;
+    bool loop_ = false;
+    double rate_ = 1.0;
+    bool preservePitch_ = true;
+    TimeStretch stretch_;
+};
@@ -0,0 +1,105 @@
+#include "Calibration.h"
+
+#include <cmath>
+#include <cstdint>
+
+#include "ChartGen.h"
+
+namespace {
+constexpr double kCalibrationBpm = 120.0;
+constexpr int kLeadInBeats = 4;
+constexpr int kCalibrationBeats = 32;
+constexpr int kSampleRate = 44100;
+constexpr int kMinSamples = 8;
+
+void WriteLe(std::vector<unsigned char>& out, uint32_t value, int bytes) {
+    for (int i = 0; i < bytes; ++i) {
+        out.push_back(static_cast<unsigned char>((value >> (8 * i)) & 0xFF));
+    }
+}
+}
+
+Chart BuildCalibrationChart() {
+    // 每拍一个音符，轨道轮转
+    ChartGenOptions options;
+    options.bpm = kCalibrationBpm;
+    options.keyCount = 4;
+    options.density = 1.0;
+    double beatLength = 60000.0 / kCalibrationBpm;
+    options.durationMs = static_cast<int>(beatLength * kCalibrationBeats);
+
+    Chart chart = GenerateChart(options);
+    chart.title = "Offset Calibration";
+    chart.artist = "SimpleMania";
+    chart.audioFilename.clear();
+
+    // 预备拍只响节拍不出音符
+    int leadInMs = static_cast<int>(beatLength * kLeadInBeats);
+    for (auto& note : chart.notes) {
+        note.timeMs += leadInMs;
+        note.endTimeMs += leadInMs;
+    }
+    return chart;
+}
+
+std::vector<unsigned char> BuildClickTrackWav(const Chart& chart) {
+    // 单声道16位PCM，每拍一声衰减正弦波，小节首拍音调更高
+    double beatLength = chart.timingPoints.empty() ? 500.0 : chart.timingPoints.front().beatLengthMs;
+    int lastMs = chart.notes.empty() ? 0 : chart.notes.back().timeMs;
+    int totalMs = lastMs + static_cast<int>(beatLength * 2);
+    uint32_t frameCount = static_cast<uint32_t>(static_cast<int64_t>(totalMs) * kSampleRate / 1000);
+    uint32_t dataBytes = frameCount * 2;
+
+    std::vector<unsigned char> wav;
+    wav.reserve(44 + dataBytes);
+    wav.insert(wav.end(), {'R', 'I', 'F', 'F'});
+    WriteLe(wav, 36 + dataBytes, 4);
+    wav.insert(wav.end(), {'W', 'A', 'V', 'E', 'f', 'm', 't', ' '});
+    WriteLe(wav, 16, 4);
+    WriteLe(wav, 1, 2);
+    WriteLe(wav, 1, 2);
+    WriteLe(wav, kSampleRate, 4);
+    WriteLe(wav, kSampleRate * 2, 4);
+    WriteLe(wav, 2, 2);
+    WriteLe(wav, 16, 2);
+    wav.insert(wav.end(), {'d', 'a', 't', 'a'});
+    WriteLe(wav, dataBytes, 4);
+
+    size_t dataStart = wav.size();
+    wav.resize(dataStart + dataBytes, 0);
+    const double kPi = 3.14159265358979323846;
+    int clickFrames = kSampleRate * 40 / 1000;
+    for (int beat = 0;; ++beat) {
+        double beatMs = beat * beatLength;
+        if (beatMs >= totalMs) {
+            break;
+        }
+        uint32_t start = static_cast<uint32_t>(std::llround(beatMs * kSampleRate / 1000.0));
+        double freq = (beat % 4 == 0) ? 1760.0 : 1320.0;
+        for (int i = 0; i < clickFrames && start + i < frameCount; ++i) {
+            double t = static_cast<double>(i) / kSampleRate;
+            double value = std::sin(2.0 * kPi * freq * t) * std::exp(-t * 90.0) * 0.8;
+            int16_t sample = static_cast<int16_t>(value * 32767.0);
+            size_t offset = dataStart + static_cast<size_t>(start + i) * 2;
+            wav[offset] = static_cast<unsigned char>(sample & 0xFF);
+            wav[offset + 1] = static_cast<unsigned char>((sample >> 8) & 0xFF);
+        }
+    }
+    return wav;
+}
+
+CalibrationResult ComputeCalibration(const HitErrorStats& stats) {
+    // 均值即推荐偏移，区间为均值的95%置信区间
+    CalibrationResult result;
+    result.samples = stats.count;
+    result.meanMs = stats.mean;
+    result.stdDevMs = stats.StdDev();
+    if (stats.count < kMinSamples) {
+        return result;
+    }
+    double margin = 1.96 * result.stdDevMs / std::sqrt(static_cast<double>(stats.count));
+    result.lowMs = result.meanMs - margin;
+    result.highMs = result.meanMs + margin;
+    result.valid = true;
+    return result;
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <vector>
+
+#include "Chart.h"
+#include "Game.h"
+
+struct CalibrationResult {
+    // 推荐偏移量及95%置信区间（毫秒，正数表示需要把谱面时间往后推）
+    int samples = 0;
+    double meanMs = 0.0;
+    double stdDevMs = 0.0;
+    double lowMs = 0.0;
+    double highMs = 0.0;
+    bool valid = false;
+};
+
+// 生成节拍器谱面（复用chartgen逻辑，前面留出预备拍）
+Chart BuildCalibrationChart();
+
+// 生成与谱面节拍对齐的点击音轨（内存中的WAV文件）
+std::vector<unsigned char> BuildClickTrackWav(const Chart& chart);
+
+// 根据击中偏差统计计算推荐偏移量
+CalibrationResult ComputeCalibration(const HitErrorStats& stats);
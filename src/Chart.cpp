@@ -1,3 +1,31 @@
 #include "Chart.h"
 
-// 目前仅包含数据结构
+Chart::Chart(size_t arenaBytes)
+    : arenaUpstream(std::make_unique<ArenaUpstream>()),
+      arena(arenaBytes > 0 ? std::make_unique<std::pmr::monotonic_buffer_resource>(arenaBytes, arenaUpstream.get())
+                           : std::make_unique<std::pmr::monotonic_buffer_resource>(arenaUpstream.get())),
+      title(arena.get()),
+      artist(arena.get()),
+      version(arena.get()),
+      audioFilename(arena.get()),
+      timingPoints(arena.get()),
+      notes(arena.get()) {}
+
+Chart& Chart::operator=(Chart&& other) noexcept {
+    // 先让容器接管新缓冲（旧缓冲归还给旧arena），最后再释放旧arena及其上游
+    if (this != &other) {
+        title = std::move(other.title);
+        artist = std::move(other.artist);
+        version = std::move(other.version);
+        audioFilename = std::move(other.audioFilename);
+        previewTimeMs = other.previewTimeMs;
+        keyCount = other.keyCount;
+        overallDifficulty = other.overallDifficulty;
+        baseBpm = other.baseBpm;
+        timingPoints = std::move(other.timingPoints);
+        notes = std::move(other.notes);
+        arena = std::move(other.arena);
+        arenaUpstream = std::move(other.arenaUpstream);
+    }
+    return *this;
+}
@@ -1,8 +1,70 @@
 #pragma once
 
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
 #include <string>
+#include <type_traits>
 #include <vector>
 
+// osu!mania最多18键（含双人模式）
+constexpr int kMaxLanes = 18;
+
+template <typename T>
+struct ArenaAllocator {
+    // 从谱面arena分配；移动与交换时分配器随容器一起转移，移动不会退化为逐元素复制
+    using value_type = T;
+    using propagate_on_container_copy_assignment = std::true_type;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+
+    ArenaAllocator() noexcept : resource(std::pmr::get_default_resource()) {}
+    ArenaAllocator(std::pmr::memory_resource* arena) noexcept : resource(arena) {}
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U>& other) noexcept : resource(other.resource) {}
+
+    T* allocate(size_t count) { return static_cast<T*>(resource->allocate(count * sizeof(T), alignof(T))); }
+    void deallocate(T* pointer, size_t count) noexcept { resource->deallocate(pointer, count * sizeof(T), alignof(T)); }
+
+    std::pmr::memory_resource* resource;
+};
+
+template <typename T, typename U>
+bool operator==(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b) {
+    return a.resource == b.resource;
+}
+
+template <typename T, typename U>
+bool operator!=(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b) {
+    return a.resource != b.resource;
+}
+
+using ArenaString = std::basic_string<char, std::char_traits<char>, ArenaAllocator<char>>;
+template <typename T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+
+class ArenaUpstream final : public std::pmr::memory_resource {
+public:
+    // 谱面arena的上游：转发给默认资源，并记下arena实际向它申请的字节数（含预留未用的部分）
+    ArenaUpstream() noexcept : upstream_(std::pmr::get_default_resource()) {}
+    size_t ReservedBytes() const { return reservedBytes_; }
+
+private:
+    void* do_allocate(size_t bytes, size_t alignment) override {
+        void* pointer = upstream_->allocate(bytes, alignment);
+        reservedBytes_ += bytes;
+        return pointer;
+    }
+    void do_deallocate(void* pointer, size_t bytes, size_t alignment) override {
+        upstream_->deallocate(pointer, bytes, alignment);
+        reservedBytes_ -= bytes;
+    }
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+
+    std::pmr::memory_resource* upstream_;
+    size_t reservedBytes_ = 0;
+};
+
 struct TimingPoint {
     // 时间点与节拍信息（毫秒与拍长）
     double timeMs = 0.0;
@@ -17,17 +79,34 @@ struct Note {
     int timeMs = 0;
     int endTimeMs = 0;
     bool isHold = false;
-    bool judged = false;
 };
 
 struct Chart {
-    // 谱面基础信息与所有音符
-    std::string title;
-    std::string artist;
-    std::string version;
-    std::string audioFilename;
+    // 谱面基础信息与所有音符；字符串、时间点与音符都分配在谱面自己的arena里，
+    // 谱面只能移动不能复制，销毁时整块释放
+    explicit Chart(size_t arenaBytes = 0);
+    Chart(Chart&& other) noexcept = default;
+    Chart& operator=(Chart&& other) noexcept;
+    Chart(const Chart&) = delete;
+    Chart& operator=(const Chart&) = delete;
+
+    // arena向上游申请的总字节数（预取缓存按此计算谱面的内存占用）
+    size_t ArenaBytes() const { return arenaUpstream ? arenaUpstream->ReservedBytes() : 0; }
+
+    // 必须是最前的两个成员：最后销毁，保证容器析构时arena仍然有效，arena析构时上游仍然有效
+    std::unique_ptr<ArenaUpstream> arenaUpstream;
+    std::unique_ptr<std::pmr::monotonic_buffer_resource> arena;
+
+    ArenaString title;
+    ArenaString artist;
+    ArenaString version;
+    ArenaString audioFilename;
+    // 选歌预览起点（毫秒），-1表示谱面未指定
+    int previewTimeMs = -1;
     int keyCount = 4;
+    // 判定窗口由OD决定（osu默认5）
+    double overallDifficulty = 5.0;
     double baseBpm = 120.0;
-    std::vector<TimingPoint> timingPoints;
-    std::vector<Note> notes;
+    ArenaVector<TimingPoint> timingPoints;
+    ArenaVector<Note> notes;
 };
@@ -0,0 +1,246 @@
+#include "ChartBinary.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string_view>
+#include <vector>
+
+#include "OsuParser.h"
+#include "PackedNote.h"
+#include "Profiler.h"
+
+namespace {
+const char kMagic[4] = {'S', 'M', 'C', '1'};
+
+class Writer {
+public:
+    // 按小端序追加定长字段
+    void PutU8(uint8_t value) { data_.push_back(value); }
+
+    void PutU32(uint32_t value) {
+        for (int i = 0; i < 4; ++i) {
+            data_.push_back(static_cast<uint8_t>(value >> (i * 8)));
+        }
+    }
+
+    void PutU64(uint64_t value) {
+        for (int i = 0; i < 8; ++i) {
+            data_.push_back(static_cast<uint8_t>(value >> (i * 8)));
+        }
+    }
+
+    void PutDouble(double value) {
+        uint64_t bits = 0;
+        std::memcpy(&bits, &value, sizeof(bits));
+        PutU64(bits);
+    }
+
+    void PutString(std::string_view text) {
+        PutU32(static_cast<uint32_t>(text.size()));
+        data_.insert(data_.end(), text.begin(), text.end());
+    }
+
+    void Reserve(size_t size) { data_.reserve(size); }
+    const std::vector<uint8_t>& Data() const { return data_; }
+
+private:
+    std::vector<uint8_t> data_;
+};
+
+class Reader {
+public:
+    // 越界读取时置失败标记并返回0，由调用方最后统一检查
+    Reader(const uint8_t* data, size_t size) : data_(data), size_(size) {}
+
+    uint8_t GetU8() { return Has(1) ? data_[offset_++] : 0; }
+
+    uint32_t GetU32() {
+        if (!Has(4)) {
+            return 0;
+        }
+        uint32_t value = 0;
+        for (int i = 0; i < 4; ++i) {
+            value |= static_cast<uint32_t>(data_[offset_++]) << (i * 8);
+        }
+        return value;
+    }
+
+    uint64_t GetU64() {
+        if (!Has(8)) {
+            return 0;
+        }
+        uint64_t value = 0;
+        for (int i = 0; i < 8; ++i) {
+            value |= static_cast<uint64_t>(data_[offset_++]) << (i * 8);
+        }
+        return value;
+    }
+
+    double GetDouble() {
+        uint64_t bits = GetU64();
+        double value = 0.0;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+    std::string GetString() {
+        uint32_t length = GetU32();
+        if (!Has(length)) {
+            return std::string();
+        }
+        std::string text(reinterpret_cast<const char*>(data_ + offset_), length);
+        offset_ += length;
+        return text;
+    }
+
+    // 剩余字节是否足够容纳count个size字节的元素
+    bool Fits(uint64_t count, size_t size) const { return count <= (size_ - offset_) / size; }
+    bool Ok() const { return ok_; }
+
+private:
+    bool Has(size_t count) {
+        if (!ok_ || size_ - offset_ < count) {
+            ok_ = false;
+            return false;
+        }
+        return true;
+    }
+
+    const uint8_t* data_;
+    size_t size_;
+    size_t offset_ = 0;
+    bool ok_ = true;
+};
+}
+
+bool WriteChartBinary(const std::string& path, const Chart& chart, std::string& error) {
+    PackedNoteList notes = PackNotes(chart.notes);
+
+    Writer out;
+    out.Reserve(256 + chart.timingPoints.size() * 21 + notes.Size() * 8 + notes.KeyTimes().size() * 4);
+    for (char c : kMagic) {
+        out.PutU8(static_cast<uint8_t>(c));
+    }
+    out.PutU32(static_cast<uint32_t>(chart.keyCount));
+    out.PutDouble(chart.overallDifficulty);
+    out.PutDouble(chart.baseBpm);
+    out.PutString(chart.title);
+    out.PutString(chart.artist);
+    out.PutString(chart.version);
+    out.PutString(chart.audioFilename);
+    out.PutU32(static_cast<uint32_t>(chart.timingPoints.size()));
+    for (const auto& point : chart.timingPoints) {
+        out.PutDouble(point.timeMs);
+        out.PutDouble(point.beatLengthMs);
+        out.PutU32(static_cast<uint32_t>(point.meter));
+        out.PutU8(point.inherited ? 1 : 0);
+    }
+    out.PutU64(notes.Size());
+    for (int32_t keyTime : notes.KeyTimes()) {
+        out.PutU32(static_cast<uint32_t>(keyTime));
+    }
+    for (uint64_t bits : notes.Bits()) {
+        out.PutU64(bits);
+    }
+
+    std::FILE* file = std::fopen(path.c_str(), "wb");
+    if (!file) {
+        error = "Failed to write output file.";
+        return false;
+    }
+    size_t written = std::fwrite(out.Data().data(), 1, out.Data().size(), file);
+    std::fclose(file);
+    if (written != out.Data().size()) {
+        error = "Failed to write output file.";
+        return false;
+    }
+    return true;
+}
+
+bool ReadChartBinary(const std::string& path, Chart& outChart, std::string& error) {
+    PROFILE_ZONE("ReadChartBinary");
+    std::FILE* file = std::fopen(path.c_str(), "rb");
+    if (!file) {
+        error = "Failed to open binary chart.";
+        return false;
+    }
+    std::vector<uint8_t> data;
+    std::fseek(file, 0, SEEK_END);
+    long size = std::ftell(file);
+    std::fseek(file, 0, SEEK_SET);
+    if (size > 0) {
+        data.resize(static_cast<size_t>(size));
+        data.resize(std::fread(data.data(), 1, data.size(), file));
+    }
+    std::fclose(file);
+
+    if (data.size() < sizeof(kMagic) || std::memcmp(data.data(), kMagic, sizeof(kMagic)) != 0) {
+        error = "Not a SimpleMania binary chart.";
+        return false;
+    }
+
+    Reader in(data.data() + sizeof(kMagic), data.size() - sizeof(kMagic));
+    // 解码后的音符约为打包大小的两倍，arena一次预留到位
+    Chart chart(data.size() * 2 + 4096);
+    chart.keyCount = static_cast<int>(in.GetU32());
+    chart.overallDifficulty = in.GetDouble();
+    chart.baseBpm = in.GetDouble();
+    chart.title = in.GetString();
+    chart.artist = in.GetString();
+    chart.version = in.GetString();
+    chart.audioFilename = in.GetString();
+
+    uint32_t pointCount = in.GetU32();
+    if (!in.Fits(pointCount, 21)) {
+        error = "Binary chart is truncated.";
+        return false;
+    }
+    chart.timingPoints.resize(pointCount);
+    for (auto& point : chart.timingPoints) {
+        point.timeMs = in.GetDouble();
+        point.beatLengthMs = in.GetDouble();
+        point.meter = static_cast<int>(in.GetU32());
+        point.inherited = in.GetU8() != 0;
+    }
+
+    uint64_t noteCount = in.GetU64();
+    uint64_t keyCount = (noteCount + kPackedBlockSize - 1) / kPackedBlockSize;
+    if (!in.Ok() || !in.Fits(noteCount, 8)) {
+        error = "Binary chart is truncated.";
+        return false;
+    }
+    std::vector<int32_t> keyTimes(keyCount);
+    for (auto& keyTime : keyTimes) {
+        keyTime = static_cast<int32_t>(in.GetU32());
+    }
+    std::vector<uint64_t> bits(noteCount);
+    for (auto& value : bits) {
+        value = in.GetU64();
+    }
+    PackedNoteList notes;
+    if (!in.Ok() || !notes.Assign(std::move(bits), std::move(keyTimes))) {
+        error = "Binary chart is truncated.";
+        return false;
+    }
+    if (chart.keyCount < 1 || chart.keyCount > kMaxLanes) {
+        error = "Invalid key count.";
+        return false;
+    }
+
+    chart.notes.resize(notes.Size());
+    notes.Decode(0, notes.Size(), chart.notes.data());
+    outChart = std::move(chart);
+    return true;
+}
+
+bool IsChartBinaryPath(const std::string& path) {
+    return path.size() >= 4 && path.compare(path.size() - 4, 4, ".smc") == 0;
+}
+
+bool LoadChartFile(const std::string& path, Chart& outChart, std::string& error) {
+    if (IsChartBinaryPath(path)) {
+        return ReadChartBinary(path, outChart, error);
+    }
+    return ParseOsuFile(path, outChart, error);
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+#include <string>
+
+#include "Chart.h"
+
+// 二进制谱面（.smc）：元数据、时间点与8字节打包音符，小端序
+bool WriteChartBinary(const std::string& path, const Chart& chart, std::string& error);
+bool ReadChartBinary(const std::string& path, Chart& outChart, std::string& error);
+
+// 按扩展名选择.smc二进制或.osu文本解析
+bool IsChartBinaryPath(const std::string& path);
+bool LoadChartFile(const std::string& path, Chart& outChart, std::string& error);
@@ -0,0 +1,497 @@
+#include "ChartEditor.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+
+#include "ChartBinary.h"
+#include "Package.h"
+#include "Profiler.h"
+
+namespace {
+// 块大小上下限：超过上限对半拆分，低于下限时并入邻块
+constexpr size_t kChunkMax = 512;
+constexpr size_t kChunkMin = 64;
+// 一屏最多画这么多条网格线
+constexpr size_t kMaxGridLines = 2000;
+
+bool EarlierThan(const EditNote& note, int timeMs) {
+    return note.timeMs < timeMs;
+}
+
+std::string TrimLine(const std::string& line) {
+    size_t start = line.find_first_not_of(" \t\r");
+    size_t end = line.find_last_not_of(" \t\r");
+    return start == std::string::npos ? std::string() : line.substr(start, end - start + 1);
+}
+
+bool ReplaceFile(const std::string& path, const std::string& tempPath, std::string& error) {
+    // 改名覆盖原文件：读取方（包括热重载）不会看到写了一半的谱面
+    std::error_code renameError;
+    std::filesystem::rename(tempPath, path, renameError);
+    if (renameError) {
+        std::filesystem::remove(path, renameError);
+        std::filesystem::rename(tempPath, path, renameError);
+    }
+    if (renameError) {
+        error = "Failed to replace " + path + ": " + renameError.message();
+        return false;
+    }
+    return true;
+}
+
+bool WriteOsuHitObjects(const std::string& path, const std::string& tempPath, int keyCount,
+                        const std::vector<Note>& notes, std::string& error) {
+    // 保留原文件[HitObjects]之前的全部内容（事件、背景、编辑器设置等解析器不读取的段也不丢失）
+    std::ifstream input(path, std::ios::binary);
+    if (!input.is_open()) {
+        error = "Failed to read " + path;
+        return false;
+    }
+    std::string text;
+    std::string line;
+    bool found = false;
+    while (std::getline(input, line)) {
+        text += line;
+        text += '\n';
+        if (TrimLine(line) == "[HitObjects]") {
+            found = true;
+            break;
+        }
+    }
+    input.close();
+    if (!found) {
+        text += "\n[HitObjects]\n";
+    }
+
+    char buffer[96];
+    for (const Note& note : notes) {
+        int x = static_cast<int>((note.lane + 0.5) * 512.0 / keyCount);
+        if (note.isHold) {
+            std::snprintf(buffer, sizeof(buffer), "%d,192,%d,128,0,%d:0:0:0:0:\n", x, note.timeMs, note.endTimeMs);
+        } else {
+            std::snprintf(buffer, sizeof(buffer), "%d,192,%d,1,0,0:0:0:0:\n", x, note.timeMs);
+        }
+        text += buffer;
+    }
+
+    std::FILE* file = std::fopen(tempPath.c_str(), "wb");
+    if (!file) {
+        error = "Failed to write " + tempPath;
+        return false;
+    }
+    size_t written = std::fwrite(text.data(), 1, text.size(), file);
+    std::fclose(file);
+    if (written != text.size()) {
+        error = "Failed to write " + tempPath;
+        return false;
+    }
+    return true;
+}
+}
+
+size_t LaneNotes::ChunkFor(int timeMs) const {
+    return static_cast<size_t>(std::lower_bound(chunkLastMs_.begin(), chunkLastMs_.end(), timeMs) -
+                               chunkLastMs_.begin());
+}
+
+bool LaneNotes::Insert(const EditNote& note) {
+    if (chunks_.empty()) {
+        chunks_.emplace_back();
+        chunkLastMs_.push_back(note.timeMs);
+    }
+    // 比所有音符都晚时放进最后一块
+    size_t c = std::min(ChunkFor(note.timeMs), chunks_.size() - 1);
+    std::vector<EditNote>& chunk = chunks_[c];
+    auto it = std::lower_bound(chunk.begin(), chunk.end(), note.timeMs, EarlierThan);
+    if (it != chunk.end() && it->timeMs == note.timeMs) {
+        return false;
+    }
+    chunk.insert(it, note);
+    chunkLastMs_[c] = chunk.back().timeMs;
+    ++size_;
+    if (chunk.size() > kChunkMax) {
+        std::vector<EditNote> upper(chunk.begin() + kChunkMax / 2, chunk.end());
+        chunk.resize(kChunkMax / 2);
+        chunkLastMs_[c] = chunk.back().timeMs;
+        chunkLastMs_.insert(chunkLastMs_.begin() + c + 1, upper.back().timeMs);
+        chunks_.insert(chunks_.begin() + c + 1, std::move(upper));
+    }
+    return true;
+}
+
+bool LaneNotes::Erase(int timeMs, EditNote* removed) {
+    size_t c = ChunkFor(timeMs);
+    if (c >= chunks_.size()) {
+        return false;
+    }
+    std::vector<EditNote>& chunk = chunks_[c];
+    auto it = std::lower_bound(chunk.begin(), chunk.end(), timeMs, EarlierThan);
+    if (it == chunk.end() || it->timeMs != timeMs) {
+        return false;
+    }
+    if (removed) {
+        *removed = *it;
+    }
+    chunk.erase(it);
+    --size_;
+    if (chunk.empty()) {
+        chunks_.erase(chunks_.begin() + c);
+        chunkLastMs_.erase(chunkLastMs_.begin() + c);
+        return true;
+    }
+    chunkLastMs_[c] = chunk.back().timeMs;
+    // 过小的块并入后一块（最后一块并入前一块），合并后不超过上限
+    if (chunk.size() < kChunkMin && chunks_.size() > 1) {
+        size_t into = c + 1 < chunks_.size() ? c : c - 1;
+        std::vector<EditNote>& first = chunks_[into];
+        std::vector<EditNote>& second = chunks_[into + 1];
+        if (first.size() + second.size() <= kChunkMax) {
+            first.insert(first.end(), second.begin(), second.end());
+            chunkLastMs_[into] = first.back().timeMs;
+            chunks_.erase(chunks_.begin() + into + 1);
+            chunkLastMs_.erase(chunkLastMs_.begin() + into + 1);
+        }
+    }
+    return true;
+}
+
+const EditNote* LaneNotes::FindAt(int timeMs) const {
+    size_t c = ChunkFor(timeMs);
+    if (c >= chunks_.size()) {
+        return nullptr;
+    }
+    const std::vector<EditNote>& chunk = chunks_[c];
+    auto it = std::lower_bound(chunk.begin(), chunk.end(), timeMs, EarlierThan);
+    return it != chunk.end() && it->timeMs == timeMs ? &*it : nullptr;
+}
+
+const EditNote* LaneNotes::FindCovering(int timeMs) const {
+    // 时间不晚于timeMs的最后一个音符：头正好在timeMs，或长条尾不早于timeMs
+    if (chunks_.empty()) {
+        return nullptr;
+    }
+    size_t c = std::min(ChunkFor(timeMs), chunks_.size() - 1);
+    const std::vector<EditNote>& chunk = chunks_[c];
+    auto it = std::upper_bound(chunk.begin(), chunk.end(), timeMs,
+                               [](int time, const EditNote& note) { return time < note.timeMs; });
+    const EditNote* note = nullptr;
+    if (it != chunk.begin()) {
+        note = &*(it - 1);
+    } else if (c > 0) {
+        note = &chunks_[c - 1].back();
+    }
+    if (note && (note->timeMs == timeMs || (note->IsHold() && note->endTimeMs >= timeMs))) {
+        return note;
+    }
+    return nullptr;
+}
+
+void LaneNotes::Collect(int fromMs, int toMs, std::vector<EditNote>& out) const {
+    if (chunks_.empty()) {
+        return;
+    }
+    // 同一轨道的长条互不重叠，只有fromMs之前的最后一个音符可能伸进区间
+    const EditNote* before = FindCovering(fromMs - 1);
+    if (before && before->IsHold() && before->endTimeMs >= fromMs) {
+        out.push_back(*before);
+    }
+    for (size_t c = ChunkFor(fromMs); c < chunks_.size(); ++c) {
+        const std::vector<EditNote>& chunk = chunks_[c];
+        auto it = std::lower_bound(chunk.begin(), chunk.end(), fromMs, EarlierThan);
+        for (; it != chunk.end(); ++it) {
+            if (it->timeMs >= toMs) {
+                return;
+            }
+            out.push_back(*it);
+        }
+    }
+}
+
+void LaneNotes::Clear() {
+    chunks_.clear();
+    chunkLastMs_.clear();
+    size_ = 0;
+}
+
+bool ChartEditor::Open(const std::string& path, std::string& error) {
+    PROFILE_ZONE("ChartEditor::Open");
+    std::string archivePath;
+    std::string entryName;
+    if (SplitPackagePath(path, archivePath, entryName)) {
+        error = "Charts inside .osz packages are read-only: " + path;
+        return false;
+    }
+    Chart chart;
+    if (!LoadChartFile(path, chart, error)) {
+        return false;
+    }
+    Close();
+    chart_ = std::move(chart);
+    keyCount_ = std::clamp(chart_.keyCount, 1, kMaxLanes);
+    // 按时间顺序插入，每块都是尾部追加
+    std::vector<Note> notes(chart_.notes.begin(), chart_.notes.end());
+    std::stable_sort(notes.begin(), notes.end(), [](const Note& a, const Note& b) { return a.timeMs < b.timeMs; });
+    for (const Note& note : notes) {
+        int lane = std::clamp(note.lane, 0, keyCount_ - 1);
+        lanes_[lane].Insert(EditNote{note.timeMs, note.isHold ? std::max(note.timeMs, note.endTimeMs) : note.timeMs});
+    }
+    chart_.notes.clear();
+
+    for (const TimingPoint& point : chart_.timingPoints) {
+        if (!point.inherited && point.beatLengthMs > 0.0) {
+            sections_.push_back(point);
+        }
+    }
+    std::stable_sort(sections_.begin(), sections_.end(),
+                     [](const TimingPoint& a, const TimingPoint& b) { return a.timeMs < b.timeMs; });
+    if (sections_.empty()) {
+        TimingPoint point;
+        point.beatLengthMs = 60000.0 / (chart_.baseBpm > 0.0 ? chart_.baseBpm : 120.0);
+        sections_.push_back(point);
+    }
+    path_ = path;
+    cursorMs_ = 0;
+    return true;
+}
+
+bool ChartEditor::Save(std::string& error) {
+    PROFILE_ZONE("ChartEditor::Save");
+    std::vector<Note> notes;
+    notes.reserve(GetNoteCount());
+    for (int lane = 0; lane < keyCount_; ++lane) {
+        lanes_[lane].ForEach([&](const EditNote& note) {
+            Note out;
+            out.lane = lane;
+            out.timeMs = note.timeMs;
+            out.endTimeMs = note.endTimeMs;
+            out.isHold = note.IsHold();
+            notes.push_back(out);
+        });
+    }
+    std::sort(notes.begin(), notes.end(), [](const Note& a, const Note& b) {
+        return a.timeMs != b.timeMs ? a.timeMs < b.timeMs : a.lane < b.lane;
+    });
+
+    std::string tempPath = path_ + ".tmp";
+    bool written = false;
+    if (IsChartBinaryPath(path_)) {
+        chart_.notes.assign(notes.begin(), notes.end());
+        written = WriteChartBinary(tempPath, chart_, error);
+        chart_.notes.clear();
+    } else {
+        written = WriteOsuHitObjects(path_, tempPath, keyCount_, notes, error);
+    }
+    if (!written || !ReplaceFile(path_, tempPath, error)) {
+        return false;
+    }
+    savedDepth_ = undo_.size();
+    return true;
+}
+
+void ChartEditor::Close() {
+    path_.clear();
+    chart_ = Chart();
+    for (auto& lane : lanes_) {
+        lane.Clear();
+    }
+    sections_.clear();
+    undo_.clear();
+    redo_.clear();
+    savedDepth_ = 0;
+    cursorMs_ = 0;
+}
+
+size_t ChartEditor::GetNoteCount() const {
+    size_t count = 0;
+    for (int lane = 0; lane < keyCount_; ++lane) {
+        count += lanes_[lane].Size();
+    }
+    return count;
+}
+
+int ChartEditor::GetLastNoteMs() const {
+    int last = 0;
+    for (int lane = 0; lane < keyCount_; ++lane) {
+        lanes_[lane].ForEach([&](const EditNote& note) { last = std::max(last, note.endTimeMs); });
+    }
+    return last;
+}
+
+size_t ChartEditor::SectionAt(double timeMs) const {
+    auto it = std::upper_bound(sections_.begin(), sections_.end(), timeMs + 0.5,
+                               [](double time, const TimingPoint& point) { return time < point.timeMs; });
+    return it == sections_.begin() ? 0 : static_cast<size_t>(it - sections_.begin()) - 1;
+}
+
+double ChartEditor::GridStep(size_t section) const {
+    return sections_[section].beatLengthMs / GetDivisor();
+}
+
+int ChartEditor::NextGrid(int timeMs, int direction) const {
+    // 网格从每条红线起算，跨过下一条红线时停在红线上；时间取整到毫秒，比较时留半毫秒余量
+    size_t section = SectionAt(timeMs);
+    double origin = sections_[section].timeMs;
+    double step = GridStep(section);
+    double grid = 0.0;
+    if (direction > 0) {
+        grid = origin + (std::floor((timeMs - origin + 0.5) / step) + 1.0) * step;
+        if (section + 1 < sections_.size() && grid > sections_[section + 1].timeMs - 0.5) {
+            grid = sections_[section + 1].timeMs;
+        }
+    } else {
+        double index = std::ceil((timeMs - origin - 0.5) / step) - 1.0;
+        grid = origin + index * step;
+        if (index < 0.0 && section > 0) {
+            double previousOrigin = sections_[section - 1].timeMs;
+            double previousStep = GridStep(section - 1);
+            grid = previousOrigin + (std::ceil((origin - previousOrigin - 0.5) / previousStep) - 1.0) * previousStep;
+        }
+    }
+    return static_cast<int>(std::lround(grid));
+}
+
+int ChartEditor::Snap(int timeMs) const {
+    size_t section = SectionAt(timeMs);
+    double origin = sections_[section].timeMs;
+    double step = GridStep(section);
+    double grid = origin + std::round((timeMs - origin) / step) * step;
+    if (section + 1 < sections_.size() && grid > sections_[section + 1].timeMs) {
+        grid = sections_[section + 1].timeMs;
+    }
+    return static_cast<int>(std::lround(grid));
+}
+
+void ChartEditor::SetCursor(int timeMs) {
+    cursorMs_ = std::max(0, Snap(timeMs));
+}
+
+void ChartEditor::Step(int steps) {
+    int direction = steps > 0 ? 1 : -1;
+    for (int i = 0; i < std::abs(steps); ++i) {
+        int next = NextGrid(cursorMs_, direction);
+        if (next < 0) {
+            break;
+        }
+        cursorMs_ = next;
+    }
+}
+
+void ChartEditor::StepMeasure(int measures) {
+    const TimingPoint& section = sections_[SectionAt(cursorMs_)];
+    double measureMs = section.beatLengthMs * std::max(1, section.meter);
+    SetCursor(static_cast<int>(std::lround(cursorMs_ + measures * measureMs)));
+}
+
+void ChartEditor::CycleDivisor(int direction) {
+    int count = static_cast<int>(std::size(kDivisors));
+    divisorIndex_ = (divisorIndex_ + direction + count) % count;
+    SetCursor(cursorMs_);
+}
+
+void ChartEditor::CollectGrid(int fromMs, int toMs, std::vector<int>& times, std::vector<uint8_t>& beats) const {
+    int grid = Snap(fromMs);
+    if (grid < fromMs) {
+        grid = NextGrid(grid, 1);
+    }
+    int divisor = GetDivisor();
+    for (size_t count = 0; grid < toMs && count < kMaxGridLines; ++count) {
+        size_t section = SectionAt(grid);
+        long index = std::lround((grid - sections_[section].timeMs) / GridStep(section));
+        times.push_back(grid);
+        beats.push_back(((index % divisor) + divisor) % divisor == 0 ? 1 : 0);
+        int next = NextGrid(grid, 1);
+        if (next <= grid) {
+            break;
+        }
+        grid = next;
+    }
+}
+
+void ChartEditor::CollectNotes(int lane, int fromMs, int toMs, std::vector<EditNote>& out) const {
+    if (lane >= 0 && lane < keyCount_) {
+        lanes_[lane].Collect(fromMs, toMs, out);
+    }
+}
+
+bool ChartEditor::ToggleNote(int lane) {
+    if (lane < 0 || lane >= keyCount_) {
+        return false;
+    }
+    EditCommand command;
+    if (const EditNote* existing = lanes_[lane].FindCovering(cursorMs_)) {
+        command.edits.push_back(NoteEdit{false, lane, *existing});
+    } else {
+        command.edits.push_back(NoteEdit{true, lane, EditNote{cursorMs_, cursorMs_}});
+    }
+    Execute(std::move(command));
+    return true;
+}
+
+bool ChartEditor::PlaceHold(int lane, int startMs, int endMs) {
+    if (lane < 0 || lane >= keyCount_) {
+        return false;
+    }
+    int start = std::max(0, Snap(std::min(startMs, endMs)));
+    int end = std::max(0, Snap(std::max(startMs, endMs)));
+    if (start == end) {
+        return false;
+    }
+    EditCommand command;
+    std::vector<EditNote> overlapped;
+    lanes_[lane].Collect(start, end + 1, overlapped);
+    for (const EditNote& note : overlapped) {
+        command.edits.push_back(NoteEdit{false, lane, note});
+    }
+    command.edits.push_back(NoteEdit{true, lane, EditNote{start, end}});
+    Execute(std::move(command));
+    return true;
+}
+
+void ChartEditor::Apply(const NoteEdit& edit, bool forward) {
+    if (edit.add == forward) {
+        lanes_[edit.lane].Insert(edit.note);
+    } else {
+        lanes_[edit.lane].Erase(edit.note.timeMs, nullptr);
+    }
+}
+
+void ChartEditor::Execute(EditCommand command) {
+    for (const NoteEdit& edit : command.edits) {
+        Apply(edit, true);
+    }
+    if (savedDepth_ > undo_.size()) {
+        savedDepth_ = static_cast<size_t>(-1);
+    }
+    undo_.push_back(std::move(command));
+    redo_.clear();
+}
+
+bool ChartEditor::Undo() {
+    if (undo_.empty()) {
+        return false;
+    }
+    EditCommand command = std::move(undo_.back());
+    undo_.pop_back();
+    for (auto edit = command.edits.rbegin(); edit != command.edits.rend(); ++edit) {
+        Apply(*edit, false);
+    }
+    redo_.push_back(std::move(command));
+    return true;
+}
+
+bool ChartEditor::Redo() {
+    if (redo_.empty()) {
+        return false;
+    }
+    EditCommand command = std::move(redo_.back());
+    redo_.pop_back();
+    for (const NoteEdit& edit : command.edits) {
+        Apply(edit, true);
+    }
+    undo_.push_back(std::move(command));
+    return true;
+}
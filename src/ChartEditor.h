@@ -0,0 +1,127 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Chart.h"
+
+struct EditNote {
+    // 编辑器中的音符（轨道由所在的LaneNotes决定），endTimeMs大于timeMs时为长条
+    int timeMs = 0;
+    int endTimeMs = 0;
+
+    bool IsHold() const { return endTimeMs > timeMs; }
+};
+
+class LaneNotes {
+public:
+    // 单轨道按时间有序的分块数组：块内连续存放，块满时对半拆分，过小时与邻块合并；
+    // 另存每块的最后时间用于二分，插入、删除与区间查询只触及一个块（十万音符时约几百块）
+    bool Insert(const EditNote& note);
+    // 删除timeMs处的音符，removed返回被删的内容
+    bool Erase(int timeMs, EditNote* removed);
+    // timeMs处的音符头，或覆盖timeMs的长条
+    const EditNote* FindAt(int timeMs) const;
+    const EditNote* FindCovering(int timeMs) const;
+    // 按时间顺序追加[fromMs, toMs)内可见的音符（包括头在fromMs之前、尾部仍在区间内的长条）
+    void Collect(int fromMs, int toMs, std::vector<EditNote>& out) const;
+    size_t Size() const { return size_; }
+    void Clear();
+
+    template <typename Fn>
+    void ForEach(Fn&& fn) const {
+        for (const auto& chunk : chunks_) {
+            for (const EditNote& note : chunk) {
+                fn(note);
+            }
+        }
+    }
+
+private:
+    // 第一个最后时间>=timeMs的块
+    size_t ChunkFor(int timeMs) const;
+
+    std::vector<std::vector<EditNote>> chunks_;
+    std::vector<int> chunkLastMs_;
+    size_t size_ = 0;
+};
+
+struct NoteEdit {
+    // 一次原子修改：在lane上加入或删除note
+    bool add = true;
+    int lane = 0;
+    EditNote note;
+};
+
+struct EditCommand {
+    // 一条可撤销的命令（改长条长度是先删后加两步）
+    std::vector<NoteEdit> edits;
+};
+
+class ChartEditor {
+public:
+    // 打开谱面：音符按轨道放入有序存储，元数据与时间点原样保留，保存时写回
+    bool Open(const std::string& path, std::string& error);
+    // .osu只替换[HitObjects]段，其余内容保持原样；.smc整体重写。先写临时文件再改名
+    bool Save(std::string& error);
+    void Close();
+    bool IsOpen() const { return !path_.empty(); }
+    const std::string& GetPath() const { return path_; }
+    const Chart& GetChart() const { return chart_; }
+    int GetKeyCount() const { return keyCount_; }
+    size_t GetNoteCount() const;
+    bool IsDirty() const { return savedDepth_ != undo_.size(); }
+    // 最后一个音符（长条取尾部）的时间，没有音符时为0
+    int GetLastNoteMs() const;
+
+    // 时间轴：游标总是落在当前细分的网格上
+    int GetCursorMs() const { return cursorMs_; }
+    void SetCursor(int timeMs);
+    // 沿网格前后移动steps格
+    void Step(int steps);
+    // 前后移动整小节（按所在红线的拍号）
+    void StepMeasure(int measures);
+    // 每拍细分：1/2/3/4/6/8/12/16循环
+    int GetDivisor() const { return kDivisors[divisorIndex_]; }
+    void CycleDivisor(int direction);
+    // 吸附到最近的网格线（按timeMs所在红线的拍长与细分）
+    int Snap(int timeMs) const;
+    // 追加[fromMs, toMs)内的网格线，beats标记整拍
+    void CollectGrid(int fromMs, int toMs, std::vector<int>& times, std::vector<uint8_t>& beats) const;
+    void CollectNotes(int lane, int fromMs, int toMs, std::vector<EditNote>& out) const;
+
+    // 在游标处切换：有音符头或被长条覆盖时删除，否则放一个单键
+    bool ToggleNote(int lane);
+    // 放置长条（起止自动排序并吸附），与已有音符重叠时先删除它们，整体作为一条命令
+    bool PlaceHold(int lane, int startMs, int endMs);
+    bool Undo();
+    bool Redo();
+    size_t GetUndoDepth() const { return undo_.size(); }
+    size_t GetRedoDepth() const { return redo_.size(); }
+
+private:
+    static constexpr int kDivisors[] = {1, 2, 3, 4, 6, 8, 12, 16};
+
+    // 时间所在的红线下标（早于第一条红线时为0），及其网格间距
+    size_t SectionAt(double timeMs) const;
+    double GridStep(size_t section) const;
+    int NextGrid(int timeMs, int direction) const;
+    void Apply(const NoteEdit& edit, bool forward);
+    void Execute(EditCommand command);
+
+    std::string path_;
+    Chart chart_;
+    int keyCount_ = 4;
+    std::array<LaneNotes, kMaxLanes> lanes_;
+    // 红线（拍长为正的时间点），没有红线时按baseBpm在0ms处补一条
+    std::vector<TimingPoint> sections_;
+    int cursorMs_ = 0;
+    int divisorIndex_ = 3;
+    std::vector<EditCommand> undo_;
+    std::vector<EditCommand> redo_;
+    // 上次保存时撤销栈的深度；保存点被新命令覆盖后不可能再回到，置为最大值
+    size_t savedDepth_ = 0;
+};
@@ -0,0 +1,345 @@
+#include "ChartGen.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cstdio>
+#include <string_view>
+#include <type_traits>
+
+namespace {
+struct SplitMix64 {
+    // 跨平台结果一致的小型随机数发生器
+    uint64_t state;
+
+    uint64_t Next() {
+        uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+
+    int Range(int count) {
+        return static_cast<int>(Next() % static_cast<uint64_t>(count));
+    }
+};
+
+int CountLanes(uint32_t mask) {
+    int count = 0;
+    for (; mask != 0; mask &= mask - 1) {
+        ++count;
+    }
+    return count;
+}
+
+int PickLane(SplitMix64& rng, int keyCount, uint32_t exclude) {
+    // 随机选一个不在exclude中的轨道，全被排除时退化为任意轨道
+    int freeCount = 0;
+    for (int lane = 0; lane < keyCount; ++lane) {
+        freeCount += (exclude >> lane) & 1u ? 0 : 1;
+    }
+    if (freeCount == 0) {
+        return rng.Range(keyCount);
+    }
+    int pick = rng.Range(freeCount);
+    for (int lane = 0; lane < keyCount; ++lane) {
+        if ((exclude >> lane) & 1u) {
+            continue;
+        }
+        if (pick-- == 0) {
+            return lane;
+        }
+    }
+    return 0;
+}
+
+double AverageNotesPerRow(ChartPattern pattern) {
+    switch (pattern) {
+        case ChartPattern::Jumpstream:
+            return 1.5;
+        case ChartPattern::Chordjack:
+            return 2.5;
+        default:
+            return 1.0;
+    }
+}
+
+class OutputBuffer {
+public:
+    // 预分配的格式化缓冲，容量不足时按倍数扩容
+    explicit OutputBuffer(size_t capacity) : data_(capacity, '\0') {}
+
+    void Put(const char* text, size_t length) {
+        Ensure(length);
+        std::copy(text, text + length, data_.data() + size_);
+        size_ += length;
+    }
+
+    void Put(std::string_view text) { Put(text.data(), text.size()); }
+
+    void Put(char c) {
+        Ensure(1);
+        data_[size_++] = c;
+    }
+
+    template <typename T>
+    void PutNumber(T value) {
+        Ensure(32);
+        char* first = data_.data() + size_;
+        char* last = data_.data() + data_.size();
+        std::to_chars_result result;
+        if constexpr (std::is_floating_point_v<T>) {
+            // 与ostream默认格式（%g，6位有效数字）一致，输出与改用缓冲之前逐字节相同
+            result = std::to_chars(first, last, value, std::chars_format::general, 6);
+        } else {
+            result = std::to_chars(first, last, value);
+        }
+        size_ = static_cast<size_t>(result.ptr - data_.data());
+    }
+
+    const char* Data() const { return data_.data(); }
+    size_t Size() const { return size_; }
+
+private:
+    void Ensure(size_t extra) {
+        if (size_ + extra > data_.size()) {
+            data_.resize(std::max(data_.size() * 2, size_ + extra));
+        }
+    }
+
+    std::string data_;
+    size_t size_ = 0;
+};
+}
+
+Chart GenerateChart(const ChartGenOptions& options) {
+    // 按段落推进时间，每个时间点生成一行（一个或多个音符）
+    Chart chart;
+    chart.title = "SimpleMania Demo";
+    chart.artist = "CLI Generator";
+    chart.audioFilename = "demo.wav";
+    chart.keyCount = std::clamp(options.keyCount, 1, kMaxLanes);
+    chart.baseBpm = options.bpm;
+
+    SplitMix64 rng{options.seed};
+    int keyCount = chart.keyCount;
+
+    // 变速：把时长等分成若干段，每段BPM为基础BPM乘一个随机系数
+    static const double kBpmFactors[] = {0.75, 0.9, 1.0, 1.2, 1.5};
+    int sectionCount = std::max(0, options.bpmChanges) + 1;
+    std::vector<double> sectionBpm(sectionCount, options.bpm);
+    for (int s = 1; s < sectionCount; ++s) {
+        sectionBpm[s] = options.bpm * kBpmFactors[rng.Range(5)];
+    }
+
+    double minInterval = 60000.0 / (options.bpm * 1.5) / options.density;
+    double estimatedRows = options.durationMs / minInterval;
+    chart.notes.reserve(static_cast<size_t>(estimatedRows * AverageNotesPerRow(options.pattern)) + 16);
+
+    std::vector<int> laneFreeAtMs(keyCount, 0);
+    uint32_t prevMask = 0;
+    int trillA = 0;
+    int trillB = keyCount > 1 ? 1 : 0;
+    uint32_t allLanes = (1u << keyCount) - 1u;
+    long long row = 0;
+    double sectionStart = 0.0;
+    for (int s = 0; s < sectionCount; ++s) {
+        double sectionEnd = static_cast<double>(options.durationMs) * (s + 1) / sectionCount;
+        double beatLength = 60000.0 / sectionBpm[s];
+        double interval = beatLength / options.density;
+
+        TimingPoint point;
+        point.timeMs = static_cast<double>(static_cast<int>(sectionStart));
+        point.beatLengthMs = beatLength;
+        point.meter = 4;
+        chart.timingPoints.push_back(point);
+
+        // 用段内序号乘间隔计算时间，避免浮点累加误差；行数向下取整，与单段时旧的逐音符循环一致
+        long long rowCount = static_cast<long long>((sectionEnd - sectionStart) / interval);
+        for (long long k = 0; k < rowCount; ++k, ++row) {
+            double timeMs = sectionStart + k * interval;
+            int t = static_cast<int>(timeMs);
+            uint32_t mask = 0;
+            int holdEnd = t;
+            switch (options.pattern) {
+                case ChartPattern::Stream:
+                    mask = 1u << (row % keyCount);
+                    break;
+                case ChartPattern::Jumpstream: {
+                    // 双押与单押交替，避免与上一行同轨（无叠键）
+                    int count = (row % 2 == 0) ? std::min(2, keyCount) : 1;
+                    for (int i = 0; i < count; ++i) {
+                        mask |= 1u << PickLane(rng, keyCount, prevMask | mask);
+                    }
+                    break;
+                }
+                case ChartPattern::Chordjack: {
+                    // 2~3押和弦，至少保留一个上一行的轨道形成叠键
+                    int count = std::min(keyCount, 2 + rng.Range(2));
+                    if (prevMask != 0) {
+                        mask |= 1u << PickLane(rng, keyCount, ~prevMask);
+                    }
+                    while (CountLanes(mask) < count) {
+                        mask |= 1u << PickLane(rng, keyCount, mask);
+                    }
+                    break;
+                }
+                case ChartPattern::Trill:
+                    // 两轨交替，每16行换一组
+                    if (row % 16 == 0 && keyCount > 1) {
+                        trillA = rng.Range(keyCount);
+                        trillB = PickLane(rng, keyCount, 1u << trillA);
+                    }
+                    mask = 1u << ((row % 2 == 0) ? trillA : trillB);
+                    break;
+                case ChartPattern::LongNote: {
+                    // 约3/4为长条，长度1~4个间隔，同轨不重叠
+                    uint32_t busy = 0;
+                    for (int lane = 0; lane < keyCount; ++lane) {
+                        if (laneFreeAtMs[lane] > t) {
+                            busy |= 1u << lane;
+                        }
+                    }
+                    if (busy == allLanes) {
+                        break;
+                    }
+                    mask = 1u << PickLane(rng, keyCount, busy | prevMask);
+                    if ((mask & busy) != 0) {
+                        mask = 0;
+                        break;
+                    }
+                    if (rng.Range(4) != 0) {
+                        holdEnd = static_cast<int>(timeMs + interval * (1 + rng.Range(4)));
+                    }
+                    break;
+                }
+            }
+
+            for (int lane = 0; lane < keyCount; ++lane) {
+                if (!((mask >> lane) & 1u)) {
+                    continue;
+                }
+                Note note;
+                note.lane = lane;
+                note.timeMs = t;
+                note.endTimeMs = holdEnd;
+                note.isHold = holdEnd > t;
+                chart.notes.push_back(note);
+                // 长条尾之后留出一个间隔再放同轨音符
+                laneFreeAtMs[lane] = holdEnd + static_cast<int>(interval);
+            }
+            prevMask = mask;
+        }
+        sectionStart += rowCount * interval;
+    }
+
+    // SV变化：随机时间点插入绿线
+    static const double kSvValues[] = {0.5, 0.75, 1.25, 1.5, 2.0};
+    for (int i = 0; i < options.svChanges; ++i) {
+        TimingPoint point;
+        point.timeMs = static_cast<double>(rng.Range(std::max(1, options.durationMs)));
+        point.beatLengthMs = -100.0 / kSvValues[rng.Range(5)];
+        point.meter = 4;
+        point.inherited = true;
+        chart.timingPoints.push_back(point);
+    }
+    std::stable_sort(chart.timingPoints.begin(), chart.timingPoints.end(),
+                     [](const TimingPoint& a, const TimingPoint& b) { return a.timeMs < b.timeMs; });
+    return chart;
+}
+
+bool WriteOsuFile(const std::string& path, const Chart& chart, std::string& error) {
+    // 估算容量后一次性格式化，避免逐行流式输出
+    size_t estimate = 1024 + chart.timingPoints.size() * 64 + chart.notes.size() * 48;
+    OutputBuffer out(estimate);
+
+    out.Put(std::string("osu file format v14\n\n[General]\nAudioFilename: "));
+    out.Put(chart.audioFilename);
+    if (chart.previewTimeMs >= 0) {
+        out.Put(std::string("\nPreviewTime: "));
+        out.PutNumber(chart.previewTimeMs);
+    }
+    out.Put(std::string("\nMode: 3\n\n[Metadata]\nTitle: "));
+    out.Put(chart.title);
+    out.Put(std::string("\nArtist: "));
+    out.Put(chart.artist);
+    out.Put('\n');
+    if (!chart.version.empty()) {
+        out.Put(std::string("Version: "));
+        out.Put(chart.version);
+        out.Put('\n');
+    }
+    out.Put(std::string("\n[Difficulty]\nCircleSize: "));
+    out.PutNumber(chart.keyCount);
+    out.Put(std::string("\nOverallDifficulty: "));
+    out.PutNumber(chart.overallDifficulty);
+    out.Put(std::string("\n\n[TimingPoints]\n"));
+    for (const auto& point : chart.timingPoints) {
+        out.PutNumber(point.timeMs);
+        out.Put(',');
+        out.PutNumber(point.beatLengthMs);
+        out.Put(',');
+        out.PutNumber(point.meter);
+        out.Put(point.inherited ? std::string(",2,0,100,0,0\n") : std::string(",2,0,100,1,0\n"));
+    }
+    out.Put(std::string("\n[HitObjects]\n"));
+
+    // 每个轨道的x坐标只算一次
+    std::vector<int> laneX(std::max(1, chart.keyCount));
+    for (int lane = 0; lane < static_cast<int>(laneX.size()); ++lane) {
+        laneX[lane] = static_cast<int>((lane + 0.5) * 512.0 / chart.keyCount);
+    }
+    for (const auto& note : chart.notes) {
+        int lane = std::clamp(note.lane, 0, static_cast<int>(laneX.size()) - 1);
+        out.PutNumber(laneX[lane]);
+        out.Put(",192,", 5);
+        out.PutNumber(note.timeMs);
+        if (note.isHold) {
+            out.Put(",128,0,", 7);
+            out.PutNumber(note.endTimeMs);
+            out.Put(":0:0:0:0:\n", 10);
+        } else {
+            out.Put(",1,0,0:0:0:0:\n", 14);
+        }
+    }
+
+    std::FILE* file = std::fopen(path.c_str(), "wb");
+    if (!file) {
+        error = "Failed to write output file.";
+        return false;
+    }
+    size_t written = std::fwrite(out.Data(), 1, out.Size(), file);
+    std::fclose(file);
+    if (written != out.Size()) {
+        error = "Failed to write output file.";
+        return false;
+    }
+    return true;
+}
+
+bool ParseChartPattern(const std::string& name, ChartPattern& pattern) {
+    static const ChartPattern kAll[] = {ChartPattern::Stream, ChartPattern::Jumpstream, ChartPattern::Chordjack,
+                                        ChartPattern::Trill, ChartPattern::LongNote};
+    for (ChartPattern candidate : kAll) {
+        if (name == ChartPatternName(candidate)) {
+            pattern = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+const char* ChartPatternName(ChartPattern pattern) {
+    switch (pattern) {
+        case ChartPattern::Stream:
+            return "stream";
+        case ChartPattern::Jumpstream:
+            return "jumpstream";
+        case ChartPattern::Chordjack:
+            return "chordjack";
+        case ChartPattern::Trill:
+            return "trill";
+        case ChartPattern::LongNote:
+            return "ln";
+    }
+    return "";
+}
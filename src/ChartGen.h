@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "Chart.h"
+
+enum class ChartPattern {
+    // 生成图案
+    Stream,
+    Jumpstream,
+    Chordjack,
+    Trill,
+    LongNote
+};
+
+struct ChartGenOptions {
+    // 生成参数：BPM、时长、键数与每拍音符数
+    double bpm = 120.0;
+    int durationMs = 30000;
+    int keyCount = 4;
+    double density = 1.0;
+    ChartPattern pattern = ChartPattern::Stream;
+    // 相同种子与参数得到完全相同的谱面
+    uint64_t seed = 1;
+    // 变速段数（红线）与SV变化数（绿线）
+    int bpmChanges = 0;
+    int svChanges = 0;
+};
+
+// 按参数生成谱面（Stream为轮流落在各轨道的单押）
+Chart GenerateChart(const ChartGenOptions& options);
+
+// 把谱面写成osu!mania文本（整块格式化后一次写出）
+bool WriteOsuFile(const std::string& path, const Chart& chart, std::string& error);
+
+// 图案名与枚举互转，未知名称返回false
+bool ParseChartPattern(const std::string& name, ChartPattern& pattern);
+const char* ChartPatternName(ChartPattern pattern);
@@ -0,0 +1,71 @@
+#include "ChartStream.h"
+
+#include "Profiler.h"
+
+ChartStreamer::~ChartStreamer() {
+    Stop();
+}
+
+bool ChartStreamer::Start(const std::string& path, Chart& header, size_t& expectedNotes, std::string& error) {
+    Stop();
+    if (!stream_.Open(path, header, error)) {
+        return false;
+    }
+    expectedNotes = stream_.GetExpectedNotes();
+    ready_.clear();
+    ready_.reserve(kStreamBatchNotes);
+    finished_ = false;
+    stopping_ = false;
+    parsedNotes_ = 0;
+    worker_ = std::thread([this]() { WorkerLoop(); });
+    return true;
+}
+
+void ChartStreamer::Stop() {
+    if (!worker_.joinable()) {
+        return;
+    }
+    stopping_ = true;
+    worker_.join();
+    std::lock_guard<std::mutex> lock(mutex_);
+    ready_.clear();
+    finished_ = true;
+}
+
+bool ChartStreamer::Take(std::vector<Note>& notes) {
+    notes.clear();
+    std::lock_guard<std::mutex> lock(mutex_);
+    notes.swap(ready_);
+    bool done = finished_;
+    if (done && worker_.joinable()) {
+        // 工作线程置finished_后直接退出、不再拿锁，持锁join不会死锁
+        worker_.join();
+    }
+    return done;
+}
+
+void ChartStreamer::WorkerLoop() {
+    PROFILE_THREAD_NAME("ChartStream");
+    std::vector<Note> batch;
+    batch.reserve(kStreamBatchNotes);
+    while (!stopping_) {
+        batch.clear();
+        size_t parsed;
+        {
+            PROFILE_ZONE("ParseBatch");
+            parsed = stream_.Next(kStreamBatchNotes, batch);
+        }
+        parsedNotes_ += parsed;
+        std::lock_guard<std::mutex> lock(mutex_);
+        // 主线程取走后ready_为空，直接交换；否则追加到未取走的后面
+        if (ready_.empty()) {
+            ready_.swap(batch);
+        } else {
+            ready_.insert(ready_.end(), batch.begin(), batch.end());
+        }
+        if (parsed == 0 || stream_.Done()) {
+            finished_ = true;
+            return;
+        }
+    }
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Chart.h"
+#include "OsuParser.h"
+
+// 每批解析的音符数：主线程每轮最多追加这么多的若干倍，追加耗时远小于一轮输入轮询
+constexpr size_t kStreamBatchNotes = 8192;
+
+class ChartStreamer {
+public:
+    // 超大.osu谱面的后台流式解析：元数据与时间点同步解析后即可开始游玩，
+    // 音符由工作线程按文件顺序逐批解析，主线程每轮取走并追加给Game（Game只在主线程上修改）
+    ChartStreamer() = default;
+    ~ChartStreamer();
+    ChartStreamer(const ChartStreamer&) = delete;
+    ChartStreamer& operator=(const ChartStreamer&) = delete;
+
+    // header返回不含音符的谱面，expectedNotes为[HitObjects]的行数；成功后工作线程开始解析
+    bool Start(const std::string& path, Chart& header, size_t& expectedNotes, std::string& error);
+    // 停止工作线程并丢弃未取走的音符
+    void Stop();
+    bool IsActive() const { return worker_.joinable(); }
+    // 取走已解析的音符（notes先清空，容量交还给工作线程复用）；全部解析完且已取完时返回true
+    bool Take(std::vector<Note>& notes);
+    // 已解析的音符数（含未取走的）
+    size_t GetParsedNotes() const { return parsedNotes_.load(std::memory_order_relaxed); }
+
+private:
+    void WorkerLoop();
+
+    OsuNoteStream stream_;
+    std::thread worker_;
+    std::mutex mutex_;
+    std::vector<Note> ready_;
+    bool finished_ = false;
+    std::atomic<bool> stopping_{false};
+    std::atomic<size_t> parsedNotes_{0};
+};
@@ -0,0 +1,145 @@
+#include "ChartWatcher.h"
+
+#include <algorithm>
+#include <filesystem>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+#include "Package.h"
+#include "Profiler.h"
+
+namespace {
+bool IsChartName(const std::string& name) {
+    std::string extension = std::filesystem::path(name).extension().string();
+    return extension == ".osu" || extension == ".smc";
+}
+
+void AddUnique(std::vector<std::string>& paths, const std::string& path) {
+    if (std::find(paths.begin(), paths.end(), path) == paths.end()) {
+        paths.push_back(path);
+    }
+}
+}
+
+ChartWatcher::~ChartWatcher() {
+    Stop();
+}
+
+#ifdef __linux__
+
+bool ChartWatcher::Start(const std::string& rootPath, std::string& error) {
+    Stop();
+    fd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd_ < 0) {
+        error = "inotify_init1 failed";
+        return false;
+    }
+    rootPath_ = rootPath;
+    // 根目录只关心子目录与.osz包的增删改；库索引也写在根目录，不能触发重载
+    rootWatch_ = inotify_add_watch(fd_, rootPath.c_str(),
+                                   IN_CREATE | IN_DELETE | IN_CLOSE_WRITE | IN_MOVED_FROM | IN_MOVED_TO | IN_ONLYDIR);
+    if (rootWatch_ < 0) {
+        error = "Cannot watch " + rootPath;
+        Stop();
+        return false;
+    }
+    std::error_code iterError;
+    for (const auto& dirEntry : std::filesystem::directory_iterator(rootPath, iterError)) {
+        if (dirEntry.is_directory()) {
+            AddDirectory(dirEntry.path().string());
+        }
+    }
+    return true;
+}
+
+void ChartWatcher::Stop() {
+    if (fd_ >= 0) {
+        close(fd_);
+    }
+    fd_ = -1;
+    rootWatch_ = -1;
+    directories_.clear();
+}
+
+void ChartWatcher::AddDirectory(const std::string& path) {
+    // 外部编辑器多为写临时文件再改名，同时监视写完与移入
+    int watch = inotify_add_watch(fd_, path.c_str(),
+                                  IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE | IN_ONLYDIR);
+    if (watch >= 0) {
+        directories_[watch] = path;
+    }
+}
+
+bool ChartWatcher::Poll(std::vector<std::string>& changedPaths) {
+    if (fd_ < 0) {
+        return true;
+    }
+    PROFILE_ZONE("ChartWatcher::Poll");
+    bool complete = true;
+    alignas(inotify_event) char buffer[4096];
+    while (true) {
+        ssize_t length = read(fd_, buffer, sizeof(buffer));
+        if (length <= 0) {
+            break;
+        }
+        for (ssize_t offset = 0; offset < length;) {
+            const inotify_event* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+            offset += static_cast<ssize_t>(sizeof(inotify_event) + event->len);
+            if (event->mask & IN_Q_OVERFLOW) {
+                complete = false;
+                continue;
+            }
+            if (event->mask & IN_IGNORED) {
+                directories_.erase(event->wd);
+                continue;
+            }
+            std::string name = event->len > 0 ? event->name : "";
+            if (event->wd == rootWatch_) {
+                if (name.empty()) {
+                    continue;
+                }
+                std::string path = rootPath_ + "/" + name;
+                if (!(event->mask & IN_ISDIR)) {
+                    // 包在写完或移入时才算变化，刚创建的空文件跳过
+                    if (IsPackagePath(name) && !(event->mask & IN_CREATE)) {
+                        AddUnique(changedPaths, path);
+                    }
+                    continue;
+                }
+                if (event->mask & (IN_CREATE | IN_MOVED_TO)) {
+                    AddDirectory(path);
+                }
+                AddUnique(changedPaths, path);
+                continue;
+            }
+            auto it = directories_.find(event->wd);
+            if (it != directories_.end() && !(event->mask & IN_ISDIR) && IsChartName(name)) {
+                AddUnique(changedPaths, it->second + "/" + name);
+            }
+        }
+    }
+    return complete;
+}
+
+#else
+
+bool ChartWatcher::Start(const std::string& rootPath, std::string& error) {
+    rootPath_ = rootPath;
+    error = "chart watching needs inotify (Linux only)";
+    return false;
+}
+
+void ChartWatcher::Stop() {
+}
+
+void ChartWatcher::AddDirectory(const std::string&) {
+}
+
+bool ChartWatcher::Poll(std::vector<std::string>&) {
+    return true;
+}
+
+#endif
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class ChartWatcher {
+public:
+    // 用inotify监视谱面库：根目录下的子目录与其中的.osu/.smc文件，以及根目录下的.osz包
+    // （inotify不递归，新建的子目录在Poll时补上监视）。只在Linux上可用，其余平台Start返回false
+    ChartWatcher() = default;
+    ~ChartWatcher();
+    ChartWatcher(const ChartWatcher&) = delete;
+    ChartWatcher& operator=(const ChartWatcher&) = delete;
+
+    bool Start(const std::string& rootPath, std::string& error);
+    void Stop();
+    // 非阻塞：追加自上次以来写完、移入或删除的谱面文件与.osz包路径，以及增删或移动的子目录路径（已去重）；
+    // 事件队列溢出时返回false，调用方应整体重新扫描
+    bool Poll(std::vector<std::string>& changedPaths);
+
+private:
+    void AddDirectory(const std::string& path);
+
+    int fd_ = -1;
+    int rootWatch_ = -1;
+    std::string rootPath_;
+    // 监视描述符 -> 子目录路径
+    std::unordered_map<int, std::string> directories_;
+};
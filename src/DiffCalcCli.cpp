@@ -0,0 +1,41 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#include "Library.h"
+
+int main(int argc, char* argv[]) {
+    // 命令行批量难度计算：扫描整个谱面库并更新库索引
+    std::string rootPath = "assets";
+    int threadCount = 0;
+    bool rebuild = false;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--threads" && i + 1 < argc) {
+            threadCount = std::atoi(argv[++i]);
+        } else if (arg == "--rebuild") {
+            rebuild = true;
+        } else if (arg == "--help" || arg == "-h") {
+            std::printf("Usage: diffcalc [assets_dir] [--threads N] [--rebuild]\n");
+            return 0;
+        } else {
+            rootPath = arg;
+        }
+    }
+
+    std::string indexPath = rootPath + "/library.idx";
+    if (rebuild) {
+        std::remove(indexPath.c_str());
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<ChartEntry> entries = ScanCharts(rootPath, indexPath, threadCount);
+    double elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    for (const auto& entry : entries) {
+        std::printf("%6.2f  %2dK  %8d  %s\n", entry.starRating, entry.keyCount, entry.noteCount, entry.label.c_str());
+    }
+    std::printf("%zu charts in %.1f ms, index: %s\n", entries.size(), elapsedMs, indexPath.c_str());
+    return 0;
+}
@@ -0,0 +1,95 @@
+#include "Difficulty.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <vector>
+
+namespace {
+// 单轨strain衰减快（连打/叠键），跨轨strain衰减慢（整体密度）
+constexpr double kLaneDecayPerSecond = 0.125;
+constexpr double kChordDecayPerSecond = 0.30;
+constexpr double kLaneStrainPerNote = 2.0;
+constexpr double kChordStrainPerNote = 1.0;
+constexpr int kSectionMs = 400;
+constexpr double kSectionWeightDecay = 0.9;
+constexpr double kStarScale = 0.018;
+
+double Decay(double base, int deltaMs) {
+    return std::pow(base, deltaMs / 1000.0);
+}
+}
+
+DifficultyInfo ComputeDifficulty(const Chart& chart) {
+    // 音符已按时间排序；长条尾部与中途的其他音符同时存在时额外加权
+    DifficultyInfo info;
+    const auto& notes = chart.notes;
+    if (notes.empty()) {
+        return info;
+    }
+    int keyCount = std::clamp(chart.keyCount, 1, kMaxLanes);
+
+    std::array<double, kMaxLanes> laneStrain{};
+    std::array<int, kMaxLanes> laneLastMs{};
+    std::array<int, kMaxLanes> holdEndMs{};
+    double chordStrain = 0.0;
+    int chordLastMs = notes.front().timeMs;
+
+    std::vector<double> sectionPeaks;
+    int sectionStart = notes.front().timeMs;
+    double sectionPeak = 0.0;
+
+    for (const auto& note : notes) {
+        int lane = std::clamp(note.lane, 0, keyCount - 1);
+        // 跨过窗口边界时把当前窗口峰值收下，空窗口按衰减后的值计
+        while (note.timeMs >= sectionStart + kSectionMs) {
+            sectionPeaks.push_back(sectionPeak);
+            sectionStart += kSectionMs;
+            double decayedChord = chordStrain * Decay(kChordDecayPerSecond, sectionStart - chordLastMs);
+            double decayedLane = 0.0;
+            for (int l = 0; l < keyCount; ++l) {
+                decayedLane = std::max(decayedLane,
+                                       laneStrain[l] * Decay(kLaneDecayPerSecond, sectionStart - laneLastMs[l]));
+            }
+            sectionPeak = decayedChord + decayedLane;
+        }
+
+        // 同时按住的长条越多，新音符越难
+        double holdFactor = 1.0;
+        for (int l = 0; l < keyCount; ++l) {
+            if (l != lane && holdEndMs[l] > note.timeMs) {
+                holdFactor += 0.25;
+            }
+        }
+
+        laneStrain[lane] = laneStrain[lane] * Decay(kLaneDecayPerSecond, note.timeMs - laneLastMs[lane]) +
+                           kLaneStrainPerNote * holdFactor;
+        laneLastMs[lane] = note.timeMs;
+        if (note.isHold) {
+            holdEndMs[lane] = note.endTimeMs;
+        }
+        chordStrain = chordStrain * Decay(kChordDecayPerSecond, note.timeMs - chordLastMs) +
+                      kChordStrainPerNote * holdFactor;
+        chordLastMs = note.timeMs;
+
+        info.laneStrain[lane] = std::max(info.laneStrain[lane], laneStrain[lane]);
+        info.chordStrain = std::max(info.chordStrain, chordStrain);
+        sectionPeak = std::max(sectionPeak, laneStrain[lane] + chordStrain);
+    }
+    sectionPeaks.push_back(sectionPeak);
+
+    // 峰值从高到低按0.9^i加权
+    std::sort(sectionPeaks.begin(), sectionPeaks.end(), std::greater<double>());
+    double weight = 1.0;
+    double total = 0.0;
+    for (double peak : sectionPeaks) {
+        total += peak * weight;
+        weight *= kSectionWeightDecay;
+    }
+    info.peakStrain = sectionPeaks.front();
+    info.starRating = total * kStarScale;
+
+    int spanMs = std::max(1, notes.back().timeMs - notes.front().timeMs);
+    info.notesPerSecond = notes.size() * 1000.0 / spanMs;
+    return info;
+}
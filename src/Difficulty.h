@@ -0,0 +1,17 @@
+#pragma once
+
+#include <array>
+
+#include "Chart.h"
+
+struct DifficultyInfo {
+    // 难度结果：星级、各轨道与跨轨道的峰值strain
+    double starRating = 0.0;
+    double peakStrain = 0.0;
+    double chordStrain = 0.0;
+    std::array<double, kMaxLanes> laneStrain{};
+    double notesPerSecond = 0.0;
+};
+
+// 在音符数组上按400ms窗口计算strain，取各窗口峰值加权求和得到星级
+DifficultyInfo ComputeDifficulty(const Chart& chart);
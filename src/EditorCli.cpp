@@ -1,62 +1,74 @@
+#include <chrono>
 #include <cstdlib>
-#include <fstream>
 #include <iostream>
 #include <string>
 
+#include "ChartBinary.h"
+#include "ChartGen.h"
+
 int main(int argc, char* argv[]) {
     // 命令行谱面生成器
     if (argc < 6) {
-        std::cout << "Usage: chartgen <bpm> <duration_ms> <key_count> <density> <output.osu>\n";
-        std::cout << "Example: chartgen 120 30000 4 2 demo.osu\n";
+        std::cout << "Usage: chartgen <bpm> <duration_ms> <key_count> <density> <output.osu|output.smc> [options]\n";
+        std::cout << "Options:\n";
+        std::cout << "  --pattern <stream|jumpstream|chordjack|trill|ln>  (default stream)\n";
+        std::cout << "  --seed <n>          random seed, same seed gives identical output (default 1)\n";
+        std::cout << "  --bpm-changes <n>   split the chart into n+1 sections with different BPM\n";
+        std::cout << "  --sv-changes <n>    insert n random scroll velocity points\n";
+        std::cout << "Example: chartgen 120 30000 4 2 demo.osu --pattern jumpstream --seed 42\n";
         return 1;
     }
 
-    double bpm = std::atof(argv[1]);
-    int durationMs = std::atoi(argv[2]);
-    int keyCount = std::atoi(argv[3]);
-    double density = std::atof(argv[4]);
+    ChartGenOptions options;
+    options.bpm = std::atof(argv[1]);
+    options.durationMs = std::atoi(argv[2]);
+    options.keyCount = std::atoi(argv[3]);
+    options.density = std::atof(argv[4]);
     std::string outputPath = argv[5];
 
-    if (bpm <= 0.0 || durationMs <= 0 || keyCount <= 0 || density <= 0.0) {
-        std::cout << "Invalid arguments.\n";
-        return 1;
+    for (int i = 6; i < argc; ++i) {
+        std::string flag = argv[i];
+        if (i + 1 >= argc) {
+            std::cout << "Missing value for " << flag << "\n";
+            return 1;
+        }
+        std::string value = argv[++i];
+        if (flag == "--pattern") {
+            if (!ParseChartPattern(value, options.pattern)) {
+                std::cout << "Unknown pattern: " << value << "\n";
+                return 1;
+            }
+        } else if (flag == "--seed") {
+            options.seed = std::strtoull(value.c_str(), nullptr, 10);
+        } else if (flag == "--bpm-changes") {
+            options.bpmChanges = std::atoi(value.c_str());
+        } else if (flag == "--sv-changes") {
+            options.svChanges = std::atoi(value.c_str());
+        } else {
+            std::cout << "Unknown option: " << flag << "\n";
+            return 1;
+        }
     }
 
-    double beatLength = 60000.0 / bpm;
-    double interval = beatLength / density;
-    int noteCount = static_cast<int>(durationMs / interval);
-
-    std::ofstream out(outputPath);
-    if (!out.is_open()) {
-        std::cout << "Failed to write output file.\n";
+    if (options.bpm <= 0.0 || options.durationMs <= 0 || options.keyCount <= 0 ||
+        options.keyCount > kMaxLanes || options.density <= 0.0) {
+        std::cout << "Invalid arguments.\n";
         return 1;
     }
 
-    out << "osu file format v14\n\n";
-    out << "[General]\n";
-    out << "AudioFilename: demo.wav\n";
-    out << "Mode: 3\n\n";
-    out << "[Metadata]\n";
-    out << "Title: SimpleMania Demo\n";
-    out << "Artist: CLI Generator\n\n";
-    out << "[Difficulty]\n";
-    out << "CircleSize: " << keyCount << "\n";
-    out << "OverallDifficulty: 5\n\n";
-    out << "[TimingPoints]\n";
-    out << "0," << beatLength << ",4,2,0,100,1,0\n\n";
-    out << "[HitObjects]\n";
-
-    int lane = 0;
-    for (int i = 0; i < noteCount; ++i) {
-        int timeMs = static_cast<int>(i * interval);
-        int x = static_cast<int>((lane + 0.5) * 512.0 / keyCount);
-        int y = 192;
-        int type = 1;
-        int hitSound = 0;
-        out << x << ',' << y << ',' << timeMs << ',' << type << ',' << hitSound << ",0:0:0:0:\n";
-        lane = (lane + 1) % keyCount;
+    auto start = std::chrono::steady_clock::now();
+    Chart chart = GenerateChart(options);
+    std::string error;
+    // .smc输出为二进制打包格式，其余为osu文本
+    bool written = IsChartBinaryPath(outputPath) ? WriteChartBinary(outputPath, chart, error)
+                                                 : WriteOsuFile(outputPath, chart, error);
+    if (!written) {
+        std::cout << error << "\n";
+        return 1;
     }
+    double elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
 
-    std::cout << "Generated: " << outputPath << "\n";
+    std::cout << "Generated: " << outputPath << " (" << chart.notes.size() << " notes, "
+              << ChartPatternName(options.pattern) << ", " << elapsedMs << " ms)\n";
     return 0;
 }
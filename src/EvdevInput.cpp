@@ -0,0 +1,254 @@
+#include "EvdevInput.h"
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <string_view>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <linux/input.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <ctime>
+#endif
+
+#include "Profiler.h"
+
+double MonotonicNowMs() {
+    // Linux上steady_clock即CLOCK_MONOTONIC
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+EvdevInput::~EvdevInput() {
+    Stop();
+}
+
+#ifdef __linux__
+
+// 旧内核头没有这两个宏，64位下字段相同
+#ifndef input_event_sec
+#define input_event_sec time.tv_sec
+#define input_event_usec time.tv_usec
+#endif
+
+namespace {
+struct UsagePair {
+    int code;
+    int usage;
+};
+
+// 字母与数字之外用得到的键
+constexpr UsagePair kOtherKeys[] = {
+    {KEY_ENTER, 40},     {KEY_ESC, 41},        {KEY_BACKSPACE, 42}, {KEY_TAB, 43},       {KEY_SPACE, 44},
+    {KEY_MINUS, 45},     {KEY_EQUAL, 46},      {KEY_LEFTBRACE, 47}, {KEY_RIGHTBRACE, 48}, {KEY_BACKSLASH, 49},
+    {KEY_SEMICOLON, 51}, {KEY_APOSTROPHE, 52}, {KEY_GRAVE, 53},     {KEY_COMMA, 54},     {KEY_DOT, 55},
+    {KEY_SLASH, 56},     {KEY_RIGHT, 79},      {KEY_LEFT, 80},      {KEY_DOWN, 81},      {KEY_UP, 82},
+    {KEY_LEFTCTRL, 224}, {KEY_LEFTSHIFT, 225}, {KEY_LEFTALT, 226},  {KEY_RIGHTCTRL, 228}, {KEY_RIGHTSHIFT, 229},
+    {KEY_RIGHTALT, 230},
+};
+
+bool TestBit(const unsigned char* bits, int bit) {
+    return (bits[bit / 8] >> (bit % 8)) & 1;
+}
+
+// 能产生字母键的才当作键盘（排除电源键、鼠标等只有少量按键的设备）
+bool IsKeyboard(int fd) {
+    unsigned char keyBits[KEY_MAX / 8 + 1] = {};
+    if (ioctl(fd, EVIOCGBIT(EV_KEY, sizeof(keyBits)), keyBits) < 0) {
+        return false;
+    }
+    return TestBit(keyBits, KEY_A) && TestBit(keyBits, KEY_Z) && TestBit(keyBits, KEY_SPACE);
+}
+
+std::string DeviceName(int fd) {
+    char name[256] = {};
+    if (ioctl(fd, EVIOCGNAME(sizeof(name) - 1), name) < 0) {
+        return std::string();
+    }
+    return name;
+}
+}
+
+int EvdevKeyToUsage(int code) {
+    // evdev按QWERTY物理位置编号：QWERTYUIOP、ASDFGHJKL、ZXCVBNM三排各自连续
+    static const std::string_view rows[] = {"QWERTYUIOP", "ASDFGHJKL", "ZXCVBNM"};
+    static const int rowStart[] = {KEY_Q, KEY_A, KEY_Z};
+    for (int row = 0; row < 3; ++row) {
+        int index = code - rowStart[row];
+        if (index >= 0 && index < static_cast<int>(rows[row].size())) {
+            return 4 + (rows[row][index] - 'A');
+        }
+    }
+    // KEY_1..KEY_0连续，用法码同样是1..9、0
+    if (code >= KEY_1 && code <= KEY_0) {
+        return 30 + (code - KEY_1);
+    }
+    for (const UsagePair& pair : kOtherKeys) {
+        if (pair.code == code) {
+            return pair.usage;
+        }
+    }
+    return 0;
+}
+
+bool EvdevInput::Start(std::string& error, const std::string& deviceName) {
+    Stop();
+    std::error_code ec;
+    std::vector<std::string> paths;
+    for (const auto& entry : std::filesystem::directory_iterator("/dev/input", ec)) {
+        std::string name = entry.path().filename().string();
+        if (name.compare(0, 5, "event") == 0) {
+            paths.push_back(entry.path().string());
+        }
+    }
+    if (ec) {
+        error = "cannot list /dev/input";
+        return false;
+    }
+    std::sort(paths.begin(), paths.end());
+    int denied = 0;
+    for (const std::string& path : paths) {
+        int fd = open(path.c_str(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+        if (fd < 0) {
+            denied += errno == EACCES ? 1 : 0;
+            continue;
+        }
+        // 默认是CLOCK_REALTIME，换成单调时钟才能与计时器对齐
+        int clockId = CLOCK_MONOTONIC;
+        bool wanted = deviceName.empty() ? IsKeyboard(fd) : DeviceName(fd) == deviceName;
+        if (!wanted || ioctl(fd, EVIOCSCLOCKID, &clockId) < 0) {
+            close(fd);
+            continue;
+        }
+        devices_.push_back(fd);
+    }
+    if (devices_.empty()) {
+        error = denied > 0 ? "no permission to read /dev/input/event* (join the input group)"
+                           : "no keyboard found under /dev/input";
+        return false;
+    }
+    wakeFd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wakeFd_ < 0) {
+        error = "eventfd failed";
+        Stop();
+        return false;
+    }
+    pending_.clear();
+    running_.store(true, std::memory_order_release);
+    worker_ = std::thread([this]() { WorkerLoop(); });
+    return true;
+}
+
+void EvdevInput::Stop() {
+    running_.store(false, std::memory_order_release);
+    if (worker_.joinable()) {
+        uint64_t one = 1;
+        [[maybe_unused]] ssize_t written = write(wakeFd_, &one, sizeof(one));
+        worker_.join();
+    }
+    for (int fd : devices_) {
+        close(fd);
+    }
+    devices_.clear();
+    if (wakeFd_ >= 0) {
+        close(wakeFd_);
+        wakeFd_ = -1;
+    }
+}
+
+void EvdevInput::Poll(std::vector<EvdevKeyEvent>& events) {
+    events.clear();
+    std::lock_guard<std::mutex> lock(mutex_);
+    events.swap(pending_);
+}
+
+void EvdevInput::WorkerLoop() {
+    PROFILE_THREAD_NAME("Evdev");
+    // 无论因何退出都清掉运行标志，主线程据此退回SDL键盘状态
+    struct ClearRunning {
+        std::atomic<bool>& running;
+        ~ClearRunning() { running.store(false, std::memory_order_release); }
+    } clearRunning{running_};
+    // 最后一项是唤醒用的eventfd；断开的设备把fd置为-1，poll会跳过
+    std::vector<pollfd> fds;
+    for (int fd : devices_) {
+        fds.push_back(pollfd{fd, POLLIN, 0});
+    }
+    fds.push_back(pollfd{wakeFd_, POLLIN, 0});
+    int openDevices = static_cast<int>(devices_.size());
+    input_event buffer[64];
+    std::vector<EvdevKeyEvent> batch;
+    while (openDevices > 0) {
+        if (poll(fds.data(), fds.size(), -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return;
+        }
+        if (fds.back().revents) {
+            return;
+        }
+        batch.clear();
+        for (size_t i = 0; i + 1 < fds.size(); ++i) {
+            if (fds[i].fd < 0 || !fds[i].revents) {
+                continue;
+            }
+            ssize_t bytes = read(fds[i].fd, buffer, sizeof(buffer));
+            if ((bytes < 0 && errno != EAGAIN && errno != EINTR) || (fds[i].revents & (POLLERR | POLLHUP))) {
+                // 设备被拔出（ENODEV）：不再等待它
+                fds[i].fd = -1;
+                --openDevices;
+                continue;
+            }
+            int count = bytes > 0 ? static_cast<int>(bytes / sizeof(input_event)) : 0;
+            for (int k = 0; k < count; ++k) {
+                const input_event& event = buffer[k];
+                // value为2是自动重复，判定只看按下与松开
+                if (event.type != EV_KEY || event.value > 1) {
+                    continue;
+                }
+                int usage = EvdevKeyToUsage(event.code);
+                if (usage == 0) {
+                    continue;
+                }
+                EvdevKeyEvent key;
+                key.timeMs = event.input_event_sec * 1000.0 + event.input_event_usec / 1000.0;
+                key.usage = usage;
+                key.pressed = event.value == 1;
+                batch.push_back(key);
+            }
+        }
+        if (!batch.empty()) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            pending_.insert(pending_.end(), batch.begin(), batch.end());
+        }
+    }
+}
+
+#else
+
+int EvdevKeyToUsage(int) {
+    return 0;
+}
+
+bool EvdevInput::Start(std::string& error, const std::string&) {
+    error = "raw keyboard input needs evdev (Linux only)";
+    return false;
+}
+
+void EvdevInput::Stop() {
+}
+
+void EvdevInput::Poll(std::vector<EvdevKeyEvent>& events) {
+    events.clear();
+}
+
+void EvdevInput::WorkerLoop() {
+}
+
+#endif
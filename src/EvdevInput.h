@@ -0,0 +1,49 @@
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct EvdevKeyEvent {
+    // 内核给事件打的时间（CLOCK_MONOTONIC，毫秒）与键的USB HID用法码（与SDL_Scancode取值相同）
+    double timeMs = 0.0;
+    int usage = 0;
+    bool pressed = false;
+};
+
+// evdev键码（KEY_*）转USB HID用法码，没有对应的返回0
+int EvdevKeyToUsage(int code);
+// CLOCK_MONOTONIC的当前时间（毫秒），与EvdevKeyEvent::timeMs同一时钟
+double MonotonicNowMs();
+
+class EvdevInput {
+public:
+    // 直接读/dev/input/event*的键盘事件：独立线程阻塞等待，事件带内核时间戳，不经过窗口系统的事件队列。
+    // 需要对设备节点有读权限（通常是input组）；只在Linux上可用，其余平台Start返回false
+    EvdevInput() = default;
+    ~EvdevInput();
+    EvdevInput(const EvdevInput&) = delete;
+    EvdevInput& operator=(const EvdevInput&) = delete;
+
+    // 打开所有带字母键的设备；deviceName非空时只打开设备名与之相同的（延迟测试用）
+    bool Start(std::string& error, const std::string& deviceName = std::string());
+    void Stop();
+    // 工作线程出错退出或所有设备都已断开后返回false，调用方改用其他输入
+    bool IsActive() const { return running_.load(std::memory_order_acquire); }
+    int GetDeviceCount() const { return static_cast<int>(devices_.size()); }
+    // 非阻塞：取走自上次以来的按下与松开事件（按读到的顺序，不含自动重复），events先清空
+    void Poll(std::vector<EvdevKeyEvent>& events);
+
+private:
+    void WorkerLoop();
+
+    std::vector<int> devices_;
+    // 写入即唤醒阻塞在poll里的工作线程，用于停止
+    int wakeFd_ = -1;
+    std::thread worker_;
+    std::atomic<bool> running_{false};
+    std::mutex mutex_;
+    std::vector<EvdevKeyEvent> pending_;
+};
@@ -1,135 +1,454 @@
 #include "Game.h"
 
 #include <algorithm>
+#include <climits>
+#include <cmath>
+#include <iterator>
+#include <numeric>
+#include <tuple>
+#include <utility>
 
-void Game::LoadChart(const Chart& chart) {
-    // 复制谱面数据并建立轨道索引
-    notes_ = chart.notes;
-    keyCount_ = std::max(1, chart.keyCount);
+#include "Profiler.h"
+
+namespace {
+// 统计快照间隔（判定记录条数）：跳转最多重放这么多条记录
+constexpr size_t kStatsCheckpointInterval = 256;
+// 判定记录相对音符时间的乱序余量（窗口之外再留出卡顿的余地）
+constexpr int kSeekSlackMs = 1000;
+}
+
+void Game::ResetForChart(size_t expectedNotes) {
+    keyCount_ = std::clamp(chart_.keyCount, 1, kMaxLanes);
     stats_ = GameStats();
-    stats_.totalNotes = static_cast<int>(notes_.size());
+    stats_.totalNotes = static_cast<int>(expectedNotes);
+    // 判定表每张谱面只计算一次
+    judgeTable_ = BuildJudgeTable(judgePreset_, chart_.overallDifficulty);
+    stats_.hitError.histogramRangeMs = judgeTable_.HitWindowMs();
+    // 每个音符只判定一次，预分配后游玩中不再分配内存
+    hitRecords_.clear();
+    hitRecords_.reserve(expectedNotes);
+    checkpoints_.clear();
+    checkpoints_.reserve(expectedNotes / kStatsCheckpointInterval + 1);
+    checkpoints_.push_back(stats_);
+    judgeEventFirst_ = judgeEventEnd_;
+    for (auto& lane : lanes_) {
+        lane = LaneState();
+    }
+    nextNoteMs_.fill(INT_MAX);
+    chartEndMs_ = 0;
+    streaming_ = false;
+}
+
+void Game::LoadChart(Chart&& chart) {
+    // 接管谱面后把音符按轨道打包，并初始化判定表与统计
+    PROFILE_ZONE("Game::LoadChart");
+    chart_ = std::move(chart);
+    const ArenaVector<Note>& notes = chart_.notes;
+    ResetForChart(notes.size());
 
-    std::sort(notes_.begin(), notes_.end(), [](const Note& a, const Note& b) {
-        return a.timeMs < b.timeMs;
+    // 只排序下标，不复制整个音符数组
+    std::vector<uint32_t> order(notes.size());
+    std::iota(order.begin(), order.end(), 0u);
+    std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+        return notes[a].timeMs < notes[b].timeMs;
     });
 
-    laneIndices_.assign(keyCount_, {});
-    for (size_t i = 0; i < notes_.size(); ++i) {
-        int lane = notes_[i].lane;
-        if (lane < 0) {
-            lane = 0;
-        } else if (lane >= keyCount_) {
-            lane = keyCount_ - 1;
-        }
-        notes_[i].lane = lane;
-        laneIndices_[lane].push_back(static_cast<int>(i));
+    std::array<size_t, kMaxLanes> laneSizes{};
+    for (const Note& note : notes) {
+        laneSizes[std::clamp(note.lane, 0, keyCount_ - 1)] += 1;
+    }
+    for (int lane = 0; lane < keyCount_; ++lane) {
+        lanes_[lane].notes.Reserve(laneSizes[lane]);
     }
 
-    laneCursor_.assign(keyCount_, 0);
+    for (uint32_t index : order) {
+        Note note = notes[index];
+        note.lane = std::clamp(note.lane, 0, keyCount_ - 1);
+        chartEndMs_ = std::max(chartEndMs_, std::max(note.timeMs, note.endTimeMs));
+        lanes_[note.lane].notes.Append(note);
+    }
+    for (int lane = 0; lane < keyCount_; ++lane) {
+        RefreshNextNote(lane);
+    }
 }
 
-void Game::Update(int nowMs) {
-    // 超过Good窗口未击中则判Miss
+void Game::BeginStream(Chart&& header, size_t expectedNotes) {
+    PROFILE_ZONE("Game::BeginStream");
+    chart_ = std::move(header);
+    chart_.notes.clear();
+    chart_.notes.reserve(expectedNotes);
+    ResetForChart(expectedNotes);
+    size_t perLane = expectedNotes / static_cast<size_t>(keyCount_) + kPackedBlockSize;
     for (int lane = 0; lane < keyCount_; ++lane) {
-        auto& cursor = laneCursor_[lane];
-        auto& indices = laneIndices_[lane];
-        while (cursor < indices.size()) {
-            int idx = indices[cursor];
-            Note& note = notes_[idx];
-            if (note.judged) {
-                ++cursor;
-                continue;
-            }
-            if (nowMs - note.timeMs > goodWindowMs_) {
-                ApplyJudge(note, JudgeGrade::Miss, nowMs);
-                ++cursor;
-                continue;
+        lanes_[lane].notes.Reserve(perLane);
+    }
+    streaming_ = true;
+}
+
+void Game::AppendNotes(std::vector<Note>& notes) {
+    PROFILE_ZONE("Game::AppendNotes");
+    std::stable_sort(notes.begin(), notes.end(), [](const Note& a, const Note& b) { return a.timeMs < b.timeMs; });
+    uint32_t touched = 0;
+    for (Note note : notes) {
+        note.lane = std::clamp(note.lane, 0, keyCount_ - 1);
+        LaneState& state = lanes_[note.lane];
+        touched |= 1u << note.lane;
+        // 比轨道末尾更早的先攒起来，每条轨道每批只重新打包一次
+        if (!state.notes.Empty() && note.timeMs < state.notes.LastTimeMs()) {
+            lateNotes_[note.lane].push_back(note);
+            continue;
+        }
+        state.notes.Append(note);
+        chart_.notes.push_back(note);
+        chartEndMs_ = std::max(chartEndMs_, std::max(note.timeMs, note.endTimeMs));
+    }
+    for (int lane = 0; lane < keyCount_; ++lane) {
+        std::vector<Note>& late = lateNotes_[lane];
+        if (!late.empty()) {
+            MergeLateNotes(lane, late);
+            for (const Note& note : late) {
+                chart_.notes.push_back(note);
+                chartEndMs_ = std::max(chartEndMs_, std::max(note.timeMs, note.endTimeMs));
             }
-            break;
+            late.clear();
+        }
+        if (touched & (1u << lane)) {
+            // 游标所在的块可能刚被补全，解码缓存作废
+            lanes_[lane].windowBlock = static_cast<size_t>(-1);
+            RefreshNextNote(lane);
         }
     }
 }
 
-JudgeGrade Game::HandleInput(int lane, int nowMs) {
-    // 在对应轨道寻找最近未判定音符
-    if (lane < 0 || lane >= keyCount_) {
-        return JudgeGrade::None;
+void Game::MergeLateNotes(int lane, std::vector<Note>& late) {
+    auto timeLess = [](const Note& a, const Note& b) { return a.timeMs < b.timeMs; };
+    PackedNoteList& packed = lanes_[lane].notes;
+    std::vector<Note> laneNotes(packed.Size());
+    packed.Decode(0, laneNotes.size(), laneNotes.data());
+    // 插入位置落在判定游标之前的来不及判定，丢弃
+    size_t cursor = lanes_[lane].cursor;
+    late.erase(std::remove_if(late.begin(), late.end(),
+                              [&](const Note& note) {
+                                  auto position = std::upper_bound(laneNotes.begin(), laneNotes.end(), note, timeLess);
+                                  return static_cast<size_t>(position - laneNotes.begin()) < cursor;
+                              }),
+               late.end());
+    if (late.empty()) {
+        return;
+    }
+    // 时间相同时已有的音符在前，与整张解析后稳定排序的结果一致
+    std::vector<Note> merged;
+    merged.reserve(laneNotes.size() + late.size());
+    std::merge(laneNotes.begin(), laneNotes.end(), late.begin(), late.end(), std::back_inserter(merged), timeLess);
+    packed.Clear();
+    packed.Reserve(merged.size());
+    for (const Note& note : merged) {
+        packed.Append(note);
     }
+}
 
-    auto& cursor = laneCursor_[lane];
-    auto& indices = laneIndices_[lane];
-    while (cursor < indices.size()) {
-        int idx = indices[cursor];
-        Note& note = notes_[idx];
-        if (note.judged) {
-            ++cursor;
-            continue;
+void Game::FinishStream() {
+    // [HitObjects]里可能有解析不了的行，总数以实际追加的为准（快照里的总数一并修正）
+    streaming_ = false;
+    stats_.totalNotes = static_cast<int>(chart_.notes.size());
+    for (GameStats& checkpoint : checkpoints_) {
+        checkpoint.totalNotes = stats_.totalNotes;
+    }
+}
+
+ChartReloadResult Game::ReloadChart(Chart&& chart, int nowMs) {
+    PROFILE_ZONE("Game::ReloadChart");
+    ChartReloadResult result;
+    // 新旧音符各自排序后归并，统计增删
+    auto noteLess = [](const Note& a, const Note& b) {
+        return std::tie(a.lane, a.timeMs, a.endTimeMs) < std::tie(b.lane, b.timeMs, b.endTimeMs);
+    };
+    std::vector<Note> oldNotes(chart_.notes.begin(), chart_.notes.end());
+    std::vector<Note> newNotes(chart.notes.begin(), chart.notes.end());
+    std::sort(oldNotes.begin(), oldNotes.end(), noteLess);
+    std::sort(newNotes.begin(), newNotes.end(), noteLess);
+    size_t oldIndex = 0;
+    size_t newIndex = 0;
+    while (oldIndex < oldNotes.size() || newIndex < newNotes.size()) {
+        if (newIndex == newNotes.size() ||
+            (oldIndex < oldNotes.size() && noteLess(oldNotes[oldIndex], newNotes[newIndex]))) {
+            ++result.removedNotes;
+            ++oldIndex;
+        } else if (oldIndex == oldNotes.size() || noteLess(newNotes[newIndex], oldNotes[oldIndex])) {
+            ++result.addedNotes;
+            ++newIndex;
+        } else {
+            ++result.keptNotes;
+            ++oldIndex;
+            ++newIndex;
         }
+    }
 
-        int delta = nowMs - note.timeMs;
-        int absDelta = delta < 0 ? -delta : delta;
-        if (delta < -goodWindowMs_) {
-            return JudgeGrade::None;
+    // 判定记录只按轨道与音符时间对应（长条改长短不影响已判定的头），每个新音符最多认领一条
+    int newKeyCount = std::clamp(chart.keyCount, 1, kMaxLanes);
+    std::vector<std::pair<int, int>> claimable;
+    claimable.reserve(newNotes.size());
+    for (const Note& note : newNotes) {
+        claimable.emplace_back(std::clamp(note.lane, 0, newKeyCount - 1), note.timeMs);
+    }
+    std::sort(claimable.begin(), claimable.end());
+    std::vector<char> claimed(claimable.size(), 0);
+    std::vector<HitRecord> kept;
+    kept.reserve(hitRecords_.size());
+    for (const HitRecord& record : hitRecords_) {
+        std::pair<int, int> key(record.lane, record.noteTimeMs);
+        auto it = std::lower_bound(claimable.begin(), claimable.end(), key);
+        size_t index = static_cast<size_t>(it - claimable.begin());
+        while (index < claimable.size() && claimable[index] == key && claimed[index]) {
+            ++index;
         }
-        if (absDelta <= perfectWindowMs_) {
-            ApplyJudge(note, JudgeGrade::Perfect, nowMs);
-            ++cursor;
-            return JudgeGrade::Perfect;
+        if (index < claimable.size() && claimable[index] == key) {
+            claimed[index] = 1;
+            kept.push_back(record);
         }
-        if (absDelta <= goodWindowMs_) {
-            ApplyJudge(note, JudgeGrade::Good, nowMs);
-            ++cursor;
-            return JudgeGrade::Good;
+    }
+    result.keptJudgements = static_cast<int>(kept.size());
+
+    LoadChart(std::move(chart));
+    std::array<size_t, kMaxLanes> judgedEnd{};
+    for (const HitRecord& record : kept) {
+        Note note;
+        note.timeMs = record.noteTimeMs;
+        note.lane = record.lane;
+        ApplyJudge(note, record.grade, record.noteTimeMs + record.offsetMs, record.offsetMs);
+        size_t after = lanes_[record.lane].notes.LowerBound(record.noteTimeMs) + 1;
+        judgedEnd[record.lane] = std::max(judgedEnd[record.lane], after);
+    }
+    // 游标越过已判定的音符与早于Miss窗口的音符
+    for (int lane = 0; lane < keyCount_; ++lane) {
+        size_t missed = lanes_[lane].notes.LowerBound(nowMs - judgeTable_.missWindowMs);
+        lanes_[lane].cursor = std::max(judgedEnd[lane], missed);
+        RefreshNextNote(lane);
+    }
+    stats_.lastJudge = JudgeGrade::None;
+    stats_.lastJudgeTimeMs = -999999;
+    judgeEventFirst_ = judgeEventEnd_;
+    return result;
+}
+
+void Game::Unload() {
+    // 谱面arena整块释放，打包音符与判定记录归还内存
+    chart_ = Chart();
+    for (auto& lane : lanes_) {
+        lane = LaneState();
+    }
+    nextNoteMs_.fill(INT_MAX);
+    std::vector<HitRecord>().swap(hitRecords_);
+    std::vector<GameStats>().swap(checkpoints_);
+    judgeEventFirst_ = judgeEventEnd_;
+    stats_ = GameStats();
+    chartEndMs_ = 0;
+    streaming_ = false;
+}
+
+const Note& Game::CursorNote(LaneState& lane) {
+    // 游标跨块时整块解码，块内访问不再做差分累加
+    size_t block = lane.cursor / kPackedBlockSize;
+    if (block != lane.windowBlock) {
+        lane.notes.Decode(block * kPackedBlockSize, kPackedBlockSize, lane.window.data());
+        lane.windowBlock = block;
+    }
+    return lane.window[lane.cursor % kPackedBlockSize];
+}
+
+void Game::RefreshNextNote(int lane) {
+    LaneState& state = lanes_[lane];
+    nextNoteMs_[lane] = state.cursor < state.notes.Size() ? CursorNote(state).timeMs : INT_MAX;
+}
+
+void Game::SweepMisses(int nowMs) {
+    // 先把所有轨道的下一音符时间与截止时间比较一遍，绝大多数轮次没有超时音符，直接返回
+    const int keyCount = keyCount_;
+    const int deadlineMs = nowMs - judgeTable_.HitWindowMs();
+    int due = 0;
+    for (int lane = 0; lane < keyCount; ++lane) {
+        due |= static_cast<int>(nextNoteMs_[lane] < deadlineMs);
+    }
+    if (due == 0) {
+        return;
+    }
+    for (int lane = 0; lane < keyCount; ++lane) {
+        LaneState& state = lanes_[lane];
+        while (nextNoteMs_[lane] < deadlineMs) {
+            const Note& note = CursorNote(state);
+            ApplyJudge(note, JudgeGrade::Miss, nowMs, nowMs - note.timeMs);
+            ++state.cursor;
+            RefreshNextNote(lane);
         }
-        if (delta > goodWindowMs_) {
-            ApplyJudge(note, JudgeGrade::Miss, nowMs);
-            ++cursor;
-            return JudgeGrade::Miss;
+    }
+}
+
+void Game::SweepMissesReference(int nowMs) {
+    // 每轮每条轨道都解码游标音符再比较
+    const int hitWindowMs = judgeTable_.HitWindowMs();
+    for (int lane = 0; lane < keyCount_; ++lane) {
+        LaneState& state = lanes_[lane];
+        while (state.cursor < state.notes.Size()) {
+            const Note& note = CursorNote(state);
+            if (nowMs - note.timeMs <= hitWindowMs) {
+                break;
+            }
+            ApplyJudge(note, JudgeGrade::Miss, nowMs, nowMs - note.timeMs);
+            ++state.cursor;
+            RefreshNextNote(lane);
         }
+    }
+}
+
+void Game::Update(int nowMs) {
+    // 超过最宽命中窗口未击中则判Miss
+    if (referenceSweep_) {
+        SweepMissesReference(nowMs);
+    } else {
+        SweepMisses(nowMs);
+    }
+}
+
+JudgeGrade Game::HandleInput(int lane, int nowMs) {
+    // 对应轨道游标处即最近的未判定音符
+    if (lane < 0 || lane >= keyCount_) {
+        return JudgeGrade::None;
+    }
+
+    LaneState& state = lanes_[lane];
+    if (state.cursor >= state.notes.Size()) {
+        return JudgeGrade::None;
+    }
+    int delta = nowMs - nextNoteMs_[lane];
+    int absDelta = delta < 0 ? -delta : delta;
+    // 提前超出Miss窗口的按键不消耗音符（不必解码音符）
+    if (delta < -judgeTable_.missWindowMs) {
         return JudgeGrade::None;
     }
-    return JudgeGrade::None;
+    JudgeGrade grade = judgeTable_.Classify(absDelta);
+    ApplyJudge(CursorNote(state), grade, nowMs, delta);
+    ++state.cursor;
+    RefreshNextNote(lane);
+    return grade;
 }
 
-void Game::ApplyJudge(Note& note, JudgeGrade grade, int nowMs) {
-    // 记录判定、连击与计分
-    if (note.judged) {
+void Game::Seek(int chartMs) {
+    PROFILE_ZONE("Game::Seek");
+    if (checkpoints_.empty()) {
         return;
     }
-    note.judged = true;
+    // 每个轨道二分定位游标，不逐个音符重置
+    for (int lane = 0; lane < keyCount_; ++lane) {
+        lanes_[lane].cursor = lanes_[lane].notes.LowerBound(chartMs);
+        RefreshNextNote(lane);
+    }
+
+    // 判定记录按判定顺序排列，与音符时间的乱序不超过判定窗口；从末尾回扫到足够早的记录为止
+    int slackMs = judgeTable_.missWindowMs + judgeTable_.HitWindowMs() + kSeekSlackMs;
+    size_t keep = hitRecords_.size();
+    while (keep > 0 && hitRecords_[keep - 1].noteTimeMs >= chartMs - slackMs) {
+        --keep;
+    }
+    // 回扫范围里只留下仍早于chartMs的记录（原地前移，不另开缓冲），再从keep之前最近的快照起逐条重放
+    auto removed = std::remove_if(hitRecords_.begin() + keep, hitRecords_.end(),
+                                  [chartMs](const HitRecord& record) { return record.noteTimeMs >= chartMs; });
+    hitRecords_.erase(removed, hitRecords_.end());
+    size_t checkpoint = std::min(keep / kStatsCheckpointInterval, checkpoints_.size() - 1);
+    checkpoints_.resize(checkpoint + 1);
+    stats_ = checkpoints_.back();
+    for (size_t i = checkpoint * kStatsCheckpointInterval; i < hitRecords_.size(); ++i) {
+        HitRecord& record = hitRecords_[i];
+        AccumulateJudge(i, record.lane, record.grade, record.noteTimeMs + record.offsetMs, record.offsetMs);
+        record.accuracyPoints = stats_.accuracyPoints;
+    }
+    stats_.lastJudge = JudgeGrade::None;
+    stats_.lastJudgeTimeMs = -999999;
+    // 重放产生的事件不触发特效
+    judgeEventFirst_ = judgeEventEnd_;
+}
+
+uint64_t Game::GetJudgeEventBegin() const {
+    uint64_t oldest = judgeEventEnd_ > kJudgeEventCapacity ? judgeEventEnd_ - kJudgeEventCapacity : 0;
+    return std::max(oldest, judgeEventFirst_);
+}
+
+bool Game::IsFinished() const {
+    if (streaming_) {
+        return false;
+    }
+    for (int lane = 0; lane < keyCount_; ++lane) {
+        if (nextNoteMs_[lane] != INT_MAX) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void Game::ApplyJudge(const Note& note, JudgeGrade grade, int nowMs, int offsetMs) {
+    // 记录判定、偏差、连击与计分（调用方负责推进游标，保证每个音符只判定一次）
+    AccumulateJudge(hitRecords_.size(), note.lane, grade, nowMs, offsetMs);
+    hitRecords_.push_back(HitRecord{note.timeMs, offsetMs, note.lane, grade, stats_.accuracyPoints});
+}
+
+void Game::AccumulateJudge(size_t index, int lane, JudgeGrade grade, int nowMs, int offsetMs) {
+    if (index % kStatsCheckpointInterval == 0 && checkpoints_.size() <= index / kStatsCheckpointInterval) {
+        checkpoints_.push_back(stats_);
+    }
     stats_.judgedNotes += 1;
     stats_.lastJudge = grade;
     stats_.lastJudgeTimeMs = nowMs;
-    switch (grade) {
-        case JudgeGrade::Perfect:
-            stats_.judgementPoints += 100;
-            stats_.combo += 1;
-            stats_.perfectCount += 1;
-            break;
-        case JudgeGrade::Good:
-            stats_.judgementPoints += 65;
-            stats_.combo += 1;
-            stats_.goodCount += 1;
-            break;
-        case JudgeGrade::Miss:
-            stats_.combo = 0;
-            stats_.missCount += 1;
-            break;
-        case JudgeGrade::None:
-            break;
+    if (grade != JudgeGrade::Miss) {
+        stats_.hitError.Add(lane, offsetMs);
+    }
+    int gradeIndex = static_cast<int>(grade);
+    stats_.gradeCounts[gradeIndex] += 1;
+    stats_.judgementPoints += judgeTable_.scoreWeight[gradeIndex];
+    stats_.accuracyPoints += judgeTable_.accuracyWeight[gradeIndex];
+    if (grade == JudgeGrade::Miss) {
+        stats_.combo = 0;
+    } else {
+        stats_.combo += 1;
     }
     if (stats_.combo > stats_.maxCombo) {
         stats_.maxCombo = stats_.combo;
     }
+    judgeEvents_[judgeEventEnd_ % kJudgeEventCapacity] = JudgeEvent{nowMs, lane, grade};
+    ++judgeEventEnd_;
+}
+
+void HitErrorStats::Add(int lane, int offsetMs) {
+    // Welford增量更新均值与方差，O(1)且不分配内存
+    double value = static_cast<double>(offsetMs);
+    count += 1;
+    double delta = value - mean;
+    mean += delta / count;
+    m2 += delta * (value - mean);
+
+    if (lane >= 0 && lane < kMaxLanes) {
+        laneCount[lane] += 1;
+        laneMean[lane] += (value - laneMean[lane]) / laneCount[lane];
+    }
+
+    int range = std::max(1, histogramRangeMs);
+    int clamped = std::clamp(offsetMs, -range, range);
+    int bin = (clamped + range) * kHitErrorBins / (range * 2 + 1);
+    histogram[bin] += 1;
+}
+
+double HitErrorStats::StdDev() const {
+    if (count < 2) {
+        return 0.0;
+    }
+    return std::sqrt(m2 / (count - 1));
 }
 
 int Game::GetJudgementScore() const {
-    // 判定分：Perfect=100, Good=65，满分900000
+    // 判定分：按判定表计分权重，满分900000
     if (stats_.totalNotes <= 0) {
         return 0;
     }
     double ratio = static_cast<double>(stats_.judgementPoints) /
-                   (static_cast<double>(stats_.totalNotes) * 100.0);
+                   (static_cast<double>(stats_.totalNotes) * judgeTable_.maxScoreWeight);
     return static_cast<int>(ratio * 900000.0 + 0.5);
 }
 
@@ -152,7 +471,7 @@ double Game::GetAccuracy() const {
     if (stats_.judgedNotes <= 0) {
         return 100.0;
     }
-    double ratio = static_cast<double>(stats_.judgementPoints) /
-                   (static_cast<double>(stats_.judgedNotes) * 100.0);
+    double ratio = static_cast<double>(stats_.accuracyPoints) /
+                   (static_cast<double>(stats_.judgedNotes) * judgeTable_.maxAccuracyWeight);
     return ratio * 100.0;
 }
@@ -1,64 +1,178 @@
 #pragma once
 
+#include <array>
+#include <cstdint>
 #include <string>
 #include <vector>
 
 #include "Chart.h"
+#include "JudgeTable.h"
+#include "PackedNote.h"
 
-enum class JudgeGrade {
-    // 判定等级
-    None,
-    Perfect,
-    Good,
-    Miss
+// 偏差直方图的桶数（覆盖±最宽命中窗口）
+constexpr int kHitErrorBins = 41;
+
+struct HitRecord {
+    // 单个音符的判定记录（offset为按键时间-音符时间，正数表示偏晚）
+    int noteTimeMs = 0;
+    int offsetMs = 0;
+    int lane = 0;
+    JudgeGrade grade = JudgeGrade::None;
+    // 截至本次判定的累计ACC分，用于结算的ACC曲线
+    int accuracyPoints = 0;
+};
+
+struct JudgeEvent {
+    // 判定事件（击中特效用）：判定时刻的谱面时间、轨道与等级
+    int timeMs = 0;
+    int lane = 0;
+    JudgeGrade grade = JudgeGrade::None;
+};
+
+// 判定事件环形缓冲的容量（远多于两帧之间的判定数）
+constexpr int kJudgeEventCapacity = 64;
+
+struct HitErrorStats {
+    // 击中偏差的流式统计（Welford），Miss不计入
+    int count = 0;
+    double mean = 0.0;
+    double m2 = 0.0;
+    int histogramRangeMs = 160;
+    std::array<int, kHitErrorBins> histogram{};
+    std::array<int, kMaxLanes> laneCount{};
+    std::array<double, kMaxLanes> laneMean{};
+
+    void Add(int lane, int offsetMs);
+    double StdDev() const;
+    // UR = 标准差 * 10
+    double UnstableRate() const { return StdDev() * 10.0; }
 };
 
 struct GameStats {
     // 统计数据与最后一次判定显示
     int combo = 0;
     int maxCombo = 0;
-    int perfectCount = 0;
-    int goodCount = 0;
-    int missCount = 0;
+    // 各判定等级数量，按JudgeGrade下标
+    std::array<int, kJudgeGradeCount> gradeCounts{};
     int totalNotes = 0;
     int judgedNotes = 0;
+    // 按判定表权重累加的计分与ACC分
     int judgementPoints = 0;
+    int accuracyPoints = 0;
     JudgeGrade lastJudge = JudgeGrade::None;
     int lastJudgeTimeMs = -999999;
+    HitErrorStats hitError;
+};
+
+struct ChartReloadResult {
+    // 热重载前后音符的差异（按轨道、时间与结束时间比较）与保留下来的判定数
+    int keptNotes = 0;
+    int addedNotes = 0;
+    int removedNotes = 0;
+    int keptJudgements = 0;
 };
 
 class Game {
 public:
-    // 载入谱面并初始化索引
-    void LoadChart(const Chart& chart);
+    // 判定窗口来源，下次LoadChart时生效
+    void SetJudgePreset(JudgePreset preset) { judgePreset_ = preset; }
+    JudgePreset GetJudgePreset() const { return judgePreset_; }
+    // 播放速率：判定与统计都按谱面时间，渲染据此把谱面时间换回真实时间
+    void SetRate(double rate) { rate_ = rate; }
+    double GetRate() const { return rate_; }
+    // judgebench对比用：漏判改用逐轨道解码游标音符的原始循环（不看nextNoteMs_），结果与默认扫描相同
+    void SetReferenceSweep(bool enabled) { referenceSweep_ = enabled; }
+    // 接管谱面（连同其arena）并建立打包音符与判定表
+    void LoadChart(Chart&& chart);
+    // 流式载入：先用不含音符的谱面头初始化（expectedNotes用于预分配与计分），之后AppendNotes逐批追加，
+    // 全部追加后FinishStream按实际音符数修正总数；期间IsFinished总为false
+    void BeginStream(Chart&& header, size_t expectedNotes);
+    // 批内按时间排序后追加到各轨道末尾；比轨道已有音符更早的（文件乱序）插回原位，落在判定游标之前的丢弃。
+    // notes会被重排，调用方可复用其容量
+    void AppendNotes(std::vector<Note>& notes);
+    void FinishStream();
+    bool IsStreaming() const { return streaming_; }
+    // 热重载：换上当前谱面的新版本，仍能对应到新音符（同轨道同时间）的判定记录保留并重建统计；
+    // nowMs减去Miss窗口之前新增的音符视为跳过，之后的都可判定
+    ChartReloadResult ReloadChart(Chart&& chart, int nowMs);
+    // 释放当前谱面的arena与打包音符（返回菜单时调用）
+    void Unload();
+    const Chart& GetChart() const { return chart_; }
     // 每帧更新超时未击中判定
     void Update(int nowMs);
     // 按键触发判定
     JudgeGrade HandleInput(int lane, int nowMs);
+    // 练习用跳转：chartMs之前的音符视为已过，之后的恢复为未判定，统计回到只含之前音符的状态
+    void Seek(int chartMs);
+    // 所有轨道的游标都已到末尾（跳过的音符不计入judgedNotes）
+    bool IsFinished() const;
 
-    const std::vector<Note>& GetNotes() const { return notes_; }
+    // 每个轨道按时间排序的打包音符，下标小于游标的均已判定
+    const PackedNoteList& GetLaneNotes(int lane) const { return lanes_[lane].notes; }
+    size_t GetLaneCursor(int lane) const { return lanes_[lane].cursor; }
     int GetKeyCount() const { return keyCount_; }
-    int GetPerfectWindow() const { return perfectWindowMs_; }
-    int GetGoodWindow() const { return goodWindowMs_; }
+    // 最后一个音符（含长条尾）的时间
+    int GetChartEndMs() const { return chartEndMs_; }
+    const JudgeTable& GetJudgeTable() const { return judgeTable_; }
     const GameStats& GetStats() const { return stats_; }
+    // 按判定顺序记录的每个音符偏差（LoadChart时按音符数预分配）
+    const std::vector<HitRecord>& GetHitRecords() const { return hitRecords_; }
     int GetTotalNotes() const { return stats_.totalNotes; }
-    // 900000判定分 + 100000连击分
+    // 900000判定分 + 100000连击分（判定分按判定表计分权重）
     int GetJudgementScore() const;
     int GetComboScore() const;
     int GetTotalScore() const;
-    // Accuracy只基于判定分
+    // Accuracy只基于判定表的ACC权重
     double GetAccuracy() const;
     JudgeGrade GetLastJudge() const { return stats_.lastJudge; }
+    // 最近的判定事件，序号[GetJudgeEventBegin(), GetJudgeEventEnd())；序号跨谱面单调递增，载入与跳转后清空
+    uint64_t GetJudgeEventBegin() const;
+    uint64_t GetJudgeEventEnd() const { return judgeEventEnd_; }
+    const JudgeEvent& GetJudgeEvent(uint64_t sequence) const { return judgeEvents_[sequence % kJudgeEventCapacity]; }
     int GetLastJudgeTimeMs() const { return stats_.lastJudgeTimeMs; }
 
 private:
-    void ApplyJudge(Note& note, JudgeGrade grade, int nowMs);
+    struct LaneState {
+        // 单轨道音符、判定游标与游标所在块的解码缓存
+        PackedNoteList notes;
+        size_t cursor = 0;
+        size_t windowBlock = static_cast<size_t>(-1);
+        std::array<Note, kPackedBlockSize> window{};
+    };
+
+    const Note& CursorNote(LaneState& lane);
+    // 游标移动后刷新该轨道的下一音符时间
+    void RefreshNextNote(int lane);
+    void SweepMisses(int nowMs);
+    void SweepMissesReference(int nowMs);
+    void ApplyJudge(const Note& note, JudgeGrade grade, int nowMs, int offsetMs);
+    // 把第index条判定计入统计与事件队列（不写判定记录），跳转重放时直接对已有记录调用
+    void AccumulateJudge(size_t index, int lane, JudgeGrade grade, int nowMs, int offsetMs);
+    // 载入新谱面时重置判定表、统计与轨道（不含音符）
+    void ResetForChart(size_t expectedNotes);
+    // 乱序到达的一批音符（已按时间排序）：整条轨道解码后归并再重新打包，落在判定游标之前的从late中删去
+    void MergeLateNotes(int lane, std::vector<Note>& late);
 
-    std::vector<Note> notes_;
-    std::vector<std::vector<int>> laneIndices_;
-    std::vector<size_t> laneCursor_;
+    Chart chart_;
+    // 轨道状态为定长数组，只使用前keyCount_个
+    std::array<LaneState, kMaxLanes> lanes_;
+    // 每个轨道游标处音符的时间（无音符时为INT_MAX），漏判扫描只比较这一行
+    std::array<int, kMaxLanes> nextNoteMs_{};
+    std::vector<HitRecord> hitRecords_;
+    // 每kStatsCheckpointInterval条判定记录之前的统计快照，跳转时从最近的快照重放
+    std::vector<GameStats> checkpoints_;
+    std::array<JudgeEvent, kJudgeEventCapacity> judgeEvents_{};
+    uint64_t judgeEventEnd_ = 0;
+    // 早于此序号的事件属于上一张谱面或跳转前，不再对外提供
+    uint64_t judgeEventFirst_ = 0;
     int keyCount_ = 4;
-    int perfectWindowMs_ = 80;
-    int goodWindowMs_ = 160;
+    int chartEndMs_ = 0;
+    bool streaming_ = false;
+    bool referenceSweep_ = false;
+    // AppendNotes里按轨道暂存乱序音符，容量跨批复用
+    std::array<std::vector<Note>, kMaxLanes> lateNotes_;
+    JudgePreset judgePreset_ = JudgePreset::ChartOD;
+    double rate_ = 1.0;
+    JudgeTable judgeTable_ = BuildJudgeTable(5.0);
     GameStats stats_;
 };
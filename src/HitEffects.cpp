@@ -0,0 +1,128 @@
+#include "HitEffects.h"
+
+#include <algorithm>
+#include <climits>
+
+#include "Profiler.h"
+
+namespace {
+constexpr int kParticleMask = kParticleCapacity - 1;
+static_assert((kParticleCapacity & kParticleMask) == 0, "particle capacity must be a power of two");
+constexpr int kParticleLifeMs = 400;
+constexpr int kLaneFlashMs = 150;
+// 像素/毫秒²，屏幕坐标向下为正
+constexpr float kGravity = 0.0018f;
+// 渲染线程外推的时间可能略微回退，回退不超过这个量时粒子只隐藏不删除
+constexpr int kRewindToleranceMs = 100;
+
+int ParticlesFor(JudgeGrade grade) {
+    switch (grade) {
+        case JudgeGrade::Max:
+            return 10;
+        case JudgeGrade::Perfect:
+            return 8;
+        case JudgeGrade::Great:
+            return 6;
+        case JudgeGrade::Good:
+            return 4;
+        case JudgeGrade::Bad:
+            return 2;
+        default:
+            return 0;
+    }
+}
+
+float Random(uint64_t sequence, int index) {
+    // 由事件序号与粒子下标散列出[0,1)，同一事件每次生成的粒子相同
+    uint32_t h = static_cast<uint32_t>(sequence) * 0x9E3779B1u ^ static_cast<uint32_t>(index + 1) * 0x85EBCA6Bu;
+    h ^= h >> 16;
+    h *= 0x7FEB352Du;
+    h ^= h >> 15;
+    h *= 0x846CA68Bu;
+    h ^= h >> 16;
+    return static_cast<float>(h >> 8) * (1.0f / 16777216.0f);
+}
+}
+
+void HitEffects::Clear() {
+    head_ = 0;
+    count_ = 0;
+    visible_.count = 0;
+    laneFlashMs_.fill(INT_MIN / 2);
+    laneFlashGrade_.fill(JudgeGrade::None);
+}
+
+void HitEffects::Spawn(const JudgeEvent& event, uint64_t sequence, int nowMs) {
+    int age = nowMs - event.timeMs;
+    if (age >= kParticleLifeMs || age < -kRewindToleranceMs || event.lane < 0 || event.lane >= kMaxLanes) {
+        return;
+    }
+    int particles = ParticlesFor(event.grade);
+    if (particles > 0 && event.timeMs >= laneFlashMs_[event.lane]) {
+        laneFlashMs_[event.lane] = event.timeMs;
+        laneFlashGrade_[event.lane] = event.grade;
+    }
+    for (int i = 0; i < particles; ++i) {
+        // 满时挤掉最早的粒子：存活集合总是最近的kParticleCapacity个，与池子的历史无关
+        if (count_ == kParticleCapacity) {
+            head_ = (head_ + 1) & kParticleMask;
+            --count_;
+        }
+        int slot = (head_ + count_) & kParticleMask;
+        // 向上呈扇形散开，速度0.2–0.55像素/毫秒
+        float spread = Random(sequence, i * 3) * 2.0f - 1.0f;
+        float speed = 0.2f + Random(sequence, i * 3 + 1) * 0.35f;
+        spawnMs_[slot] = event.timeMs;
+        velocityX_[slot] = spread * speed;
+        velocityY_[slot] = -(1.0f - 0.5f * spread * spread) * speed;
+        size_[slot] = 4.0f + Random(sequence, i * 3 + 2) * 4.0f;
+        lane_[slot] = static_cast<uint8_t>(event.lane);
+        grade_[slot] = static_cast<uint8_t>(event.grade);
+        ++count_;
+    }
+}
+
+void HitEffects::Update(const std::vector<JudgeEvent>& events, uint64_t eventEnd, int nowMs) {
+    PROFILE_ZONE("HitEffects");
+    uint64_t eventBegin = eventEnd - events.size();
+    for (uint64_t sequence = std::max(eventBegin, nextEvent_); sequence < eventEnd; ++sequence) {
+        Spawn(events[static_cast<size_t>(sequence - eventBegin)], sequence, nowMs);
+    }
+    nextEvent_ = eventEnd;
+
+    // 头部过期的弹出；跳转回退后尾部晚于当前时间太多的删除
+    while (count_ > 0 && nowMs - spawnMs_[head_] >= kParticleLifeMs) {
+        head_ = (head_ + 1) & kParticleMask;
+        --count_;
+    }
+    while (count_ > 0 && spawnMs_[(head_ + count_ - 1) & kParticleMask] - nowMs > kRewindToleranceMs) {
+        --count_;
+    }
+
+    // 存活粒子逐个解析出位置与不透明度，写入连续的可见数组
+    int visible = 0;
+    for (int i = 0; i < count_; ++i) {
+        int slot = (head_ + i) & kParticleMask;
+        float age = static_cast<float>(nowMs - spawnMs_[slot]);
+        if (age < 0.0f) {
+            continue;
+        }
+        float remaining = 1.0f - age / kParticleLifeMs;
+        visible_.x[visible] = velocityX_[slot] * age;
+        visible_.y[visible] = velocityY_[slot] * age + 0.5f * kGravity * age * age;
+        visible_.size[visible] = size_[slot] * (0.5f + 0.5f * remaining);
+        visible_.alpha[visible] = static_cast<uint8_t>(255.0f * remaining);
+        visible_.lane[visible] = lane_[slot];
+        visible_.grade[visible] = grade_[slot];
+        ++visible;
+    }
+    visible_.count = visible;
+}
+
+float HitEffects::LaneFlash(int lane, int nowMs) const {
+    int age = nowMs - laneFlashMs_[lane];
+    if (age < 0 || age >= kLaneFlashMs) {
+        return 0.0f;
+    }
+    return 1.0f - static_cast<float>(age) / kLaneFlashMs;
+}
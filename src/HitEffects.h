@@ -0,0 +1,54 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "Game.h"
+
+// 粒子池容量（2的幂）：满时挤掉最早的粒子，每帧开销有上限
+constexpr int kParticleCapacity = 256;
+
+struct ParticleFrame {
+    // 本帧可见的粒子（SoA）：相对所在轨道中心与判定线的偏移、边长、不透明度、轨道与判定等级
+    int count = 0;
+    std::array<float, kParticleCapacity> x{};
+    std::array<float, kParticleCapacity> y{};
+    std::array<float, kParticleCapacity> size{};
+    std::array<uint8_t, kParticleCapacity> alpha{};
+    std::array<uint8_t, kParticleCapacity> lane{};
+    std::array<uint8_t, kParticleCapacity> grade{};
+};
+
+class HitEffects {
+public:
+    // 击中粒子与轨道闪光：由判定事件生成，位置按出生时间解析计算，与帧率和更新次数无关
+    // （视频导出各线程的粒子池互不相同，画出的结果仍然一致）。固定容量，不分配内存
+    HitEffects() { Clear(); }
+
+    // events为序号[eventEnd - events.size(), eventEnd)的最近事件，已消费的序号跳过
+    void Update(const std::vector<JudgeEvent>& events, uint64_t eventEnd, int nowMs);
+    void Clear();
+
+    const ParticleFrame& Visible() const { return visible_; }
+    // 轨道闪光强度（0–1）与触发它的判定
+    float LaneFlash(int lane, int nowMs) const;
+    JudgeGrade LaneFlashGrade(int lane) const { return laneFlashGrade_[lane]; }
+
+private:
+    void Spawn(const JudgeEvent& event, uint64_t sequence, int nowMs);
+
+    // 环形FIFO：寿命相同，出生早的先消失，只需从头部弹出
+    int head_ = 0;
+    int count_ = 0;
+    std::array<int, kParticleCapacity> spawnMs_{};
+    std::array<float, kParticleCapacity> velocityX_{};
+    std::array<float, kParticleCapacity> velocityY_{};
+    std::array<float, kParticleCapacity> size_{};
+    std::array<uint8_t, kParticleCapacity> lane_{};
+    std::array<uint8_t, kParticleCapacity> grade_{};
+    uint64_t nextEvent_ = 0;
+    std::array<int, kMaxLanes> laneFlashMs_{};
+    std::array<JudgeGrade, kMaxLanes> laneFlashGrade_{};
+    ParticleFrame visible_;
+};
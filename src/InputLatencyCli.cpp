@@ -0,0 +1,173 @@
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <linux/uinput.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+#include "EvdevInput.h"
+
+namespace {
+const char* kProbeName = "SimpleMania latency probe";
+
+struct LatencyStats {
+    double minMs = 0.0;
+    double medianMs = 0.0;
+    double p99Ms = 0.0;
+    double maxMs = 0.0;
+};
+
+LatencyStats Summarize(std::vector<double> samples) {
+    LatencyStats stats;
+    if (samples.empty()) {
+        return stats;
+    }
+    std::sort(samples.begin(), samples.end());
+    stats.minMs = samples.front();
+    stats.medianMs = samples[samples.size() / 2];
+    stats.p99Ms = samples[std::min(samples.size() - 1, samples.size() * 99 / 100)];
+    stats.maxMs = samples.back();
+    return stats;
+}
+
+// USB HID用法码反查evdev键码
+int UsageToEvdevKey(int usage) {
+    for (int code = 0; code < KEY_MAX; ++code) {
+        if (EvdevKeyToUsage(code) == usage) {
+            return code;
+        }
+    }
+    return -1;
+}
+
+bool Emit(int fd, int type, int code, int value) {
+    input_event event{};
+    event.type = static_cast<unsigned short>(type);
+    event.code = static_cast<unsigned short>(code);
+    event.value = value;
+    return write(fd, &event, sizeof(event)) == static_cast<ssize_t>(sizeof(event));
+}
+
+bool EmitKey(int fd, int code, bool pressed) {
+    return Emit(fd, EV_KEY, code, pressed ? 1 : 0) && Emit(fd, EV_SYN, SYN_REPORT, 0);
+}
+
+// 等待指定的按键事件到达读取端，超时返回false
+bool WaitForKey(EvdevInput& input, int usage, bool pressed, std::vector<EvdevKeyEvent>& events,
+                EvdevKeyEvent& out) {
+    double deadlineMs = MonotonicNowMs() + 200.0;
+    while (MonotonicNowMs() < deadlineMs) {
+        input.Poll(events);
+        for (const EvdevKeyEvent& event : events) {
+            if (event.usage == usage && event.pressed == pressed) {
+                out = event;
+                return true;
+            }
+        }
+        std::this_thread::yield();
+    }
+    return false;
+}
+}
+
+int main(int argc, char* argv[]) {
+    // 输入延迟测试：建一个uinput虚拟键盘按默认4K键位（D F J K）轮流按键，由EvdevInput读取，
+    // 统计内核时间戳相对写入时刻的偏差与从时间戳到主线程取到事件的延迟（需要/dev/uinput与/dev/input的权限）
+    int presses = 1000;
+    int intervalMs = 5;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--presses" && i + 1 < argc) {
+            presses = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--interval" && i + 1 < argc) {
+            intervalMs = std::max(0, std::atoi(argv[++i]));
+        } else {
+            std::printf("Usage: inputlatency [--presses n] [--interval ms]\n");
+            return arg == "--help" || arg == "-h" ? 0 : 1;
+        }
+    }
+
+    const char* lanes = "DFJK";
+    std::vector<int> usages;
+    std::vector<int> codes;
+    for (const char* c = lanes; *c; ++c) {
+        usages.push_back(4 + (*c - 'A'));
+        codes.push_back(UsageToEvdevKey(usages.back()));
+    }
+
+    int fd = open("/dev/uinput", O_WRONLY | O_NONBLOCK | O_CLOEXEC);
+    if (fd < 0) {
+        std::printf("Cannot open /dev/uinput: %s\n", std::strerror(errno));
+        return 1;
+    }
+    // 只声明字母键不会被EvdevInput当作键盘，按名字打开
+    ioctl(fd, UI_SET_EVBIT, EV_KEY);
+    ioctl(fd, UI_SET_EVBIT, EV_SYN);
+    for (int code : codes) {
+        ioctl(fd, UI_SET_KEYBIT, code);
+    }
+    uinput_setup setup{};
+    setup.id.bustype = BUS_VIRTUAL;
+    setup.id.vendor = 0x1234;
+    setup.id.product = 0x5678;
+    std::snprintf(setup.name, sizeof(setup.name), "%s", kProbeName);
+    if (ioctl(fd, UI_DEV_SETUP, &setup) < 0 || ioctl(fd, UI_DEV_CREATE) < 0) {
+        std::printf("Cannot create uinput device: %s\n", std::strerror(errno));
+        close(fd);
+        return 1;
+    }
+    // 设备节点由udev创建，稍等再打开
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+
+    EvdevInput input;
+    std::string error;
+    if (!input.Start(error, kProbeName)) {
+        std::printf("Cannot read probe device: %s\n", error.c_str());
+        ioctl(fd, UI_DEV_DESTROY);
+        close(fd);
+        return 1;
+    }
+
+    std::vector<double> stampMs;
+    std::vector<double> deliveryMs;
+    stampMs.reserve(presses);
+    deliveryMs.reserve(presses);
+    std::vector<EvdevKeyEvent> events;
+    int lost = 0;
+    for (int i = 0; i < presses; ++i) {
+        size_t lane = static_cast<size_t>(i) % codes.size();
+        double writeMs = MonotonicNowMs();
+        EvdevKeyEvent event;
+        if (!EmitKey(fd, codes[lane], true) || !WaitForKey(input, usages[lane], true, events, event)) {
+            ++lost;
+        } else {
+            double seenMs = MonotonicNowMs();
+            stampMs.push_back(event.timeMs - writeMs);
+            deliveryMs.push_back(seenMs - event.timeMs);
+        }
+        EmitKey(fd, codes[lane], false);
+        WaitForKey(input, usages[lane], false, events, event);
+        std::this_thread::sleep_for(std::chrono::milliseconds(intervalMs));
+    }
+    input.Stop();
+    ioctl(fd, UI_DEV_DESTROY);
+    close(fd);
+
+    std::printf("presses %d, lost %d\n", presses, lost);
+    std::printf("                       min       median    p99       max\n");
+    LatencyStats stamp = Summarize(stampMs);
+    LatencyStats delivery = Summarize(deliveryMs);
+    std::printf("timestamp - write    %7.3f ms %7.3f ms %7.3f ms %7.3f ms\n", stamp.minMs, stamp.medianMs,
+                stamp.p99Ms, stamp.maxMs);
+    std::printf("poll - timestamp     %7.3f ms %7.3f ms %7.3f ms %7.3f ms\n", delivery.minMs, delivery.medianMs,
+                delivery.p99Ms, delivery.maxMs);
+    return lost == 0 ? 0 : 1;
+}
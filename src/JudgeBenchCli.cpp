@@ -0,0 +1,214 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "ChartGen.h"
+#include "Game.h"
+#include "HitEffects.h"
+
+namespace {
+struct BenchInput {
+    int timeMs = 0;
+    int lane = 0;
+};
+
+struct BenchResult {
+    double nsPerPoll = 0.0;
+    int score = 0;
+    int misses = 0;
+};
+
+BenchResult RunOnce(const ChartGenOptions& options, const std::vector<BenchInput>& inputs, int endMs,
+                    bool referenceSweep) {
+    // 模拟主循环：谱面时间每轮前进1ms，先处理本轮按键再扫描漏判
+    Game game;
+    game.SetReferenceSweep(referenceSweep);
+    game.LoadChart(GenerateChart(options));
+    size_t next = 0;
+    auto start = std::chrono::steady_clock::now();
+    int polls = 0;
+    for (int nowMs = -1000; nowMs <= endMs; ++nowMs, ++polls) {
+        while (next < inputs.size() && inputs[next].timeMs <= nowMs) {
+            game.HandleInput(inputs[next].lane, nowMs);
+            ++next;
+        }
+        game.Update(nowMs);
+    }
+    double elapsedNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    BenchResult result;
+    result.nsPerPoll = elapsedNs / polls;
+    result.score = game.GetTotalScore();
+    result.misses = game.GetStats().gradeCounts[static_cast<int>(JudgeGrade::Miss)];
+    return result;
+}
+
+struct EffectsResult {
+    double nsPerFrame = 0.0;
+    int peakParticles = 0;
+};
+
+struct SaturatedResult {
+    // 按批计时后每次更新的耗时分布
+    double medianNs = 0.0;
+    double p99Ns = 0.0;
+    double p999Ns = 0.0;
+};
+
+EffectsResult RunEffects(const ChartGenOptions& options, const std::vector<BenchInput>& inputs, int endMs) {
+    // 击中特效：按60帧/秒取判定事件并更新粒子池，只计特效更新的耗时
+    Game game;
+    game.LoadChart(GenerateChart(options));
+    HitEffects effects;
+    std::vector<JudgeEvent> events;
+    events.reserve(kJudgeEventCapacity);
+    size_t next = 0;
+    int frames = 0;
+    int nextFrameMs = -1000;
+    double totalNs = 0.0;
+    EffectsResult result;
+    for (int nowMs = -1000; nowMs <= endMs; ++nowMs) {
+        while (next < inputs.size() && inputs[next].timeMs <= nowMs) {
+            game.HandleInput(inputs[next].lane, nowMs);
+            ++next;
+        }
+        game.Update(nowMs);
+        if (nowMs < nextFrameMs) {
+            continue;
+        }
+        nextFrameMs += 16;
+        events.clear();
+        for (uint64_t sequence = game.GetJudgeEventBegin(); sequence < game.GetJudgeEventEnd(); ++sequence) {
+            events.push_back(game.GetJudgeEvent(sequence));
+        }
+        auto start = std::chrono::steady_clock::now();
+        effects.Update(events, game.GetJudgeEventEnd(), nowMs);
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        totalNs += ns;
+        result.peakParticles = std::max(result.peakParticles, effects.Visible().count);
+        ++frames;
+    }
+    result.nsPerFrame = totalNs / std::max(1, frames);
+    return result;
+}
+
+SaturatedResult RunSaturatedEffects(int keys) {
+    // 粒子池一直满：每帧32个Max判定（320个粒子，超出容量挤掉最早的），单次更新太短，
+    // 每批连续更新kBatchUpdates帧只计一次时，取各批平均值的分位数，避免单次采样被调度噪声主导
+    constexpr int kBatchUpdates = 64;
+    constexpr int kBatches = 4000;
+    constexpr int kEventsPerFrame = 32;
+    HitEffects effects;
+    std::vector<JudgeEvent> events(kEventsPerFrame);
+    uint64_t eventEnd = 0;
+    int nowMs = 0;
+    std::vector<double> batchNs;
+    batchNs.reserve(kBatches);
+    for (int batch = 0; batch < kBatches; ++batch) {
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < kBatchUpdates; ++i) {
+            nowMs += 16;
+            for (int e = 0; e < kEventsPerFrame; ++e) {
+                events[e] = JudgeEvent{nowMs - e % 16, e % keys, JudgeGrade::Max};
+            }
+            eventEnd += kEventsPerFrame;
+            effects.Update(events, eventEnd, nowMs);
+        }
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        batchNs.push_back(ns / kBatchUpdates);
+        if (effects.Visible().count != kParticleCapacity) {
+            return SaturatedResult();
+        }
+    }
+    std::sort(batchNs.begin(), batchNs.end());
+    SaturatedResult result;
+    result.medianNs = batchNs[batchNs.size() / 2];
+    result.p99Ns = batchNs[batchNs.size() * 99 / 100];
+    result.p999Ns = batchNs[batchNs.size() * 999 / 1000];
+    return result;
+}
+}
+
+int main(int argc, char* argv[]) {
+    // 判定核心基准：各键数下判定与漏判扫描的每轮耗时（与逐轨道解码音符的原始漏判循环对比），以及击中特效每帧的更新耗时（含粒子池满载时的分位数）
+    ChartGenOptions options;
+    options.bpm = 180.0;
+    options.durationMs = 300000;
+    options.density = 4.0;
+    options.pattern = ChartPattern::Jumpstream;
+    int minKeys = 4;
+    int maxKeys = 10;
+    int repeats = 5;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--duration" && i + 1 < argc) {
+            options.durationMs = std::atoi(argv[++i]);
+        } else if (arg == "--density" && i + 1 < argc) {
+            options.density = std::atof(argv[++i]);
+        } else if (arg == "--keys" && i + 1 < argc) {
+            if (std::sscanf(argv[++i], "%d-%d", &minKeys, &maxKeys) == 1) {
+                maxKeys = minKeys;
+            }
+        } else if (arg == "--repeat" && i + 1 < argc) {
+            repeats = std::max(1, std::atoi(argv[++i]));
+        } else {
+            std::printf("Usage: judgebench [--duration ms] [--density d] [--keys 4-10] [--repeat n]\n");
+            return arg == "--help" || arg == "-h" ? 0 : 1;
+        }
+    }
+    minKeys = std::clamp(minKeys, 1, kMaxLanes);
+    maxKeys = std::clamp(maxKeys, minKeys, kMaxLanes);
+
+    std::printf("keys  notes     poll min     poll median  reference    speedup  effects/frame  particles  "
+                "saturated median / p99 / p99.9\n");
+    for (int keys = minKeys; keys <= maxKeys; ++keys) {
+        options.keyCount = keys;
+        // 自动按键：每10个音符漏掉1个，其余按固定的伪随机偏差击打
+        Chart chart = GenerateChart(options);
+        std::vector<BenchInput> inputs;
+        inputs.reserve(chart.notes.size());
+        int endMs = 0;
+        for (size_t i = 0; i < chart.notes.size(); ++i) {
+            const Note& note = chart.notes[i];
+            endMs = std::max(endMs, std::max(note.timeMs, note.endTimeMs));
+            if (i % 10 != 9) {
+                int jitterMs = static_cast<int>((i * 2654435761u) % 61) - 30;
+                inputs.push_back(BenchInput{note.timeMs + jitterMs, note.lane});
+            }
+        }
+        std::stable_sort(inputs.begin(), inputs.end(),
+                         [](const BenchInput& a, const BenchInput& b) { return a.timeMs < b.timeMs; });
+        endMs += 1000;
+
+        // 当前扫描与原始循环交替重复运行，各取中位数；两者的结果每次都应相同
+        std::vector<double> pollNs;
+        std::vector<double> referenceNs;
+        BenchResult first;
+        for (int r = 0; r < repeats; ++r) {
+            for (bool reference : {false, true}) {
+                BenchResult result = RunOnce(options, inputs, endMs, reference);
+                if (r == 0 && !reference) {
+                    first = result;
+                } else if (result.score != first.score || result.misses != first.misses) {
+                    std::printf("%2dK   results differ between runs\n", keys);
+                    return 1;
+                }
+                (reference ? referenceNs : pollNs).push_back(result.nsPerPoll);
+            }
+        }
+        std::sort(pollNs.begin(), pollNs.end());
+        std::sort(referenceNs.begin(), referenceNs.end());
+        double pollMedianNs = pollNs[pollNs.size() / 2];
+        double referenceMedianNs = referenceNs[referenceNs.size() / 2];
+        EffectsResult effects = RunEffects(options, inputs, endMs);
+        SaturatedResult saturated = RunSaturatedEffects(keys);
+        std::printf("%2dK   %-8zu  %6.1f ns    %6.1f ns     %6.1f ns    %5.2fx   %6.0f ns      %-9d  "
+                    "%6.0f / %6.0f / %6.0f ns\n",
+                    keys, chart.notes.size(), pollNs.front(), pollMedianNs, referenceMedianNs,
+                    referenceMedianNs / pollMedianNs, effects.nsPerFrame, effects.peakParticles, saturated.medianNs,
+                    saturated.p99Ns, saturated.p999Ns);
+    }
+    return 0;
+}
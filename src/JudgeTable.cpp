@@ -0,0 +1,82 @@
+#include "JudgeTable.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+int Grade(JudgeGrade grade) {
+    return static_cast<int>(grade);
+}
+
+JudgeTable ClassicJudgeTable() {
+    // 旧版判定：Perfect 80ms / Good 160ms，权重100/65
+    // Max、Great、Bad窗口与相邻档重合，永远不会落入
+    JudgeTable table;
+    table.windowsMs = {-1, 80, 80, 160, 160};
+    table.missWindowMs = 160;
+    table.scoreWeight[Grade(JudgeGrade::Perfect)] = 100;
+    table.scoreWeight[Grade(JudgeGrade::Good)] = 65;
+    table.accuracyWeight = table.scoreWeight;
+    table.maxScoreWeight = 100;
+    table.maxAccuracyWeight = 100;
+    return table;
+}
+}
+
+JudgeTable BuildJudgeTable(double overallDifficulty) {
+    // MAX固定16ms，其余各档随OD每级收紧3ms
+    double od = std::clamp(overallDifficulty, 0.0, 10.0);
+    JudgeTable table;
+    table.windowsMs = {
+        16,
+        static_cast<int>(std::floor(64.0 - 3.0 * od)),
+        static_cast<int>(std::floor(97.0 - 3.0 * od)),
+        static_cast<int>(std::floor(127.0 - 3.0 * od)),
+        static_cast<int>(std::floor(151.0 - 3.0 * od))
+    };
+    table.missWindowMs = static_cast<int>(std::floor(188.0 - 3.0 * od));
+
+    // 计分：MAX 320 / 300 / 200 / 100 / 50；ACC中MAX与300同为300
+    table.scoreWeight[Grade(JudgeGrade::Max)] = 320;
+    table.scoreWeight[Grade(JudgeGrade::Perfect)] = 300;
+    table.scoreWeight[Grade(JudgeGrade::Great)] = 200;
+    table.scoreWeight[Grade(JudgeGrade::Good)] = 100;
+    table.scoreWeight[Grade(JudgeGrade::Bad)] = 50;
+    table.accuracyWeight = table.scoreWeight;
+    table.accuracyWeight[Grade(JudgeGrade::Max)] = 300;
+    table.maxScoreWeight = 320;
+    table.maxAccuracyWeight = 300;
+    return table;
+}
+
+JudgeTable BuildJudgeTable(JudgePreset preset, double chartOverallDifficulty) {
+    switch (preset) {
+        case JudgePreset::ChartOD:
+            return BuildJudgeTable(chartOverallDifficulty);
+        case JudgePreset::Lenient:
+            return BuildJudgeTable(0.0);
+        case JudgePreset::Standard:
+            return BuildJudgeTable(5.0);
+        case JudgePreset::Strict:
+            return BuildJudgeTable(9.0);
+        case JudgePreset::Classic:
+            return ClassicJudgeTable();
+    }
+    return BuildJudgeTable(chartOverallDifficulty);
+}
+
+const char* JudgePresetName(JudgePreset preset) {
+    switch (preset) {
+        case JudgePreset::ChartOD:
+            return "CHART OD";
+        case JudgePreset::Lenient:
+            return "OD 0";
+        case JudgePreset::Standard:
+            return "OD 5";
+        case JudgePreset::Strict:
+            return "OD 9";
+        case JudgePreset::Classic:
+            return "CLASSIC";
+    }
+    return "";
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <array>
+
+enum class JudgeGrade {
+    // 判定等级（None之外按从好到坏排列）
+    None,
+    Max,
+    Perfect,
+    Great,
+    Good,
+    Bad,
+    Miss
+};
+
+constexpr int kJudgeGradeCount = 7;
+// 命中档位数（Max..Bad）
+constexpr int kHitTierCount = 5;
+
+enum class JudgePreset {
+    // 判定窗口来源：谱面OD、固定OD或旧版两档判定
+    ChartOD,
+    Lenient,
+    Standard,
+    Strict,
+    Classic
+};
+
+constexpr int kJudgePresetCount = 5;
+
+struct JudgeTable {
+    // 每档判定窗口（毫秒，单调递增；|偏差|<=窗口即落入该档）
+    std::array<int, kHitTierCount> windowsMs{};
+    // 提前超过此窗口的按键不响应；介于Bad与此窗口之间判Miss
+    int missWindowMs = 0;
+    // 计分与ACC权重，按JudgeGrade下标
+    std::array<int, kJudgeGradeCount> scoreWeight{};
+    std::array<int, kJudgeGradeCount> accuracyWeight{};
+    int maxScoreWeight = 1;
+    int maxAccuracyWeight = 1;
+
+    // 无分支查表：统计超过了几档窗口
+    JudgeGrade Classify(int absDeltaMs) const {
+        static constexpr JudgeGrade kTierGrades[kHitTierCount + 1] = {
+            JudgeGrade::Max, JudgeGrade::Perfect, JudgeGrade::Great,
+            JudgeGrade::Good, JudgeGrade::Bad, JudgeGrade::Miss};
+        int tier = static_cast<int>(absDeltaMs > windowsMs[0]) + static_cast<int>(absDeltaMs > windowsMs[1]) +
+                   static_cast<int>(absDeltaMs > windowsMs[2]) + static_cast<int>(absDeltaMs > windowsMs[3]) +
+                   static_cast<int>(absDeltaMs > windowsMs[4]);
+        return kTierGrades[tier];
+    }
+
+    int HitWindowMs() const { return windowsMs[kHitTierCount - 1]; }
+};
+
+// osu!mania的OD公式（OD限制在0~10）
+JudgeTable BuildJudgeTable(double overallDifficulty);
+
+// 根据预设生成判定表，ChartOD使用谱面自带OD
+JudgeTable BuildJudgeTable(JudgePreset preset, double chartOverallDifficulty);
+
+const char* JudgePresetName(JudgePreset preset);
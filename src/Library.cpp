@@ -0,0 +1,317 @@
+#include "Library.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+#include <unordered_map>
+
+#include "ChartBinary.h"
+#include "Difficulty.h"
+#include "Package.h"
+#include "Profiler.h"
+
+namespace {
+const char* kIndexHeader = "SimpleManiaLibrary 1";
+
+std::string Sanitize(const std::string& text) {
+    // 索引以制表符分隔，字段内的制表符与换行替换为空格
+    std::string result = text;
+    for (char& c : result) {
+        if (c == '\t' || c == '\n' || c == '\r') {
+            c = ' ';
+        }
+    }
+    return result;
+}
+
+std::vector<std::string> SplitTabs(const std::string& line) {
+    std::vector<std::string> parts;
+    size_t start = 0;
+    while (true) {
+        size_t tab = line.find('\t', start);
+        if (tab == std::string::npos) {
+            parts.push_back(line.substr(start));
+            break;
+        }
+        parts.push_back(line.substr(start, tab - start));
+        start = tab + 1;
+    }
+    return parts;
+}
+
+void AnalyzeEntry(ChartEntry& entry) {
+    // 解析谱面并计算难度，失败时保留文件名作为显示名
+    Chart chart;
+    std::string errorText;
+    if (LoadChartFile(entry.path, chart, errorText)) {
+        entry.title = chart.title;
+        entry.artist = chart.artist;
+        entry.version = chart.version;
+        entry.keyCount = chart.keyCount;
+        entry.noteCount = static_cast<int>(chart.notes.size());
+        entry.starRating = ComputeDifficulty(chart).starRating;
+        if (!chart.title.empty() && !chart.version.empty()) {
+            entry.label = chart.title + " - " + chart.version;
+        } else if (!chart.title.empty()) {
+            entry.label = chart.title;
+        }
+    }
+    if (entry.label.empty()) {
+        entry.label = std::filesystem::path(entry.path).stem().string();
+    }
+}
+
+bool IsChartFile(const std::filesystem::path& path) {
+    std::string extension = path.extension().string();
+    return extension == ".osu" || extension == ".smc";
+}
+
+bool StatEntry(ChartEntry& entry) {
+    // 包内谱面以解压后大小与包的修改时间判断是否过期
+    std::string archivePath;
+    std::string entryName;
+    if (SplitPackagePath(entry.path, archivePath, entryName)) {
+        std::string packageError;
+        std::shared_ptr<const ZipArchive> archive = OpenPackage(archivePath, packageError);
+        const PackageEntry* packageEntry = archive ? archive->Find(entryName) : nullptr;
+        if (!packageEntry) {
+            return false;
+        }
+        entry.fileSize = static_cast<int64_t>(packageEntry->size);
+        entry.modifiedTime = archive->GetModifiedTime();
+        return true;
+    }
+    std::error_code error;
+    std::filesystem::path path(entry.path);
+    if (!std::filesystem::is_regular_file(path, error)) {
+        return false;
+    }
+    entry.fileSize = static_cast<int64_t>(std::filesystem::file_size(path, error));
+    entry.modifiedTime = static_cast<int64_t>(std::filesystem::last_write_time(path, error).time_since_epoch().count());
+    return true;
+}
+
+void AppendPackageCharts(const std::string& archivePath, std::vector<ChartEntry>& entries) {
+    // 只读包的中央目录，谱面内容等到需要解析时才解压
+    std::string error;
+    std::shared_ptr<const ZipArchive> archive = OpenPackage(archivePath, error);
+    if (!archive) {
+        std::printf("Skipping package: %s\n", error.c_str());
+        return;
+    }
+    for (const PackageEntry& packageEntry : archive->GetEntries()) {
+        if (std::filesystem::path(packageEntry.name).extension() != ".osu") {
+            continue;
+        }
+        ChartEntry entry;
+        entry.path = archivePath + "/" + packageEntry.name;
+        entry.fileSize = static_cast<int64_t>(packageEntry.size);
+        entry.modifiedTime = archive->GetModifiedTime();
+        entries.push_back(entry);
+    }
+}
+
+void SortEntries(std::vector<ChartEntry>& entries) {
+    std::sort(entries.begin(), entries.end(), [](const ChartEntry& a, const ChartEntry& b) {
+        return a.label != b.label ? a.label < b.label : a.path < b.path;
+    });
+}
+
+void AnalyzeEntries(std::vector<ChartEntry>& entries, const std::vector<size_t>& pending, int threadCount) {
+    // 工作线程从共享下标领取任务，各自写入不同的entry
+    if (pending.empty()) {
+        return;
+    }
+    if (threadCount <= 0) {
+        threadCount = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    }
+    threadCount = std::min<int>(threadCount, static_cast<int>(pending.size()));
+
+    std::atomic<size_t> next{0};
+    auto worker = [&]() {
+        PROFILE_THREAD_NAME("LibraryScan");
+        for (size_t i = next.fetch_add(1); i < pending.size(); i = next.fetch_add(1)) {
+            AnalyzeEntry(entries[pending[i]]);
+        }
+    };
+    std::vector<std::thread> threads;
+    threads.reserve(threadCount - 1);
+    for (int t = 1; t < threadCount; ++t) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+}
+
+std::vector<ChartEntry> ScanCharts(const std::string& rootPath, const std::string& indexPath, int threadCount) {
+    PROFILE_ZONE("ScanCharts");
+    std::vector<ChartEntry> entries;
+    std::error_code error;
+    if (!std::filesystem::exists(rootPath, error)) {
+        std::filesystem::create_directories(rootPath, error);
+        return entries;
+    }
+
+    for (const auto& dirEntry : std::filesystem::directory_iterator(rootPath)) {
+        if (dirEntry.is_regular_file() && IsPackagePath(dirEntry.path().string())) {
+            AppendPackageCharts(dirEntry.path().string(), entries);
+            continue;
+        }
+        if (!dirEntry.is_directory()) {
+            continue;
+        }
+        for (const auto& fileEntry : std::filesystem::directory_iterator(dirEntry.path())) {
+            std::string extension = fileEntry.path().extension().string();
+            if (!fileEntry.is_regular_file() || (extension != ".osu" && extension != ".smc")) {
+                continue;
+            }
+            ChartEntry entry;
+            entry.path = fileEntry.path().string();
+            entry.fileSize = static_cast<int64_t>(fileEntry.file_size(error));
+            entry.modifiedTime = static_cast<int64_t>(fileEntry.last_write_time(error).time_since_epoch().count());
+            entries.push_back(entry);
+        }
+    }
+
+    // 大小与修改时间都没变的谱面直接使用索引中的结果
+    std::vector<ChartEntry> indexed;
+    LoadLibraryIndex(indexPath, indexed);
+    std::unordered_map<std::string, const ChartEntry*> byPath;
+    for (const auto& cached : indexed) {
+        byPath[cached.path] = &cached;
+    }
+    std::vector<size_t> pending;
+    for (size_t i = 0; i < entries.size(); ++i) {
+        auto it = byPath.find(entries[i].path);
+        if (it != byPath.end() && it->second->fileSize == entries[i].fileSize &&
+            it->second->modifiedTime == entries[i].modifiedTime) {
+            entries[i] = *it->second;
+        } else {
+            pending.push_back(i);
+        }
+    }
+    AnalyzeEntries(entries, pending, threadCount);
+
+    SortEntries(entries);
+    if (!pending.empty() || indexed.size() != entries.size()) {
+        SaveLibraryIndex(indexPath, entries);
+    }
+    return entries;
+}
+
+bool RefreshLibraryEntries(const std::vector<std::string>& paths, std::vector<ChartEntry>& entries) {
+    PROFILE_ZONE("RefreshLibraryEntries");
+    // 展开目录与.osz包：其中现有的谱面文件，加上库里位于其下的条目（处理整个目录或包被删除或移走）
+    std::vector<std::string> files;
+    std::error_code error;
+    for (const std::string& path : paths) {
+        if (IsChartFile(path)) {
+            files.push_back(path);
+            continue;
+        }
+        std::string prefix = path + "/";
+        for (const ChartEntry& entry : entries) {
+            if (entry.path.compare(0, prefix.size(), prefix) == 0) {
+                files.push_back(entry.path);
+            }
+        }
+        if (IsPackagePath(path) && std::filesystem::is_regular_file(path, error)) {
+            std::vector<ChartEntry> packaged;
+            AppendPackageCharts(path, packaged);
+            for (const ChartEntry& entry : packaged) {
+                files.push_back(entry.path);
+            }
+        } else if (std::filesystem::is_directory(path, error)) {
+            for (const auto& fileEntry : std::filesystem::directory_iterator(path, error)) {
+                if (fileEntry.is_regular_file() && IsChartFile(fileEntry.path())) {
+                    files.push_back(fileEntry.path().string());
+                }
+            }
+        }
+    }
+    std::sort(files.begin(), files.end());
+    files.erase(std::unique(files.begin(), files.end()), files.end());
+
+    bool changed = false;
+    for (const std::string& file : files) {
+        auto it = std::find_if(entries.begin(), entries.end(),
+                               [&](const ChartEntry& entry) { return entry.path == file; });
+        ChartEntry entry;
+        entry.path = file;
+        if (!StatEntry(entry)) {
+            if (it != entries.end()) {
+                entries.erase(it);
+                changed = true;
+            }
+            continue;
+        }
+        if (it != entries.end() && it->fileSize == entry.fileSize && it->modifiedTime == entry.modifiedTime) {
+            continue;
+        }
+        AnalyzeEntry(entry);
+        if (it != entries.end()) {
+            *it = std::move(entry);
+        } else {
+            entries.push_back(std::move(entry));
+        }
+        changed = true;
+    }
+    if (changed) {
+        SortEntries(entries);
+    }
+    return changed;
+}
+
+bool LoadLibraryIndex(const std::string& indexPath, std::vector<ChartEntry>& entries) {
+    std::ifstream file(indexPath);
+    if (!file.is_open()) {
+        return false;
+    }
+    std::string line;
+    if (!std::getline(file, line) || line != kIndexHeader) {
+        return false;
+    }
+    while (std::getline(file, line)) {
+        auto parts = SplitTabs(line);
+        if (parts.size() < 10) {
+            continue;
+        }
+        ChartEntry entry;
+        entry.path = parts[0];
+        entry.fileSize = std::strtoll(parts[1].c_str(), nullptr, 10);
+        entry.modifiedTime = std::strtoll(parts[2].c_str(), nullptr, 10);
+        entry.keyCount = std::atoi(parts[3].c_str());
+        entry.noteCount = std::atoi(parts[4].c_str());
+        entry.starRating = std::atof(parts[5].c_str());
+        entry.label = parts[6];
+        entry.title = parts[7];
+        entry.artist = parts[8];
+        entry.version = parts[9];
+        entries.push_back(entry);
+    }
+    return true;
+}
+
+bool SaveLibraryIndex(const std::string& indexPath, const std::vector<ChartEntry>& entries) {
+    std::ofstream file(indexPath, std::ios::trunc);
+    if (!file.is_open()) {
+        std::printf("Failed to write library index: %s\n", indexPath.c_str());
+        return false;
+    }
+    file << kIndexHeader << '\n';
+    char numbers[96];
+    for (const auto& entry : entries) {
+        std::snprintf(numbers, sizeof(numbers), "%lld\t%lld\t%d\t%d\t%.4f",
+                      static_cast<long long>(entry.fileSize), static_cast<long long>(entry.modifiedTime),
+                      entry.keyCount, entry.noteCount, entry.starRating);
+        file << Sanitize(entry.path) << '\t' << numbers << '\t' << Sanitize(entry.label) << '\t'
+             << Sanitize(entry.title) << '\t' << Sanitize(entry.artist) << '\t' << Sanitize(entry.version) << '\n';
+    }
+    return true;
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct ChartEntry {
+    // 谱面库索引项：显示名、路径、元数据与预先算好的难度
+    std::string label;
+    std::string path;
+    std::string title;
+    std::string artist;
+    std::string version;
+    int keyCount = 0;
+    int noteCount = 0;
+    double starRating = 0.0;
+    // 用于判断索引是否过期
+    int64_t fileSize = 0;
+    int64_t modifiedTime = 0;
+};
+
+// 扫描rootPath下各子目录的.osu/.smc谱面与根目录下.osz包里的.osu谱面；索引命中的直接复用，其余在threadCount个线程上
+// 并行解析并计算难度，最后写回索引。threadCount<=0时使用全部核心
+std::vector<ChartEntry> ScanCharts(const std::string& rootPath, const std::string& indexPath,
+                                   int threadCount = 0);
+
+// 增量更新：paths为变化的谱面文件、子目录或.osz包（目录与包表示其下全部谱面）。只重新解析大小或修改时间变了的
+// 文件，已删除的移除，新增的插入，之后保持与ScanCharts相同的排序；返回是否有条目变化
+bool RefreshLibraryEntries(const std::vector<std::string>& paths, std::vector<ChartEntry>& entries);
+
+// 读写库索引（文本格式，每行一个谱面）
+bool LoadLibraryIndex(const std::string& indexPath, std::vector<ChartEntry>& entries);
+bool SaveLibraryIndex(const std::string& indexPath, const std::vector<ChartEntry>& entries);
@@ -1,174 +1,304 @@
 #include "OsuParser.h"
 
 #include <algorithm>
-#include <cctype>
-#include <fstream>
-#include <sstream>
-#include <vector>
+#include <charconv>
+#include <cstdio>
+#include <string_view>
+
+#include "Package.h"
+#include "Profiler.h"
 
 namespace {
-// 去掉行首尾空白
-std::string Trim(const std::string& text) {
+bool IsSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\f' || c == '\v';
+}
+
+// 去掉首尾空白（只移动视图，不复制）
+std::string_view Trim(std::string_view text) {
     size_t start = 0;
-    while (start < text.size() && std::isspace(static_cast<unsigned char>(text[start]))) {
+    while (start < text.size() && IsSpace(text[start])) {
         ++start;
     }
     size_t end = text.size();
-    while (end > start && std::isspace(static_cast<unsigned char>(text[end - 1]))) {
+    while (end > start && IsSpace(text[end - 1])) {
         --end;
     }
     return text.substr(start, end - start);
 }
 
-// 简单分割
-std::vector<std::string> Split(const std::string& text, char delim) {
-    std::vector<std::string> parts;
-    std::string item;
-    std::stringstream stream(text);
-    while (std::getline(stream, item, delim)) {
-        parts.push_back(item);
-    }
-    return parts;
+// 取出下一个以delim分隔的字段，并把text推进到字段之后
+std::string_view NextField(std::string_view& text, char delim) {
+    size_t pos = text.find(delim);
+    std::string_view field = text.substr(0, pos);
+    text = pos == std::string_view::npos ? std::string_view() : text.substr(pos + 1);
+    return field;
 }
 
-// 解析整数
-int ParseInt(const std::string& value, int fallback = 0) {
-    try {
-        return std::stoi(value);
-    } catch (...) {
-        return fallback;
+// 解析整数（osu坐标与时间偶尔写成小数，截断小数部分）
+int ParseInt(std::string_view value, int fallback = 0) {
+    value = Trim(value);
+    if (!value.empty() && value.front() == '+') {
+        value.remove_prefix(1);
     }
+    int result = fallback;
+    auto parsed = std::from_chars(value.data(), value.data() + value.size(), result);
+    return parsed.ec == std::errc() ? result : fallback;
 }
 
 // 解析浮点数
-double ParseDouble(const std::string& value, double fallback = 0.0) {
-    try {
-        return std::stod(value);
-    } catch (...) {
-        return fallback;
+double ParseDouble(std::string_view value, double fallback = 0.0) {
+    value = Trim(value);
+    if (!value.empty() && value.front() == '+') {
+        value.remove_prefix(1);
     }
-}
+    double result = fallback;
+    auto parsed = std::from_chars(value.data(), value.data() + value.size(), result);
+    return parsed.ec == std::errc() ? result : fallback;
 }
 
-bool ParseOsuFile(const std::string& path, Chart& outChart, std::string& error) {
-    // 读取osu文本并解析必要段落
-    std::ifstream file(path);
-    if (!file.is_open()) {
-        error = "Failed to open osu file: " + path;
-        return false;
+struct SectionCounts {
+    // 预扫描得到的各段行数，用于一次性预留容量
+    size_t timingLines = 0;
+    size_t hitObjectLines = 0;
+};
+
+SectionCounts CountSectionLines(std::string_view text) {
+    SectionCounts counts;
+    size_t* current = nullptr;
+    while (!text.empty()) {
+        std::string_view line = Trim(NextField(text, '\n'));
+        if (line.empty()) {
+            continue;
+        }
+        if (line.front() == '[') {
+            current = line == "[TimingPoints]" ? &counts.timingLines
+                    : line == "[HitObjects]"   ? &counts.hitObjectLines
+                                               : nullptr;
+        } else if (current) {
+            ++*current;
+        }
     }
+    return counts;
+}
 
-    std::string section;
+struct HeaderState {
+    // 逐行解析时的当前段与需要跨行记住的信息
+    std::string_view section;
     int mode = -1;
     bool hasTimingBpm = false;
-    outChart = Chart();
+};
 
-    std::string line;
-    while (std::getline(file, line)) {
-        line = Trim(line);
-        if (line.empty() || line.rfind("//", 0) == 0) {
-            continue;
-        }
-        if (line.front() == '[' && line.back() == ']') {
-            section = line.substr(1, line.size() - 2);
-            continue;
+// 解析[HitObjects]之外的一行（元数据、难度与时间点）
+void ParseHeaderLine(std::string_view line, HeaderState& state, Chart& chart) {
+    std::string_view section = state.section;
+    if (section == "General" || section == "Difficulty" || section == "Metadata") {
+        size_t colon = line.find(':');
+        if (colon == std::string_view::npos) {
+            return;
         }
+        std::string_view key = Trim(line.substr(0, colon));
+        std::string_view value = Trim(line.substr(colon + 1));
 
-        if (section == "General" || section == "Difficulty" || section == "Metadata") {
-            auto split = Split(line, ':');
-            if (split.size() < 2) {
-                continue;
+        if (section == "General") {
+            if (key == "AudioFilename") {
+                chart.audioFilename = value;
+            } else if (key == "PreviewTime") {
+                chart.previewTimeMs = ParseInt(value, -1);
+            } else if (key == "Mode") {
+                state.mode = ParseInt(value, -1);
             }
-            std::string key = Trim(split[0]);
-            std::string value = Trim(line.substr(line.find(':') + 1));
-
-            if (section == "General") {
-                if (key == "AudioFilename") {
-                    outChart.audioFilename = value;
-                } else if (key == "Mode") {
-                    mode = ParseInt(value, -1);
-                }
-            } else if (section == "Difficulty") {
-                if (key == "CircleSize") {
-                    outChart.keyCount = std::max(1, ParseInt(value, outChart.keyCount));
-                }
-            } else if (section == "Metadata") {
-                if (key == "Title") {
-                    outChart.title = value;
-                } else if (key == "Artist") {
-                    outChart.artist = value;
-                } else if (key == "Version") {
-                    outChart.version = value;
-                }
+        } else if (section == "Difficulty") {
+            if (key == "CircleSize") {
+                chart.keyCount = std::clamp(ParseInt(value, chart.keyCount), 1, kMaxLanes);
+            } else if (key == "OverallDifficulty") {
+                chart.overallDifficulty = ParseDouble(value, chart.overallDifficulty);
+            }
+        } else if (section == "Metadata") {
+            if (key == "Title") {
+                chart.title = value;
+            } else if (key == "Artist") {
+                chart.artist = value;
+            } else if (key == "Version") {
+                chart.version = value;
             }
-            continue;
         }
+        return;
+    }
 
-        if (section == "TimingPoints") {
-            auto split = Split(line, ',');
-            if (split.size() >= 2) {
-                TimingPoint point;
-                point.timeMs = ParseDouble(split[0]);
-                point.beatLengthMs = ParseDouble(split[1]);
-                point.meter = split.size() >= 3 ? ParseInt(split[2], 4) : 4;
-                point.inherited = point.beatLengthMs < 0.0;
-                outChart.timingPoints.push_back(point);
-                if (!point.inherited && point.beatLengthMs > 0.0 && !hasTimingBpm) {
-                    outChart.baseBpm = 60000.0 / point.beatLengthMs;
-                    hasTimingBpm = true;
-                }
-            }
-            continue;
+    if (section == "TimingPoints") {
+        std::string_view rest = line;
+        std::string_view timeField = NextField(rest, ',');
+        if (rest.empty()) {
+            return;
+        }
+        std::string_view beatField = NextField(rest, ',');
+        TimingPoint point;
+        point.timeMs = ParseDouble(timeField);
+        point.beatLengthMs = ParseDouble(beatField);
+        point.meter = rest.empty() ? 4 : ParseInt(NextField(rest, ','), 4);
+        point.inherited = point.beatLengthMs < 0.0;
+        chart.timingPoints.push_back(point);
+        if (!point.inherited && point.beatLengthMs > 0.0 && !state.hasTimingBpm) {
+            chart.baseBpm = 60000.0 / point.beatLengthMs;
+            state.hasTimingBpm = true;
         }
+    }
+}
 
-        if (section == "HitObjects") {
-            auto split = Split(line, ',');
-            if (split.size() < 5) {
-                continue;
-            }
-            int x = ParseInt(split[0]);
-            int timeMs = ParseInt(split[2]);
-            int type = ParseInt(split[3]);
-            bool isHold = (type & 128) != 0;
-            int lane = 0;
-            if (outChart.keyCount > 0) {
-                lane = static_cast<int>(x * outChart.keyCount / 512);
-                if (lane < 0) {
-                    lane = 0;
-                } else if (lane >= outChart.keyCount) {
-                    lane = outChart.keyCount - 1;
-                }
-            }
-            int endTimeMs = timeMs;
-            if (isHold && split.size() >= 6) {
-                std::string params = split[5];
-                auto colon = params.find(':');
-                if (colon != std::string::npos) {
-                    endTimeMs = ParseInt(params.substr(0, colon), timeMs);
-                }
-            }
+// 解析[HitObjects]中的一行：x,y,time,type,hitSound[,endTime:extras]
+bool ParseHitObject(std::string_view line, int keyCount, Note& note) {
+    std::string_view fields[6];
+    std::string_view rest = line;
+    int fieldCount = 0;
+    while (fieldCount < 6 && !rest.empty()) {
+        fields[fieldCount++] = NextField(rest, ',');
+    }
+    if (fieldCount < 5) {
+        return false;
+    }
+    int x = ParseInt(fields[0]);
+    int timeMs = ParseInt(fields[2]);
+    int type = ParseInt(fields[3]);
+    bool isHold = (type & 128) != 0;
+    int endTimeMs = timeMs;
+    if (isHold && fieldCount >= 6) {
+        std::string_view params = fields[5];
+        size_t colon = params.find(':');
+        if (colon != std::string_view::npos) {
+            endTimeMs = ParseInt(params.substr(0, colon), timeMs);
+        }
+    }
+    note.lane = std::clamp(static_cast<int>(x * keyCount / 512), 0, keyCount - 1);
+    note.timeMs = timeMs;
+    note.endTimeMs = endTimeMs;
+    note.isHold = isHold;
+    return true;
+}
 
+bool ReadOsuText(const std::string& path, std::string& data, std::string_view& text, std::string& error) {
+    // 整个文件（或.osz包内条目解压后的内容）读入一块缓冲，去掉UTF-8 BOM
+    std::string readError;
+    if (!ReadDataFile(path, data, readError)) {
+        error = "Failed to open osu file: " + readError;
+        return false;
+    }
+    text = data;
+    if (text.size() >= 3 && text.substr(0, 3) == "\xEF\xBB\xBF") {
+        text.remove_prefix(3);
+    }
+    return true;
+}
+
+Chart MakeChartForCounts(const SectionCounts& counts) {
+    // 谱面数据全部放进预估大小的arena
+    size_t arenaBytes = counts.timingLines * sizeof(TimingPoint) + counts.hitObjectLines * sizeof(Note) + 4096;
+    Chart chart(arenaBytes);
+    chart.timingPoints.reserve(counts.timingLines);
+    chart.notes.reserve(counts.hitObjectLines);
+    return chart;
+}
+}
+
+bool ParseOsuFile(const std::string& path, Chart& outChart, std::string& error) {
+    // 整块缓冲按视图逐行解析
+    PROFILE_ZONE("ParseOsuFile");
+    std::string data;
+    std::string_view text;
+    if (!ReadOsuText(path, data, text, error)) {
+        return false;
+    }
+    Chart chart = MakeChartForCounts(CountSectionLines(text));
+    HeaderState state;
+    while (!text.empty()) {
+        std::string_view line = Trim(NextField(text, '\n'));
+        if (line.empty() || line.substr(0, 2) == "//") {
+            continue;
+        }
+        if (line.front() == '[' && line.back() == ']') {
+            state.section = line.substr(1, line.size() - 2);
+            continue;
+        }
+        if (state.section == "HitObjects") {
             Note note;
-            note.lane = lane;
-            note.timeMs = timeMs;
-            note.endTimeMs = endTimeMs;
-            note.isHold = isHold;
-            outChart.notes.push_back(note);
+            if (ParseHitObject(line, chart.keyCount, note)) {
+                chart.notes.push_back(note);
+            }
+        } else {
+            ParseHeaderLine(line, state, chart);
         }
     }
 
-    if (mode != -1 && mode != 3) {
+    if (state.mode != -1 && state.mode != 3) {
         error = "Only osu!mania (Mode=3) is supported.";
         return false;
     }
 
-    std::sort(outChart.notes.begin(), outChart.notes.end(), [](const Note& a, const Note& b) {
+    std::stable_sort(chart.notes.begin(), chart.notes.end(), [](const Note& a, const Note& b) {
         return a.timeMs < b.timeMs;
     });
 
-    if (outChart.notes.empty()) {
+    if (chart.notes.empty()) {
+        error = "No notes found in osu file.";
+        return false;
+    }
+    outChart = std::move(chart);
+    return true;
+}
+
+bool OsuNoteStream::Open(const std::string& path, Chart& header, std::string& error) {
+    // [HitObjects]一般是最后一段：之前的内容同步解析，余下的文本留给Next
+    PROFILE_ZONE("OsuNoteStream::Open");
+    rest_ = std::string_view();
+    std::string_view text;
+    if (!ReadOsuText(path, data_, text, error)) {
+        return false;
+    }
+    SectionCounts counts = CountSectionLines(text);
+    if (counts.hitObjectLines == 0) {
         error = "No notes found in osu file.";
         return false;
     }
+    Chart chart = MakeChartForCounts(counts);
+    HeaderState state;
+    while (!text.empty() && state.section != "HitObjects") {
+        std::string_view line = Trim(NextField(text, '\n'));
+        if (line.empty() || line.substr(0, 2) == "//") {
+            continue;
+        }
+        if (line.front() == '[' && line.back() == ']') {
+            state.section = line.substr(1, line.size() - 2);
+            continue;
+        }
+        ParseHeaderLine(line, state, chart);
+    }
+    if (state.mode != -1 && state.mode != 3) {
+        error = "Only osu!mania (Mode=3) is supported.";
+        return false;
+    }
+    keyCount_ = chart.keyCount;
+    expectedNotes_ = counts.hitObjectLines;
+    rest_ = text;
+    header = std::move(chart);
     return true;
 }
+
+size_t OsuNoteStream::Next(size_t maxNotes, std::vector<Note>& out) {
+    size_t parsed = 0;
+    while (parsed < maxNotes && !rest_.empty()) {
+        std::string_view line = Trim(NextField(rest_, '\n'));
+        if (line.empty() || line.substr(0, 2) == "//") {
+            continue;
+        }
+        if (line.front() == '[' && line.back() == ']') {
+            // [HitObjects]之后的段不含音符
+            rest_ = std::string_view();
+            break;
+        }
+        Note note;
+        if (ParseHitObject(line, keyCount_, note)) {
+            out.push_back(note);
+            ++parsed;
+        }
+    }
+    return parsed;
+}
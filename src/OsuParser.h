@@ -1,8 +1,28 @@
 #pragma once
 
 #include <string>
+#include <string_view>
+#include <vector>
 
 #include "Chart.h"
 
 // 读取osu!mania谱面并填充Chart结构
 bool ParseOsuFile(const std::string& path, Chart& outChart, std::string& error);
+
+class OsuNoteStream {
+public:
+    // 流式解析超大谱面：Open读入文件并解析[HitObjects]之前的元数据与时间点（header不含音符，
+    // arena按音符行数预留），之后Next按文件顺序逐批解析音符
+    bool Open(const std::string& path, Chart& header, std::string& error);
+    // 追加至多maxNotes个音符到out，返回本次解析的数量（0表示已到末尾）
+    size_t Next(size_t maxNotes, std::vector<Note>& out);
+    bool Done() const { return rest_.empty(); }
+    // [HitObjects]段的行数（音符数的上限）
+    size_t GetExpectedNotes() const { return expectedNotes_; }
+
+private:
+    std::string data_;
+    std::string_view rest_;
+    int keyCount_ = 4;
+    size_t expectedNotes_ = 0;
+};
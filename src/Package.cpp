@@ -0,0 +1,828 @@
+#include "Package.h"
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <mutex>
+#include <unordered_map>
+
+#include "Profiler.h"
+
+namespace {
+constexpr uint32_t kLocalHeaderSignature = 0x04034b50;
+constexpr uint32_t kCentralHeaderSignature = 0x02014b50;
+constexpr uint32_t kEndOfDirectorySignature = 0x06054b50;
+constexpr size_t kLocalHeaderSize = 30;
+constexpr size_t kCentralHeaderSize = 46;
+constexpr size_t kEndOfDirectorySize = 22;
+constexpr size_t kInputBufferSize = 64 * 1024;
+// deflate每个输入字节最多展开约1032字节；单个条目（谱面、音频、背景图）超过512MB视为损坏
+constexpr uint64_t kMaxDeflateRatio = 1032;
+constexpr uint64_t kMaxEntrySize = 512ull * 1024 * 1024;
+
+uint16_t ReadU16(const unsigned char* data) {
+    return static_cast<uint16_t>(data[0] | (data[1] << 8));
+}
+
+uint32_t ReadU32(const unsigned char* data) {
+    return static_cast<uint32_t>(data[0]) | (static_cast<uint32_t>(data[1]) << 8) |
+           (static_cast<uint32_t>(data[2]) << 16) | (static_cast<uint32_t>(data[3]) << 24);
+}
+
+std::string ToLower(std::string text) {
+    for (char& c : text) {
+        c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    }
+    return text;
+}
+
+class BitInput {
+public:
+    // 从文件当前位置顺序读取压缩数据，低位在先；缓冲读空时再从文件补充
+    BitInput(std::FILE* file, uint64_t remaining) : file_(file), remaining_(remaining) {}
+
+    // 尽量把位缓冲补到57位以上，返回可用位数（流末尾时可能不足）
+    int Fill() {
+        while (count_ <= 56) {
+            if (pos_ == length_ && !Refill()) {
+                break;
+            }
+            bits_ |= static_cast<uint64_t>(buffer_[pos_++]) << count_;
+            count_ += 8;
+        }
+        return count_;
+    }
+
+    bool Bits(int n, uint32_t& value) {
+        if (n == 0) {
+            value = 0;
+            return true;
+        }
+        if (count_ < n && Fill() < n) {
+            return false;
+        }
+        value = static_cast<uint32_t>(bits_ & ((uint64_t{1} << n) - 1));
+        Drop(n);
+        return true;
+    }
+
+    uint64_t Peek() const { return bits_; }
+    int Count() const { return count_; }
+    void Drop(int n) {
+        bits_ >>= n;
+        count_ -= n;
+    }
+    void AlignToByte() { Drop(count_ % 8); }
+
+    // 存储块：先取位缓冲里剩下的整字节，其余直接从输入缓冲与文件复制
+    bool Copy(unsigned char* out, size_t size) {
+        while (size > 0 && count_ >= 8) {
+            *out++ = static_cast<unsigned char>(bits_ & 0xFF);
+            Drop(8);
+            --size;
+        }
+        while (size > 0) {
+            if (pos_ == length_ && !Refill()) {
+                return false;
+            }
+            size_t chunk = std::min(size, length_ - pos_);
+            std::memcpy(out, buffer_.data() + pos_, chunk);
+            pos_ += chunk;
+            out += chunk;
+            size -= chunk;
+        }
+        return true;
+    }
+
+private:
+    bool Refill() {
+        size_t want = static_cast<size_t>(std::min<uint64_t>(remaining_, buffer_.size()));
+        if (want == 0) {
+            return false;
+        }
+        length_ = std::fread(buffer_.data(), 1, want, file_);
+        pos_ = 0;
+        remaining_ -= length_;
+        return length_ > 0;
+    }
+
+    std::FILE* file_;
+    uint64_t remaining_;
+    std::array<unsigned char, kInputBufferSize> buffer_;
+    size_t pos_ = 0;
+    size_t length_ = 0;
+    uint64_t bits_ = 0;
+    int count_ = 0;
+};
+
+struct Huffman {
+    // 查表解码：下标为按位反转后的maxLength位码字，值为(符号 << 4) | 码长，码长0表示无效码
+    std::vector<uint16_t> table;
+    int maxLength = 0;
+};
+
+bool BuildHuffman(Huffman& huffman, const uint8_t* lengths, int count) {
+    std::array<int, 16> lengthCount{};
+    for (int i = 0; i < count; ++i) {
+        ++lengthCount[lengths[i]];
+    }
+    lengthCount[0] = 0;
+    huffman.maxLength = 0;
+    int left = 1;
+    for (int length = 1; length < 16; ++length) {
+        left = (left << 1) - lengthCount[length];
+        if (left < 0) {
+            return false;
+        }
+        if (lengthCount[length] > 0) {
+            huffman.maxLength = length;
+        }
+    }
+    // 范式哈夫曼：同码长的码字按符号顺序连续分配
+    std::array<int, 16> nextCode{};
+    int code = 0;
+    for (int length = 1; length < 16; ++length) {
+        code = (code + lengthCount[length - 1]) << 1;
+        nextCode[length] = code;
+    }
+    huffman.table.assign(size_t{1} << huffman.maxLength, 0);
+    for (int symbol = 0; symbol < count; ++symbol) {
+        int length = lengths[symbol];
+        if (length == 0) {
+            continue;
+        }
+        int value = nextCode[length]++;
+        int reversed = 0;
+        for (int bit = 0; bit < length; ++bit) {
+            reversed = (reversed << 1) | ((value >> bit) & 1);
+        }
+        uint16_t entry = static_cast<uint16_t>((symbol << 4) | length);
+        for (size_t i = static_cast<size_t>(reversed); i < huffman.table.size(); i += size_t{1} << length) {
+            huffman.table[i] = entry;
+        }
+    }
+    return true;
+}
+
+bool Decode(BitInput& input, const Huffman& huffman, int& symbol) {
+    if (huffman.maxLength == 0) {
+        return false;
+    }
+    if (input.Count() < huffman.maxLength) {
+        input.Fill();
+    }
+    uint16_t entry = huffman.table[input.Peek() & ((uint64_t{1} << huffman.maxLength) - 1)];
+    int length = entry & 15;
+    if (length == 0 || length > input.Count()) {
+        return false;
+    }
+    input.Drop(length);
+    symbol = entry >> 4;
+    return true;
+}
+
+const uint16_t kLengthBase[29] = {3,  4,  5,  6,  7,  8,  9,  10, 11,  13,  15,  17,  19,  23, 27,
+                                  31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+const uint8_t kLengthExtra[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2,
+                                  2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+const uint16_t kDistanceBase[30] = {1,    2,    3,    4,    5,    7,     9,     13,    17,  25,
+                                    33,   49,   65,   97,   129,  193,   257,   385,   513, 769,
+                                    1025, 1537, 2049, 3073, 4097, 6145,  8193,  12289, 16385, 24577};
+const uint8_t kDistanceExtra[30] = {0, 0, 0, 0, 1, 1, 2, 2,  3,  3,  4,  4,  5,  5,  6,
+                                    6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+const uint8_t kCodeLengthOrder[19] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+
+bool ReadDynamicTables(BitInput& input, Huffman& literals, Huffman& distances) {
+    uint32_t literalCount = 0;
+    uint32_t distanceCount = 0;
+    uint32_t codeLengthCount = 0;
+    if (!input.Bits(5, literalCount) || !input.Bits(5, distanceCount) || !input.Bits(4, codeLengthCount)) {
+        return false;
+    }
+    literalCount += 257;
+    distanceCount += 1;
+    codeLengthCount += 4;
+    if (literalCount > 286 || distanceCount > 30) {
+        return false;
+    }
+    std::array<uint8_t, 19> codeLengthLengths{};
+    for (uint32_t i = 0; i < codeLengthCount; ++i) {
+        uint32_t value = 0;
+        if (!input.Bits(3, value)) {
+            return false;
+        }
+        codeLengthLengths[kCodeLengthOrder[i]] = static_cast<uint8_t>(value);
+    }
+    Huffman codeLengths;
+    if (!BuildHuffman(codeLengths, codeLengthLengths.data(), 19)) {
+        return false;
+    }
+    // 字面量与距离的码长连续编码，重复码可以跨过两者的分界
+    std::array<uint8_t, 286 + 30> lengths{};
+    uint32_t total = literalCount + distanceCount;
+    for (uint32_t index = 0; index < total;) {
+        int symbol = 0;
+        if (!Decode(input, codeLengths, symbol)) {
+            return false;
+        }
+        if (symbol < 16) {
+            lengths[index++] = static_cast<uint8_t>(symbol);
+            continue;
+        }
+        uint8_t repeatValue = 0;
+        uint32_t repeat = 0;
+        if (symbol == 16) {
+            if (index == 0 || !input.Bits(2, repeat)) {
+                return false;
+            }
+            repeatValue = lengths[index - 1];
+            repeat += 3;
+        } else if (symbol == 17) {
+            if (!input.Bits(3, repeat)) {
+                return false;
+            }
+            repeat += 3;
+        } else {
+            if (!input.Bits(7, repeat)) {
+                return false;
+            }
+            repeat += 11;
+        }
+        if (index + repeat > total) {
+            return false;
+        }
+        std::fill_n(lengths.begin() + index, repeat, repeatValue);
+        index += repeat;
+    }
+    if (lengths[256] == 0) {
+        return false;
+    }
+    return BuildHuffman(literals, lengths.data(), static_cast<int>(literalCount)) &&
+           BuildHuffman(distances, lengths.data() + literalCount, static_cast<int>(distanceCount));
+}
+
+const std::pair<Huffman, Huffman>& FixedTables() {
+    static const std::pair<Huffman, Huffman> tables = []() {
+        std::array<uint8_t, 288> lengths{};
+        std::fill(lengths.begin(), lengths.begin() + 144, 8);
+        std::fill(lengths.begin() + 144, lengths.begin() + 256, 9);
+        std::fill(lengths.begin() + 256, lengths.begin() + 280, 7);
+        std::fill(lengths.begin() + 280, lengths.end(), 8);
+        std::array<uint8_t, 30> distanceLengths{};
+        distanceLengths.fill(5);
+        std::pair<Huffman, Huffman> result;
+        BuildHuffman(result.first, lengths.data(), 288);
+        BuildHuffman(result.second, distanceLengths.data(), 30);
+        return result;
+    }();
+    return tables;
+}
+
+struct FileCloser {
+    void operator()(std::FILE* file) const { std::fclose(file); }
+};
+using FilePtr = std::unique_ptr<std::FILE, FileCloser>;
+
+// 偏移按64位定位（Windows上long只有32位，超过2GB的包会被截断）
+bool SeekFile(std::FILE* file, uint64_t offset) {
+#ifdef _WIN32
+    return _fseeki64(file, static_cast<__int64>(offset), SEEK_SET) == 0;
+#else
+    return fseeko(file, static_cast<off_t>(offset), SEEK_SET) == 0;
+#endif
+}
+
+bool ReadAt(std::FILE* file, uint64_t offset, unsigned char* out, size_t size) {
+    return SeekFile(file, offset) && std::fread(out, 1, size, file) == size;
+}
+
+template <typename Buffer>
+bool ReadInto(const std::string& path, Buffer& data, std::string& error) {
+    DataReader reader;
+    if (!reader.Open(path, error)) {
+        return false;
+    }
+    // 包内条目的大小在Open时已检查过上限
+    data.resize(static_cast<size_t>(reader.Size()));
+    size_t got = reader.Read(reinterpret_cast<unsigned char*>(data.data()), data.size());
+    if (!reader.GetError().empty()) {
+        error = reader.GetError();
+        return false;
+    }
+    data.resize(got);
+    return true;
+}
+}
+
+class DataReader::Inflater {
+public:
+    // 可中断的deflate解码：输出写满就返回，下次从块头、存储块中间或未复制完的回溯处接着解；
+    // 只保留最近32KB输出作为回溯窗口
+    Inflater(std::FILE* file, uint64_t compressedSize) : input_(file, compressedSize) {}
+
+    // 写出最多size字节到out，produced为实际写出的字节数（流已结束时少于size）；数据损坏时返回false
+    bool Read(unsigned char* out, size_t size, size_t& produced);
+
+private:
+    enum class Stage { Header, Stored, Codes, Done };
+    static constexpr size_t kWindowSize = 32 * 1024;
+
+    bool Inflate(unsigned char* out, size_t size, size_t& produced);
+    bool InflateCodes(unsigned char* out, size_t size, size_t& produced);
+    // 回溯复制distance字节之前的输出：本次写出的部分直接从out取，更早的从窗口取
+    void CopyBack(unsigned char* out, size_t& produced, size_t distance, size_t count) {
+        size_t i = 0;
+        for (; i < count && distance > produced; ++i, ++produced) {
+            out[produced] = window_[(total_ + produced - distance) % kWindowSize];
+        }
+        for (; i < count; ++i, ++produced) {
+            out[produced] = out[produced - distance];
+        }
+    }
+
+    BitInput input_;
+    Stage stage_ = Stage::Header;
+    bool final_ = false;
+    uint32_t storedLeft_ = 0;
+    const Huffman* literals_ = nullptr;
+    const Huffman* distances_ = nullptr;
+    Huffman dynamicLiterals_;
+    Huffman dynamicDistances_;
+    // 尚未复制完的回溯
+    size_t copyLength_ = 0;
+    size_t copyDistance_ = 0;
+    // 之前各次Read写出的总字节数，窗口里是其中最后32KB
+    uint64_t total_ = 0;
+    std::array<unsigned char, kWindowSize> window_;
+};
+
+bool DataReader::Inflater::Read(unsigned char* out, size_t size, size_t& produced) {
+    produced = 0;
+    bool ok = Inflate(out, size, produced);
+    // 本次输出的末尾并入窗口，供之后的回溯
+    for (size_t i = produced - std::min(produced, kWindowSize); i < produced; ++i) {
+        window_[(total_ + i) % kWindowSize] = out[i];
+    }
+    total_ += produced;
+    return ok;
+}
+
+bool DataReader::Inflater::Inflate(unsigned char* out, size_t size, size_t& produced) {
+    while (produced < size) {
+        if (copyLength_ > 0) {
+            size_t count = std::min(copyLength_, size - produced);
+            CopyBack(out, produced, copyDistance_, count);
+            copyLength_ -= count;
+            continue;
+        }
+        if (stage_ == Stage::Done) {
+            return true;
+        }
+        if (stage_ == Stage::Header) {
+            if (final_) {
+                stage_ = Stage::Done;
+                continue;
+            }
+            uint32_t final = 0;
+            uint32_t type = 0;
+            if (!input_.Bits(1, final) || !input_.Bits(2, type)) {
+                return false;
+            }
+            final_ = final != 0;
+            if (type == 0) {
+                input_.AlignToByte();
+                uint32_t length = 0;
+                uint32_t inverse = 0;
+                if (!input_.Bits(16, length) || !input_.Bits(16, inverse) || length != (~inverse & 0xFFFF)) {
+                    return false;
+                }
+                storedLeft_ = length;
+                stage_ = Stage::Stored;
+            } else if (type == 1) {
+                literals_ = &FixedTables().first;
+                distances_ = &FixedTables().second;
+                stage_ = Stage::Codes;
+            } else if (type == 2) {
+                if (!ReadDynamicTables(input_, dynamicLiterals_, dynamicDistances_)) {
+                    return false;
+                }
+                literals_ = &dynamicLiterals_;
+                distances_ = &dynamicDistances_;
+                stage_ = Stage::Codes;
+            } else {
+                return false;
+            }
+            continue;
+        }
+        if (stage_ == Stage::Stored) {
+            size_t count = std::min<size_t>(storedLeft_, size - produced);
+            if (!input_.Copy(out + produced, count)) {
+                return false;
+            }
+            produced += count;
+            storedLeft_ -= static_cast<uint32_t>(count);
+            stage_ = storedLeft_ == 0 ? Stage::Header : Stage::Stored;
+            continue;
+        }
+        if (!InflateCodes(out, size, produced)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool DataReader::Inflater::InflateCodes(unsigned char* out, size_t size, size_t& produced) {
+    // 字面量直接写出，长度/距离对在窗口里回溯复制；输出写满时把没复制完的部分留到下次
+    while (produced < size) {
+        int symbol = 0;
+        if (!Decode(input_, *literals_, symbol)) {
+            return false;
+        }
+        if (symbol < 256) {
+            out[produced++] = static_cast<unsigned char>(symbol);
+            continue;
+        }
+        if (symbol == 256) {
+            stage_ = Stage::Header;
+            return true;
+        }
+        symbol -= 257;
+        if (symbol >= 29) {
+            return false;
+        }
+        uint32_t extra = 0;
+        if (!input_.Bits(kLengthExtra[symbol], extra)) {
+            return false;
+        }
+        size_t length = kLengthBase[symbol] + extra;
+        int distanceSymbol = 0;
+        if (!Decode(input_, *distances_, distanceSymbol) || distanceSymbol >= 30 ||
+            !input_.Bits(kDistanceExtra[distanceSymbol], extra)) {
+            return false;
+        }
+        size_t distance = kDistanceBase[distanceSymbol] + extra;
+        if (distance > std::min<uint64_t>(total_ + produced, kWindowSize)) {
+            return false;
+        }
+        size_t count = std::min(length, size - produced);
+        CopyBack(out, produced, distance, count);
+        copyLength_ = length - count;
+        copyDistance_ = distance;
+    }
+    return true;
+}
+
+DataReader::DataReader() = default;
+
+DataReader::~DataReader() {
+    Close();
+}
+
+void DataReader::Close() {
+    inflater_.reset();
+    if (file_) {
+        std::fclose(file_);
+        file_ = nullptr;
+    }
+    error_.clear();
+}
+
+bool DataReader::Open(const std::string& path, std::string& error) {
+    std::string archivePath;
+    std::string entryName;
+    if (SplitPackagePath(path, archivePath, entryName)) {
+        std::shared_ptr<const ZipArchive> archive = OpenPackage(archivePath, error);
+        if (!archive) {
+            return false;
+        }
+        const PackageEntry* entry = archive->Find(entryName);
+        if (!entry) {
+            error = "File not found in package: " + path;
+            return false;
+        }
+        return OpenEntry(*archive, *entry, error);
+    }
+    Close();
+    std::error_code fsError;
+    uint64_t size = std::filesystem::file_size(path, fsError);
+    file_ = fsError ? nullptr : std::fopen(path.c_str(), "rb");
+    if (!file_) {
+        error = "Failed to open file: " + path;
+        return false;
+    }
+    name_ = path;
+    entry_ = false;
+    deflated_ = false;
+    dataOffset_ = 0;
+    size_ = size;
+    position_ = 0;
+    filePosition_ = 0;
+    return true;
+}
+
+bool DataReader::OpenEntry(const ZipArchive& archive, const PackageEntry& entry, std::string& error) {
+    Close();
+    if (entry.flags & 1) {
+        error = "Encrypted package entry: " + entry.name;
+        return false;
+    }
+    if (entry.method != 0 && entry.method != 8) {
+        error = "Unsupported compression method in " + entry.name;
+        return false;
+    }
+    // 大小来自包内的声明，调用方按它分配内存之前先检查
+    if (!archive.CheckEntrySize(entry, error)) {
+        return false;
+    }
+    file_ = std::fopen(archive.GetPath().c_str(), "rb");
+    unsigned char header[kLocalHeaderSize];
+    if (!file_ || !ReadAt(file_, entry.headerOffset, header, sizeof(header)) ||
+        ReadU32(header) != kLocalHeaderSignature) {
+        error = "Corrupt package entry: " + entry.name;
+        Close();
+        return false;
+    }
+    // 本地文件头的名字与扩展字段长度可能与中央目录不同，以本地的为准
+    dataOffset_ = entry.headerOffset + kLocalHeaderSize + ReadU16(header + 26) + ReadU16(header + 28);
+    if (dataOffset_ + entry.compressedSize > static_cast<uint64_t>(archive.GetFileSize()) ||
+        (entry.method == 0 && entry.compressedSize != entry.size)) {
+        error = "Corrupt package entry: " + entry.name;
+        Close();
+        return false;
+    }
+    name_ = entry.name;
+    entry_ = true;
+    deflated_ = entry.method == 8;
+    compressedSize_ = entry.compressedSize;
+    size_ = entry.size;
+    expectedCrc_ = entry.crc;
+    if (!Restart()) {
+        error = error_;
+        Close();
+        return false;
+    }
+    return true;
+}
+
+bool DataReader::Restart() {
+    position_ = 0;
+    crc_ = 0;
+    crcPosition_ = 0;
+    filePosition_ = dataOffset_;
+    if (!SeekFile(file_, dataOffset_)) {
+        error_ = "Corrupt package entry: " + name_;
+        return false;
+    }
+    if (deflated_) {
+        inflater_ = std::make_unique<Inflater>(file_, compressedSize_);
+    }
+    return true;
+}
+
+size_t DataReader::Read(unsigned char* out, size_t size) {
+    if (!file_ || !error_.empty()) {
+        return 0;
+    }
+    size = static_cast<size_t>(std::min<uint64_t>(size, size_ - position_));
+    size_t got = 0;
+    if (deflated_) {
+        if (!inflater_->Read(out, size, got)) {
+            error_ = "Corrupt deflate stream: " + name_;
+        } else if (got < size) {
+            error_ = "Deflate stream size mismatch: " + name_;
+        }
+    } else {
+        // 定位只改逻辑位置，真正读之前才移动文件指针
+        if (filePosition_ != dataOffset_ + position_ && !SeekFile(file_, dataOffset_ + position_)) {
+            error_ = "Failed to read " + name_;
+            return 0;
+        }
+        got = std::fread(out, 1, size, file_);
+        filePosition_ = dataOffset_ + position_ + got;
+        if (got < size && entry_) {
+            error_ = "Truncated package entry: " + name_;
+        }
+    }
+    // 条目从头顺序读过的部分累计CRC，读到结尾时校验
+    if (entry_ && crcPosition_ == position_) {
+        crc_ = Crc32(crc_, out, got);
+        crcPosition_ += got;
+        if (crcPosition_ == size_ && crc_ != expectedCrc_ && error_.empty()) {
+            error_ = "CRC mismatch in package entry: " + name_;
+        }
+    }
+    position_ += got;
+    return got;
+}
+
+bool DataReader::Seek(uint64_t offset) {
+    if (!file_ || !error_.empty() || offset > size_) {
+        return false;
+    }
+    if (!deflated_) {
+        position_ = offset;
+        return true;
+    }
+    // deflate只能顺序解：向后先回到开头，再解压并丢弃到目标位置
+    if (offset < position_ && !Restart()) {
+        return false;
+    }
+    unsigned char scratch[4096];
+    while (position_ < offset) {
+        size_t want = static_cast<size_t>(std::min<uint64_t>(sizeof(scratch), offset - position_));
+        if (Read(scratch, want) != want) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool ZipArchive::Open(const std::string& path, std::string& error) {
+    PROFILE_ZONE("ZipArchive::Open");
+    path_ = path;
+    entries_.clear();
+    std::error_code fsError;
+    fileSize_ = static_cast<int64_t>(std::filesystem::file_size(path, fsError));
+    modifiedTime_ = static_cast<int64_t>(std::filesystem::last_write_time(path, fsError).time_since_epoch().count());
+    FilePtr file(std::fopen(path.c_str(), "rb"));
+    if (!file || fsError) {
+        error = "Failed to open package: " + path;
+        return false;
+    }
+
+    // 目录结束记录在文件末尾，后面最多跟65535字节的注释，从后往前找签名
+    uint64_t tailSize = std::min<uint64_t>(static_cast<uint64_t>(fileSize_), kEndOfDirectorySize + 0xFFFF);
+    std::vector<unsigned char> tail(static_cast<size_t>(tailSize));
+    if (tailSize < kEndOfDirectorySize || !ReadAt(file.get(), fileSize_ - tailSize, tail.data(), tail.size())) {
+        error = "Not a zip package: " + path;
+        return false;
+    }
+    const unsigned char* end = nullptr;
+    for (size_t i = tail.size() - kEndOfDirectorySize + 1; i-- > 0;) {
+        if (ReadU32(tail.data() + i) == kEndOfDirectorySignature) {
+            end = tail.data() + i;
+            break;
+        }
+    }
+    if (!end) {
+        error = "Not a zip package: " + path;
+        return false;
+    }
+    uint16_t entryCount = ReadU16(end + 10);
+    uint32_t directorySize = ReadU32(end + 12);
+    uint32_t directoryOffset = ReadU32(end + 16);
+    if (entryCount == 0xFFFF || directoryOffset == 0xFFFFFFFFu) {
+        error = "ZIP64 packages are not supported: " + path;
+        return false;
+    }
+    std::vector<unsigned char> directory(directorySize);
+    if (static_cast<uint64_t>(directoryOffset) + directorySize > static_cast<uint64_t>(fileSize_) ||
+        !ReadAt(file.get(), directoryOffset, directory.data(), directory.size())) {
+        error = "Corrupt zip directory: " + path;
+        return false;
+    }
+
+    entries_.reserve(entryCount);
+    size_t offset = 0;
+    for (uint16_t i = 0; i < entryCount; ++i) {
+        const unsigned char* header = directory.data() + offset;
+        if (offset + kCentralHeaderSize > directory.size() || ReadU32(header) != kCentralHeaderSignature) {
+            error = "Corrupt zip directory: " + path;
+            return false;
+        }
+        size_t nameLength = ReadU16(header + 28);
+        size_t extraLength = ReadU16(header + 30);
+        size_t commentLength = ReadU16(header + 32);
+        if (offset + kCentralHeaderSize + nameLength > directory.size()) {
+            error = "Corrupt zip directory: " + path;
+            return false;
+        }
+        PackageEntry entry;
+        entry.flags = ReadU16(header + 8);
+        entry.method = ReadU16(header + 10);
+        entry.crc = ReadU32(header + 16);
+        entry.compressedSize = ReadU32(header + 20);
+        entry.size = ReadU32(header + 24);
+        entry.headerOffset = ReadU32(header + 42);
+        entry.name.assign(reinterpret_cast<const char*>(header + kCentralHeaderSize), nameLength);
+        std::replace(entry.name.begin(), entry.name.end(), '\\', '/');
+        offset += kCentralHeaderSize + nameLength + extraLength + commentLength;
+        // 目录项本身不需要索引
+        if (!entry.name.empty() && entry.name.back() != '/') {
+            entries_.push_back(std::move(entry));
+        }
+    }
+    return true;
+}
+
+const PackageEntry* ZipArchive::Find(const std::string& name) const {
+    for (const PackageEntry& entry : entries_) {
+        if (entry.name == name) {
+            return &entry;
+        }
+    }
+    std::string lowered = ToLower(name);
+    for (const PackageEntry& entry : entries_) {
+        if (ToLower(entry.name) == lowered) {
+            return &entry;
+        }
+    }
+    return nullptr;
+}
+
+bool ZipArchive::CheckEntrySize(const PackageEntry& entry, std::string& error) const {
+    uint64_t compressedLimit = std::min<uint64_t>(entry.compressedSize, static_cast<uint64_t>(fileSize_));
+    uint64_t limit = entry.method == 0 ? compressedLimit : compressedLimit * kMaxDeflateRatio;
+    if (entry.compressedSize > static_cast<uint64_t>(fileSize_) || entry.size > std::min(limit, kMaxEntrySize)) {
+        error = "Package entry too large: " + entry.name;
+        return false;
+    }
+    return true;
+}
+
+bool ZipArchive::Read(const PackageEntry& entry, unsigned char* out, std::string& error) const {
+    PROFILE_ZONE("ZipArchive::Read");
+    DataReader reader;
+    if (!reader.OpenEntry(*this, entry, error)) {
+        return false;
+    }
+    size_t size = static_cast<size_t>(entry.size);
+    reader.Read(out, size);
+    if (!reader.GetError().empty()) {
+        error = reader.GetError();
+        return false;
+    }
+    return true;
+}
+
+uint32_t Crc32(uint32_t crc, const unsigned char* data, size_t size) {
+    static const std::array<uint32_t, 256> table = []() {
+        std::array<uint32_t, 256> result{};
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t value = i;
+            for (int bit = 0; bit < 8; ++bit) {
+                value = (value & 1) ? 0xEDB88320u ^ (value >> 1) : value >> 1;
+            }
+            result[i] = value;
+        }
+        return result;
+    }();
+    crc = ~crc;
+    for (size_t i = 0; i < size; ++i) {
+        crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+bool IsPackagePath(const std::string& path) {
+    return ToLower(std::filesystem::path(path).extension().string()) == ".osz";
+}
+
+bool SplitPackagePath(const std::string& path, std::string& archivePath, std::string& entryName) {
+    // 第一个以.osz结尾的路径组成部分是包
+    std::string lowered = ToLower(path);
+    size_t pos = lowered.find(".osz/");
+    if (pos == std::string::npos) {
+        return false;
+    }
+    archivePath = path.substr(0, pos + 4);
+    entryName = path.substr(pos + 5);
+    return !entryName.empty();
+}
+
+std::shared_ptr<const ZipArchive> OpenPackage(const std::string& archivePath, std::string& error) {
+    static std::mutex mutex;
+    static std::unordered_map<std::string, std::shared_ptr<const ZipArchive>> cache;
+    std::error_code fsError;
+    int64_t size = static_cast<int64_t>(std::filesystem::file_size(archivePath, fsError));
+    int64_t modified =
+        static_cast<int64_t>(std::filesystem::last_write_time(archivePath, fsError).time_since_epoch().count());
+    std::lock_guard<std::mutex> lock(mutex);
+    if (fsError) {
+        cache.erase(archivePath);
+        error = "Failed to open package: " + archivePath;
+        return nullptr;
+    }
+    auto it = cache.find(archivePath);
+    if (it != cache.end() && it->second->GetFileSize() == size && it->second->GetModifiedTime() == modified) {
+        return it->second;
+    }
+    auto archive = std::make_shared<ZipArchive>();
+    if (!archive->Open(archivePath, error)) {
+        cache.erase(archivePath);
+        return nullptr;
+    }
+    cache[archivePath] = archive;
+    return archive;
+}
+
+bool ReadDataFile(const std::string& path, std::string& data, std::string& error) {
+    return ReadInto(path, data, error);
+}
+
+bool ReadDataFile(const std::string& path, std::vector<unsigned char>& data, std::string& error) {
+    return ReadInto(path, data, error);
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+struct PackageEntry {
+    // 中央目录里的一项：名字用'/'分隔，数据位置在读取时由本地文件头算出
+    std::string name;
+    uint16_t method = 0;
+    uint16_t flags = 0;
+    uint32_t crc = 0;
+    uint64_t compressedSize = 0;
+    uint64_t size = 0;
+    uint64_t headerOffset = 0;
+};
+
+class ZipArchive {
+public:
+    // .osz谱面包（zip）：打开时只读一次中央目录建立索引，条目按需读出，不解压到磁盘。
+    // 支持存储与deflate两种方式（自带解压，不依赖zlib），不支持ZIP64与加密
+    bool Open(const std::string& path, std::string& error);
+
+    const std::string& GetPath() const { return path_; }
+    int64_t GetFileSize() const { return fileSize_; }
+    int64_t GetModifiedTime() const { return modifiedTime_; }
+    const std::vector<PackageEntry>& GetEntries() const { return entries_; }
+    // 先精确匹配，再忽略大小写（谱面里写的音频文件名常与包内大小写不一致）
+    const PackageEntry* Find(const std::string& name) const;
+
+    // 声明的解压后大小超过上限、压缩比或包本身的长度时返回false，按entry.size分配内存前先调用
+    bool CheckEntrySize(const PackageEntry& entry, std::string& error) const;
+    // 读出整个条目到out（大小为entry.size），经DataReader读取；每次调用各自打开文件，可在多个线程同时读
+    bool Read(const PackageEntry& entry, unsigned char* out, std::string& error) const;
+
+private:
+    std::string path_;
+    int64_t fileSize_ = 0;
+    int64_t modifiedTime_ = 0;
+    std::vector<PackageEntry> entries_;
+};
+
+class DataReader {
+public:
+    // 顺序读取普通文件或包内条目：文件与存储的条目按范围直接读，deflate条目边读边解压，
+    // 只占64KB输入缓冲与32KB窗口，不把整个条目读进内存（音频由解码器按需拉取）。
+    // deflate条目向后定位时从头重新解压；条目从头顺序读到结尾时校验CRC
+    DataReader();
+    ~DataReader();
+    DataReader(const DataReader&) = delete;
+    DataReader& operator=(const DataReader&) = delete;
+
+    // path的写法同ReadDataFile
+    bool Open(const std::string& path, std::string& error);
+    bool OpenEntry(const ZipArchive& archive, const PackageEntry& entry, std::string& error);
+    uint64_t Size() const { return size_; }
+    uint64_t Tell() const { return position_; }
+    // 返回读到的字节数，到结尾或出错时少于size；出错后GetError非空，之后的读取都返回0
+    size_t Read(unsigned char* out, size_t size);
+    bool Seek(uint64_t offset);
+    const std::string& GetError() const { return error_; }
+
+private:
+    class Inflater;
+    void Close();
+    // 回到条目开头（deflate重建解压状态）
+    bool Restart();
+
+    std::FILE* file_ = nullptr;
+    std::string name_;
+    bool entry_ = false;
+    bool deflated_ = false;
+    uint64_t dataOffset_ = 0;
+    uint64_t compressedSize_ = 0;
+    uint64_t size_ = 0;
+    uint64_t position_ = 0;
+    // 文件指针的实际位置，存储的数据只在与逻辑位置不一致时才重新定位
+    uint64_t filePosition_ = 0;
+    uint32_t expectedCrc_ = 0;
+    // crc_覆盖条目的[0, crcPosition_)
+    uint32_t crc_ = 0;
+    uint64_t crcPosition_ = 0;
+    std::unique_ptr<Inflater> inflater_;
+    std::string error_;
+};
+
+// 包内文件的路径写成"<包路径>/<条目名>"，例如assets/Song.osz/Song (Hard).osu；
+// 谱面所在目录 + 音频文件名自然落在同一个包里
+bool IsPackagePath(const std::string& path);
+bool SplitPackagePath(const std::string& path, std::string& archivePath, std::string& entryName);
+
+// 按路径共享已打开的包（进程内缓存，文件大小或修改时间变化后重新读目录），线程安全
+std::shared_ptr<const ZipArchive> OpenPackage(const std::string& archivePath, std::string& error);
+
+// 读取普通文件或包内条目的全部内容
+bool ReadDataFile(const std::string& path, std::string& data, std::string& error);
+bool ReadDataFile(const std::string& path, std::vector<unsigned char>& data, std::string& error);
+
+// CRC-32（zip与PNG共用的多项式），crc传入上一段的结果可分段计算
+uint32_t Crc32(uint32_t crc, const unsigned char* data, size_t size);
@@ -0,0 +1,132 @@
+#include "PackedNote.h"
+
+#include <algorithm>
+#include <numeric>
+
+namespace {
+constexpr uint64_t kLaneMask = (1ull << kPackedLaneBits) - 1;
+constexpr uint64_t kDeltaMask = (1ull << kPackedDeltaBits) - 1;
+constexpr uint64_t kHoldMask = (1ull << kPackedHoldBits) - 1;
+constexpr int kLaneShift = 1;
+constexpr int kDeltaShift = kLaneShift + kPackedLaneBits;
+constexpr int kHoldShift = kDeltaShift + kPackedDeltaBits;
+
+uint64_t Encode(const Note& note, int deltaMs) {
+    uint64_t delta = std::min<uint64_t>(static_cast<uint64_t>(std::max(0, deltaMs)), kDeltaMask);
+    uint64_t hold = 0;
+    if (note.isHold) {
+        hold = std::min<uint64_t>(static_cast<uint64_t>(std::max(0, note.endTimeMs - note.timeMs)), kHoldMask);
+    }
+    uint64_t lane = static_cast<uint64_t>(std::max(0, note.lane)) & kLaneMask;
+    return (note.isHold ? 1ull : 0ull) | (lane << kLaneShift) | (delta << kDeltaShift) | (hold << kHoldShift);
+}
+
+void DecodeInto(uint64_t bits, int timeMs, Note& out) {
+    out.lane = static_cast<int>((bits >> kLaneShift) & kLaneMask);
+    out.timeMs = timeMs;
+    out.isHold = (bits & 1ull) != 0;
+    out.endTimeMs = timeMs + static_cast<int>((bits >> kHoldShift) & kHoldMask);
+}
+
+int DeltaOf(uint64_t bits) {
+    return static_cast<int>((bits >> kDeltaShift) & kDeltaMask);
+}
+}
+
+void PackedNoteList::Append(const Note& note) {
+    // 每块第一个音符的时间差为0，绝对时间记在关键帧里
+    int timeMs = std::max(note.timeMs, bits_.empty() ? note.timeMs : lastTimeMs_);
+    int deltaMs = 0;
+    if (bits_.size() % kPackedBlockSize == 0) {
+        keyTimes_.push_back(timeMs);
+    } else {
+        deltaMs = timeMs - lastTimeMs_;
+    }
+    bits_.push_back(Encode(note, deltaMs));
+    lastTimeMs_ = timeMs;
+}
+
+void PackedNoteList::Reserve(size_t count) {
+    bits_.reserve(count);
+    keyTimes_.reserve((count + kPackedBlockSize - 1) / kPackedBlockSize);
+}
+
+void PackedNoteList::Clear() {
+    bits_.clear();
+    keyTimes_.clear();
+    lastTimeMs_ = 0;
+}
+
+size_t PackedNoteList::Decode(size_t first, size_t count, Note* out) const {
+    // 从所在块的关键帧累加到first，之后顺序解码，跨块时用关键帧重新对齐
+    if (first >= bits_.size()) {
+        return 0;
+    }
+    count = std::min(count, bits_.size() - first);
+    size_t index = first - first % kPackedBlockSize;
+    int timeMs = keyTimes_[index / kPackedBlockSize];
+    for (++index; index <= first; ++index) {
+        timeMs += DeltaOf(bits_[index]);
+    }
+    DecodeInto(bits_[first], timeMs, out[0]);
+    for (size_t i = 1; i < count; ++i) {
+        size_t noteIndex = first + i;
+        uint64_t bits = bits_[noteIndex];
+        timeMs = noteIndex % kPackedBlockSize == 0 ? keyTimes_[noteIndex / kPackedBlockSize] : timeMs + DeltaOf(bits);
+        DecodeInto(bits, timeMs, out[i]);
+    }
+    return count;
+}
+
+Note PackedNoteList::Get(size_t index) const {
+    Note note;
+    Decode(index, 1, &note);
+    return note;
+}
+
+size_t PackedNoteList::LowerBound(int timeMs) const {
+    // 关键帧递增：第一个不早于timeMs的关键帧之前那一块里才可能有答案
+    size_t block = std::lower_bound(keyTimes_.begin(), keyTimes_.end(), timeMs) - keyTimes_.begin();
+    if (block == 0) {
+        return 0;
+    }
+    size_t index = (block - 1) * kPackedBlockSize;
+    size_t end = std::min(bits_.size(), index + kPackedBlockSize);
+    int blockTimeMs = keyTimes_[block - 1];
+    for (++index; index < end; ++index) {
+        blockTimeMs += DeltaOf(bits_[index]);
+        if (blockTimeMs >= timeMs) {
+            return index;
+        }
+    }
+    return end;
+}
+
+size_t PackedNoteList::MemoryBytes() const {
+    return bits_.capacity() * sizeof(uint64_t) + keyTimes_.capacity() * sizeof(int32_t);
+}
+
+bool PackedNoteList::Assign(std::vector<uint64_t> bits, std::vector<int32_t> keyTimes) {
+    if (keyTimes.size() != (bits.size() + kPackedBlockSize - 1) / kPackedBlockSize) {
+        return false;
+    }
+    bits_ = std::move(bits);
+    keyTimes_ = std::move(keyTimes);
+    lastTimeMs_ = bits_.empty() ? 0 : Get(bits_.size() - 1).timeMs;
+    return true;
+}
+
+PackedNoteList PackNotes(const ArenaVector<Note>& notes) {
+    // 只排序下标（4字节/音符），避免复制整个音符数组
+    std::vector<uint32_t> order(notes.size());
+    std::iota(order.begin(), order.end(), 0u);
+    std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+        return notes[a].timeMs < notes[b].timeMs;
+    });
+    PackedNoteList list;
+    list.Reserve(notes.size());
+    for (uint32_t index : order) {
+        list.Append(notes[index]);
+    }
+    return list;
+}
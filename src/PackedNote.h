@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Chart.h"
+
+// 每隔多少个音符存一个绝对时间关键帧（块内按差分解码）
+constexpr size_t kPackedBlockSize = 64;
+
+// 8字节音符：bit0 长条标记 | bit1-5 轨道 | bit6-34 与上一音符的时间差 | bit35-63 长条长度
+constexpr int kPackedLaneBits = 5;
+constexpr int kPackedDeltaBits = 29;
+constexpr int kPackedHoldBits = 29;
+
+class PackedNoteList {
+public:
+    // 按时间顺序追加；时间差与长条长度超出29位（约6天）时截断
+    void Append(const Note& note);
+    void Reserve(size_t count);
+    void Clear();
+
+    size_t Size() const { return bits_.size(); }
+    bool Empty() const { return bits_.empty(); }
+    // 最后追加的音符时间（空时为0）
+    int LastTimeMs() const { return lastTimeMs_; }
+    // 解码[first, first + count)到out，返回实际解码的数量
+    size_t Decode(size_t first, size_t count, Note* out) const;
+    Note Get(size_t index) const;
+    // 第一个时间不早于timeMs的音符下标（全部更早时返回Size）：关键帧上二分，块内最多累加64个差分
+    size_t LowerBound(int timeMs) const;
+    size_t MemoryBytes() const;
+
+    // 二进制谱面直接读写的原始数据
+    const std::vector<uint64_t>& Bits() const { return bits_; }
+    const std::vector<int32_t>& KeyTimes() const { return keyTimes_; }
+    // 载入原始数据，关键帧数量与音符数不匹配时返回false
+    bool Assign(std::vector<uint64_t> bits, std::vector<int32_t> keyTimes);
+
+private:
+    std::vector<uint64_t> bits_;
+    std::vector<int32_t> keyTimes_;
+    int lastTimeMs_ = 0;
+};
+
+// 把音符按时间排序后打包（不修改输入）
+PackedNoteList PackNotes(const ArenaVector<Note>& notes);
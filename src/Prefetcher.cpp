@@ -0,0 +1,202 @@
+#include "Prefetcher.h"
+
+#include <algorithm>
+#include <cstdio>
+
+#include "ChartBinary.h"
+#include "Package.h"
+#include "Profiler.h"
+
+namespace {
+std::string GetDirectory(const std::string& path) {
+    size_t pos = path.find_last_of("/\\");
+    if (pos == std::string::npos) {
+        return "";
+    }
+    return path.substr(0, pos + 1);
+}
+
+size_t EntryBytes(const PreparedChart& entry) {
+    return entry.memoryBytes + (entry.audio ? entry.audio->MemoryBytes() : 0);
+}
+
+// path本身或位于目录/包path之下
+bool IsWithin(const std::string& path, const std::string& container) {
+    return path == container ||
+           (path.size() > container.size() && path.compare(0, container.size(), container) == 0 &&
+            path[container.size()] == '/');
+}
+}
+
+PreparedChart PrepareChart(const std::string& path, const AudioFormat& format) {
+    PROFILE_ZONE("PrepareChart");
+    PreparedChart prepared;
+    prepared.path = path;
+    if (!LoadChartFile(path, prepared.chart, prepared.error)) {
+        return prepared;
+    }
+    prepared.difficulty = ComputeDifficulty(prepared.chart);
+    if (!prepared.chart.audioFilename.empty()) {
+        prepared.audio = LoadChartAudio(path, std::string(prepared.chart.audioFilename), format);
+    }
+    // 谱面没有给出预览点时从40%处开始
+    const Chart& chart = prepared.chart;
+    int lastMs = chart.notes.empty() ? 0 : chart.notes.back().timeMs;
+    prepared.previewTimeMs = chart.previewTimeMs >= 0 ? chart.previewTimeMs : lastMs * 2 / 5;
+    prepared.memoryBytes = sizeof(PreparedChart) + chart.ArenaBytes();
+    prepared.ok = true;
+    return prepared;
+}
+
+std::shared_ptr<AudioClip> LoadChartAudio(const std::string& chartPath, const std::string& audioFilename,
+                                          const AudioFormat& format) {
+    // 谱面在.osz包里时音频也从同一个包中读取，解码器边读边解压，不落盘也不整个读进内存
+    auto source = std::make_unique<DataReader>();
+    std::string error;
+    if (!source->Open(GetDirectory(chartPath) + audioFilename, error)) {
+        return nullptr;
+    }
+    std::shared_ptr<AudioClip> clip = AudioClip::Decode(std::move(source), format, error);
+    if (!clip) {
+        std::printf("Audio load failed: %s\n", error.c_str());
+    }
+    return clip;
+}
+
+ChartPrefetcher::ChartPrefetcher(const AudioFormat& format, size_t memoryLimitBytes, size_t maxEntries)
+    : format_(format), memoryLimitBytes_(memoryLimitBytes), maxEntries_(std::max<size_t>(1, maxEntries)) {
+    worker_ = std::thread([this]() { WorkerLoop(); });
+}
+
+ChartPrefetcher::~ChartPrefetcher() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    worker_.join();
+}
+
+void ChartPrefetcher::Request(const std::vector<std::string>& paths) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pending_.clear();
+        // 倒序刷新，使优先级最高的条目最后移到链表头
+        for (auto path = paths.rbegin(); path != paths.rend(); ++path) {
+            auto it = std::find_if(cache_.begin(), cache_.end(),
+                                   [&](const PreparedChart& entry) { return entry.path == *path; });
+            if (it != cache_.end()) {
+                cache_.splice(cache_.begin(), cache_, it);
+            }
+        }
+        for (const auto& path : paths) {
+            bool cached = std::any_of(cache_.begin(), cache_.end(),
+                                      [&](const PreparedChart& entry) { return entry.path == path; });
+            if (!cached && path != loadingPath_) {
+                pending_.push_back(path);
+            }
+        }
+    }
+    wake_.notify_one();
+}
+
+bool ChartPrefetcher::Take(const std::string& path, PreparedChart& out, bool wait) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    // 调用方马上要同步载入，尚未开始的同一请求不再重复预取
+    pending_.erase(std::remove(pending_.begin(), pending_.end(), path), pending_.end());
+    if (!wait && loadingPath_ == path) {
+        return false;
+    }
+    done_.wait(lock, [&]() { return loadingPath_ != path; });
+    auto it = std::find_if(cache_.begin(), cache_.end(),
+                           [&](const PreparedChart& entry) { return entry.path == path; });
+    if (it == cache_.end()) {
+        return false;
+    }
+    out = std::move(*it);
+    cache_.erase(it);
+    return true;
+}
+
+std::shared_ptr<AudioClip> ChartPrefetcher::PeekAudio(const std::string& path, int& previewTimeMs) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& entry : cache_) {
+        if (entry.path == path && entry.ok) {
+            previewTimeMs = entry.previewTimeMs;
+            return entry.audio;
+        }
+    }
+    return nullptr;
+}
+
+void ChartPrefetcher::Invalidate(const std::string& path) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    pending_.erase(std::remove_if(pending_.begin(), pending_.end(),
+                                  [&](const std::string& pendingPath) { return IsWithin(pendingPath, path); }),
+                   pending_.end());
+    for (auto it = cache_.begin(); it != cache_.end();) {
+        if (IsWithin(it->path, path)) {
+            released_.push_back(std::move(*it));
+            it = cache_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    if (IsWithin(loadingPath_, path)) {
+        discardLoading_ = true;
+    }
+    bool release = !released_.empty();
+    lock.unlock();
+    if (release) {
+        wake_.notify_one();
+    }
+}
+
+void ChartPrefetcher::WorkerLoop() {
+    PROFILE_THREAD_NAME("Prefetch");
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        wake_.wait(lock, [&]() { return stopping_ || !pending_.empty() || !released_.empty(); });
+        if (stopping_) {
+            return;
+        }
+        if (!released_.empty()) {
+            std::vector<PreparedChart> released;
+            released.swap(released_);
+            lock.unlock();
+            released.clear();
+            lock.lock();
+            continue;
+        }
+        loadingPath_ = pending_.front();
+        pending_.erase(pending_.begin());
+
+        // 解析与读文件不持锁，主线程可以继续更新请求
+        lock.unlock();
+        PreparedChart prepared = PrepareChart(loadingPath_, format_);
+        lock.lock();
+
+        if (!discardLoading_) {
+            cache_.push_front(std::move(prepared));
+        } else {
+            released_.push_back(std::move(prepared));
+        }
+        discardLoading_ = false;
+        loadingPath_.clear();
+        EvictLocked();
+        done_.notify_all();
+    }
+}
+
+void ChartPrefetcher::EvictLocked() {
+    // 至少保留刚放入的条目；音频边解码边增长，每次都重新累计
+    size_t cacheBytes = 0;
+    for (const PreparedChart& entry : cache_) {
+        cacheBytes += EntryBytes(entry);
+    }
+    while (cache_.size() > 1 && (cache_.size() > maxEntries_ || cacheBytes > memoryLimitBytes_)) {
+        cacheBytes -= EntryBytes(cache_.back());
+        released_.push_back(std::move(cache_.back()));
+        cache_.pop_back();
+    }
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <condition_variable>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Audio.h"
+#include "Chart.h"
+#include "Difficulty.h"
+
+struct PreparedChart {
+    // 解析好的谱面、难度与已按设备格式解码的音频（后台可能仍在追加），取出后直接交给播放器
+    std::string path;
+    Chart chart;
+    DifficultyInfo difficulty;
+    std::shared_ptr<AudioClip> audio;
+    int previewTimeMs = 0;
+    // 谱面部分（arena与结构本身）的内存；音频的占用随解码变化，淘汰时另算
+    size_t memoryBytes = 0;
+    bool ok = false;
+    std::string error;
+};
+
+// 在当前线程完成一张谱面的全部载入工作（预取线程与未命中时的同步载入共用）
+PreparedChart PrepareChart(const std::string& path, const AudioFormat& format);
+// 读入谱面所在目录（或.osz包）里的音频文件并开始解码，找不到或无法解码时返回空
+std::shared_ptr<AudioClip> LoadChartAudio(const std::string& chartPath, const std::string& audioFilename,
+                                          const AudioFormat& format);
+
+class ChartPrefetcher {
+public:
+    // 缓存按最近使用淘汰，总内存与条目数任一超限即淘汰最旧的；音频解码成format（播放器的输出格式）
+    ChartPrefetcher(const AudioFormat& format, size_t memoryLimitBytes, size_t maxEntries);
+    ~ChartPrefetcher();
+    ChartPrefetcher(const ChartPrefetcher&) = delete;
+    ChartPrefetcher& operator=(const ChartPrefetcher&) = delete;
+
+    // 按优先级（选中项在前，邻居在后）替换待预取列表，已缓存的条目刷新为最近使用
+    void Request(const std::vector<std::string>& paths);
+    // 取出已就绪的谱面（从缓存移除）；该谱面正在载入时等待完成（wait为false时直接返回false），
+    // 未请求过则返回false
+    bool Take(const std::string& path, PreparedChart& out, bool wait = true);
+    // 已就绪时返回音频与预览起点，不移出缓存（预览与之后的正式播放共用同一份解码结果）
+    std::shared_ptr<AudioClip> PeekAudio(const std::string& path, int& previewTimeMs);
+    // 文件已变化：丢弃缓存与待预取请求，正在载入的结果完成后也丢弃（path为目录或.osz包时包括其中所有谱面）
+    void Invalidate(const std::string& path);
+
+private:
+    void WorkerLoop();
+    void EvictLocked();
+
+    AudioFormat format_;
+    size_t memoryLimitBytes_;
+    size_t maxEntries_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable done_;
+    std::vector<std::string> pending_;
+    std::string loadingPath_;
+    bool discardLoading_ = false;
+    // 链表头部为最近使用
+    std::list<PreparedChart> cache_;
+    // 淘汰或作废的条目交给工作线程在锁外释放（释放音频要等它的解码线程退出）
+    std::vector<PreparedChart> released_;
+    bool stopping_ = false;
+    std::thread worker_;
+};
@@ -0,0 +1,172 @@
+#include "Profiler.h"
+
+#ifdef SIMPLEMANIA_PROFILE
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace profiler {
+namespace {
+struct TraceEvent {
+    const char* name;
+    int64_t startNs;
+    int64_t durationNs;
+};
+
+// 每线程环形缓冲：只有所属线程写入，写完一条后以release发布写指针
+constexpr size_t kBufferCapacity = 1u << 18;
+
+struct TraceSlot {
+    // 导出线程可能与所属线程同时访问同一槽位，字段都用relaxed原子读写（x86上与普通读写相同），
+    // 被覆盖的槽位导出时按写指针判断后丢弃
+    std::atomic<const char*> name{nullptr};
+    std::atomic<int64_t> startNs{0};
+    std::atomic<int64_t> durationNs{0};
+};
+
+struct ThreadBuffer {
+    int tid = 0;
+    std::string name;
+    std::unique_ptr<TraceSlot[]> events;
+    std::atomic<uint64_t> written{0};
+};
+
+// 顺序锁式读取：先按写指针拷出最近的事件，再重读写指针，丢弃拷贝期间可能被覆盖的槽位
+void CopyEvents(const ThreadBuffer& buffer, std::vector<TraceEvent>& out) {
+    out.clear();
+    uint64_t end = buffer.written.load(std::memory_order_acquire);
+    uint64_t begin = end > kBufferCapacity ? end - kBufferCapacity : 0;
+    for (uint64_t i = begin; i < end; ++i) {
+        const TraceSlot& slot = buffer.events[i % kBufferCapacity];
+        out.push_back(TraceEvent{slot.name.load(std::memory_order_relaxed),
+                                 slot.startNs.load(std::memory_order_relaxed),
+                                 slot.durationNs.load(std::memory_order_relaxed)});
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    // 写线程此刻可能正在写下标after的槽位，与它同槽的旧事件都不完整
+    uint64_t after = buffer.written.load(std::memory_order_relaxed);
+    uint64_t validBegin = after + 1 > kBufferCapacity ? after + 1 - kBufferCapacity : 0;
+    if (validBegin > begin) {
+        out.erase(out.begin(), out.begin() + static_cast<std::ptrdiff_t>(std::min(validBegin, end) - begin));
+    }
+}
+
+std::mutex& RegistryMutex() {
+    static std::mutex mutex;
+    return mutex;
+}
+
+std::vector<std::unique_ptr<ThreadBuffer>>& Registry() {
+    // 缓冲区在进程结束前不释放，线程退出后数据依然可导出
+    static std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+    return buffers;
+}
+
+int64_t NowNs() {
+    static const auto epoch = std::chrono::steady_clock::now();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now() - epoch)
+        .count();
+}
+
+ThreadBuffer& LocalBuffer() {
+    // 首次使用时注册（唯一加锁的地方）
+    thread_local ThreadBuffer* buffer = nullptr;
+    if (!buffer) {
+        auto created = std::make_unique<ThreadBuffer>();
+        created->events.reset(new TraceSlot[kBufferCapacity]);
+        std::lock_guard<std::mutex> lock(RegistryMutex());
+        auto& buffers = Registry();
+        created->tid = static_cast<int>(buffers.size()) + 1;
+        buffer = created.get();
+        buffers.push_back(std::move(created));
+    }
+    return *buffer;
+}
+
+void AppendEscaped(std::string& out, const char* text) {
+    for (const char* c = text; *c; ++c) {
+        if (*c == '"' || *c == '\\') {
+            out.push_back('\\');
+        }
+        out.push_back(*c);
+    }
+}
+}
+
+ScopedZone::ScopedZone(const char* name) : name_(name), startNs_(NowNs()) {}
+
+ScopedZone::~ScopedZone() {
+    int64_t endNs = NowNs();
+    ThreadBuffer& buffer = LocalBuffer();
+    uint64_t index = buffer.written.load(std::memory_order_relaxed);
+    TraceSlot& slot = buffer.events[index % kBufferCapacity];
+    slot.name.store(name_, std::memory_order_relaxed);
+    slot.startNs.store(startNs_, std::memory_order_relaxed);
+    slot.durationNs.store(endNs - startNs_, std::memory_order_relaxed);
+    buffer.written.store(index + 1, std::memory_order_release);
+}
+
+void SetThreadName(const char* name) {
+    ThreadBuffer& buffer = LocalBuffer();
+    std::lock_guard<std::mutex> lock(RegistryMutex());
+    buffer.name = name;
+}
+
+bool DumpTrace(const std::string& path) {
+    // 输出Complete事件（ph=X），时间单位为微秒
+    std::string json;
+    json.reserve(1 << 20);
+    json += "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    bool first = true;
+    char line[160];
+    std::vector<TraceEvent> events;
+    events.reserve(kBufferCapacity);
+
+    std::lock_guard<std::mutex> lock(RegistryMutex());
+    for (const auto& buffer : Registry()) {
+        if (!buffer->name.empty()) {
+            json += first ? "" : ",\n";
+            first = false;
+            std::snprintf(line, sizeof(line),
+                          "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"",
+                          buffer->tid);
+            json += line;
+            AppendEscaped(json, buffer->name.c_str());
+            json += "\"}}";
+        }
+
+        CopyEvents(*buffer, events);
+        for (const TraceEvent& event : events) {
+            json += first ? "" : ",\n";
+            first = false;
+            json += "{\"name\":\"";
+            AppendEscaped(json, event.name);
+            std::snprintf(line, sizeof(line), "\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+                          buffer->tid, static_cast<double>(event.startNs) / 1000.0,
+                          static_cast<double>(event.durationNs) / 1000.0);
+            json += line;
+        }
+    }
+    json += "\n]}\n";
+
+    std::FILE* file = std::fopen(path.c_str(), "wb");
+    if (!file) {
+        std::printf("Failed to write trace: %s\n", path.c_str());
+        return false;
+    }
+    bool ok = std::fwrite(json.data(), 1, json.size(), file) == json.size();
+    std::fclose(file);
+    std::printf("Trace written: %s\n", path.c_str());
+    return ok;
+}
+
+}
+
+#endif
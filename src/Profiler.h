@@ -0,0 +1,46 @@
+#pragma once
+
+// 轻量级分段计时，导出为Chrome Trace Event JSON（可用Perfetto打开）
+// 仅在定义SIMPLEMANIA_PROFILE时启用，否则所有宏展开为空语句
+
+#ifdef SIMPLEMANIA_PROFILE
+
+#include <cstdint>
+#include <string>
+
+namespace profiler {
+
+class ScopedZone {
+public:
+    // name必须是静态字符串（只保存指针）
+    explicit ScopedZone(const char* name);
+    ~ScopedZone();
+
+    ScopedZone(const ScopedZone&) = delete;
+    ScopedZone& operator=(const ScopedZone&) = delete;
+
+private:
+    const char* name_;
+    int64_t startNs_;
+};
+
+// 设置当前线程在trace中的名字
+void SetThreadName(const char* name);
+// 把所有线程缓冲区写成trace文件
+bool DumpTrace(const std::string& path);
+
+}
+
+#define SM_PROFILE_CONCAT_INNER(a, b) a##b
+#define SM_PROFILE_CONCAT(a, b) SM_PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_ZONE(name) ::profiler::ScopedZone SM_PROFILE_CONCAT(profileZone_, __LINE__)(name)
+#define PROFILE_THREAD_NAME(name) ::profiler::SetThreadName(name)
+#define PROFILE_DUMP(path) ::profiler::DumpTrace(path)
+
+#else
+
+#define PROFILE_ZONE(name) ((void)0)
+#define PROFILE_THREAD_NAME(name) ((void)0)
+#define PROFILE_DUMP(path) ((void)0)
+
+#endif
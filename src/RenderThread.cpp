@@ -0,0 +1,120 @@
+#include "RenderThread.h"
+
+#include "Profiler.h"
+
+namespace {
+double NowMs() {
+    return static_cast<double>(SDL_GetPerformanceCounter()) * 1000.0 /
+           static_cast<double>(SDL_GetPerformanceFrequency());
+}
+}
+
+RenderThread::~RenderThread() {
+    Stop();
+}
+
+bool RenderThread::Start(SDL_Window* window, int maxFps, std::string& error) {
+    minFrameMs_ = maxFps > 0 ? 1000.0 / maxFps : 0.0;
+    stopping_.store(false);
+    startState_ = 0;
+    thread_ = std::thread([this, window]() { Loop(window); });
+    std::unique_lock<std::mutex> lock(mutex_);
+    started_.wait(lock, [this]() { return startState_ != 0; });
+    if (startState_ < 0) {
+        error = startError_;
+        lock.unlock();
+        thread_.join();
+        return false;
+    }
+    return true;
+}
+
+void RenderThread::Stop() {
+    stopping_.store(true);
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+void RenderThread::Loop(SDL_Window* window) {
+    PROFILE_THREAD_NAME("Render");
+    // 渲染器在使用它的线程上创建，Present的阻塞只影响本线程
+    SDL_Renderer* renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        startState_ = renderer ? 1 : -1;
+        if (!renderer) {
+            startError_ = std::string("Renderer creation failed: ") + SDL_GetError();
+        }
+    }
+    started_.notify_all();
+    if (!renderer) {
+        return;
+    }
+
+    // 静态底层与皮肤图集纹理只在本线程的渲染器上创建与使用
+    RenderCache cache;
+    cache.sprites.SetSkin(skin_);
+    bool hasFrame = false;
+    while (!stopping_.load(std::memory_order_relaxed)) {
+        double frameStartMs = NowMs();
+        hasFrame = buffer_.Acquire() || hasFrame;
+        if (!hasFrame) {
+            SDL_Delay(1);
+            continue;
+        }
+        if (texturesLost_.exchange(false)) {
+            cache.Invalidate();
+        }
+        {
+            PROFILE_ZONE("Render");
+            Draw(renderer, cache, buffer_.ReadSlot(), frameStartMs);
+        }
+        {
+            PROFILE_ZONE("Present");
+            SDL_RenderPresent(renderer);
+        }
+        // 垂直同步未生效时按帧率上限休眠
+        double frameElapsed = NowMs() - frameStartMs;
+        if (frameElapsed < minFrameMs_) {
+            PROFILE_ZONE("FrameLimit");
+            SDL_Delay(static_cast<Uint32>(minFrameMs_ - frameElapsed));
+        }
+    }
+    cache.Release();
+    SDL_DestroyRenderer(renderer);
+}
+
+void RenderThread::Draw(SDL_Renderer* renderer, RenderCache& cache, const FrameSnapshot& frame, double nowMs) {
+    switch (frame.screen) {
+        case FrameScreen::Playfield: {
+            int chartMs = frame.nowMs;
+            if (frame.advancing) {
+                chartMs += static_cast<int>((nowMs - frame.capturedAtMs) * frame.playfield.rate);
+            }
+            RenderFrame(renderer, frame.playfield, chartMs, frame.scrollSpeed, frame.config, frame.showStartOverlay,
+                        &cache);
+            if (frame.countdownNumber > 0) {
+                RenderCountdown(renderer, frame.config, frame.countdownNumber);
+            }
+            if (frame.pauseMenuIndex >= 0) {
+                RenderPauseMenu(renderer, frame.config, frame.pauseMenuIndex);
+            }
+            break;
+        }
+        case FrameScreen::Calibration:
+            RenderCalibrationResult(renderer, frame.config, frame.calibration, frame.globalOffsetMs);
+            break;
+        case FrameScreen::Results:
+            if (frame.results) {
+                RenderResults(renderer, *frame.results);
+            }
+            break;
+        case FrameScreen::Editor:
+            RenderEditor(renderer, frame.editor, frame.scrollSpeed, frame.config, &cache);
+            break;
+        case FrameScreen::Menu:
+            RenderMenu(renderer, frame.config, frame.menu, &cache);
+            break;
+    }
+}
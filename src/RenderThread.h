@@ -0,0 +1,83 @@
+#pragma once
+
+#include <SDL.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "Calibration.h"
+#include "Renderer.h"
+#include "TripleBuffer.h"
+
+enum class FrameScreen {
+    Menu,
+    Playfield,
+    Calibration,
+    Results,
+    Editor
+};
+
+struct FrameSnapshot {
+    // 一帧画面所需的全部数据：游戏线程原地填写，经三缓冲交给渲染线程
+    FrameScreen screen = FrameScreen::Menu;
+    RenderConfig config;
+    MenuView menu;
+    PlayfieldView playfield;
+    EditorView editor;
+    int nowMs = 0;
+    float scrollSpeed = 1.0f;
+    // 谱面时间在走时，渲染线程按采样时刻外推到实际绘制的时刻
+    bool advancing = false;
+    double capturedAtMs = 0.0;
+    bool showStartOverlay = false;
+    // 叠加层：倒计时数字（0为无）与暂停菜单选中项（-1为无）
+    int countdownNumber = 0;
+    int pauseMenuIndex = -1;
+    CalibrationResult calibration;
+    double globalOffsetMs = 0.0;
+    std::shared_ptr<const ResultsView> results;
+};
+
+class RenderThread {
+public:
+    // 线程分工：SDL_Renderer与其纹理只在渲染线程上创建、绘制与销毁；窗口操作（SDL_SetWindowSize等）、
+    // SDL_PollEvent/SDL_PumpEvents与键盘状态只在主线程上调用。渲染器的事件监视在主线程推送窗口事件时运行，
+    // 所以主线程改窗口大小前要Stop，改完并处理掉事件后再Start（渲染器按新大小重建）
+    RenderThread() = default;
+    ~RenderThread();
+    RenderThread(const RenderThread&) = delete;
+    RenderThread& operator=(const RenderThread&) = delete;
+
+    // 在新线程上为window创建开启垂直同步的SDL_Renderer；垂直同步不可用时按maxFps限帧
+    bool Start(SDL_Window* window, int maxFps, std::string& error);
+    // 等渲染线程退出并销毁渲染器；之后可以再次Start
+    void Stop();
+
+    // 游戏线程：在返回的快照上原地填写（上一轮的内容与容量都还在），然后Submit
+    FrameSnapshot& BeginFrame() { return buffer_.WriteSlot(); }
+    void Submit() { buffer_.Publish(); }
+    // 渲染目标或设备被重置（SDL_RENDER_TARGETS_RESET等事件）后通知渲染线程重建纹理
+    void InvalidateTextures() { texturesLost_.store(true); }
+    // 皮肤在Start之前设置，之后只读
+    void SetSkin(std::shared_ptr<const Skin> skin) { skin_ = std::move(skin); }
+
+private:
+    void Loop(SDL_Window* window);
+    void Draw(SDL_Renderer* renderer, RenderCache& cache, const FrameSnapshot& frame, double nowMs);
+
+    TripleBuffer<FrameSnapshot> buffer_;
+    double minFrameMs_ = 0.0;
+    std::atomic<bool> stopping_{false};
+    std::atomic<bool> texturesLost_{false};
+    std::shared_ptr<const Skin> skin_;
+    std::mutex mutex_;
+    std::condition_variable started_;
+    // 0等待创建，1成功，-1失败
+    int startState_ = 0;
+    std::string startError_;
+    std::thread thread_;
+};
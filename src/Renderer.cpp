@@ -1,6 +1,9 @@
 #include "Renderer.h"
 
 #include <algorithm>
+#include <array>
+#include <climits>
+#include <cmath>
 #include <cstdio>
 #include <string>
 
@@ -60,6 +63,8 @@ const Glyph kFont[] = {
     {'/', {0x01, 0x02, 0x04, 0x08, 0x10, 0x00, 0x00}},
     {'-', {0x00, 0x00, 0x00, 0x1F, 0x00, 0x00, 0x00}},
     {'%', {0x19, 0x1A, 0x04, 0x08, 0x16, 0x07, 0x00}},
+    {'[', {0x0E, 0x08, 0x08, 0x08, 0x08, 0x08, 0x0E}},
+    {']', {0x0E, 0x02, 0x02, 0x02, 0x02, 0x02, 0x0E}},
     {' ', {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}}
 };
 
@@ -98,13 +103,64 @@ void DrawText(SDL_Renderer* renderer, int x, int y, int scale, SDL_Color color,
     }
 }
 
+RectBatch& BatchFor(ResultsView& view, SDL_Color color) {
+    // 相同颜色共用一个批次
+    for (auto& batch : view.batches) {
+        if (batch.color.r == color.r && batch.color.g == color.g &&
+            batch.color.b == color.b && batch.color.a == color.a) {
+            return batch;
+        }
+    }
+    view.batches.push_back(RectBatch{color, {}});
+    return view.batches.back();
+}
+
+void AppendText(ResultsView& view, int x, int y, int scale, SDL_Color color, const std::string& text) {
+    // 与DrawText相同的字形，但输出为矩形列表
+    auto& rects = BatchFor(view, color).rects;
+    int cursorX = x;
+    for (char c : text) {
+        const Glyph* glyph = FindGlyph(c);
+        if (glyph) {
+            for (int row = 0; row < 7; ++row) {
+                for (int col = 0; col < 5; ++col) {
+                    if (glyph->rows[row] & (1 << (4 - col))) {
+                        rects.push_back(SDL_FRect{static_cast<float>(cursorX + col * scale),
+                                                  static_cast<float>(y + row * scale),
+                                                  static_cast<float>(scale), static_cast<float>(scale)});
+                    }
+                }
+            }
+        }
+        cursorX += 6 * scale;
+    }
+}
+
+void AppendRect(ResultsView& view, SDL_Color color, float x, float y, float w, float h) {
+    BatchFor(view, color).rects.push_back(SDL_FRect{x, y, w, h});
+}
+
+void AppendFrame(ResultsView& view, SDL_Color color, float x, float y, float w, float h) {
+    // 1像素边框
+    AppendRect(view, color, x, y, w, 1.0f);
+    AppendRect(view, color, x, y + h - 1.0f, w, 1.0f);
+    AppendRect(view, color, x, y, 1.0f, h);
+    AppendRect(view, color, x + w - 1.0f, y, 1.0f, h);
+}
+
 std::string JudgeToString(JudgeGrade grade) {
     // 判定字符串
     switch (grade) {
+        case JudgeGrade::Max:
+            return "MAX";
         case JudgeGrade::Perfect:
             return "PERFECT";
+        case JudgeGrade::Great:
+            return "GREAT";
         case JudgeGrade::Good:
             return "GOOD";
+        case JudgeGrade::Bad:
+            return "BAD";
         case JudgeGrade::Miss:
             return "MISS";
         default:
@@ -115,27 +171,29 @@ std::string JudgeToString(JudgeGrade grade) {
 SDL_Color JudgeColor(JudgeGrade grade) {
     // 判定颜色
     switch (grade) {
+        case JudgeGrade::Max:
+            return SDL_Color{250, 250, 210, 255};
         case JudgeGrade::Perfect:
             return SDL_Color{245, 200, 70, 255};
+        case JudgeGrade::Great:
+            return SDL_Color{110, 220, 110, 255};
         case JudgeGrade::Good:
             return SDL_Color{80, 170, 255, 255};
+        case JudgeGrade::Bad:
+            return SDL_Color{180, 120, 230, 255};
         case JudgeGrade::Miss:
             return SDL_Color{235, 80, 80, 255};
         default:
             return SDL_Color{240, 240, 240, 255};
     }
 }
-}
 
-void RenderFrame(SDL_Renderer* renderer, const Game& game, int nowMs, float scrollSpeed,
-                 const RenderConfig& config, bool showStartOverlay) {
-    // 游戏画面渲染
+void DrawPlayfieldBase(SDL_Renderer* renderer, const RenderConfig& config, int keyCount) {
+    // 游玩区静态底层：背景、轨道与判定线
     SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
     SDL_RenderClear(renderer);
 
-    int keyCount = std::max(1, game.GetKeyCount());
     float laneWidth = static_cast<float>(config.playWidth) / static_cast<float>(keyCount);
-
     for (int lane = 0; lane < keyCount; ++lane) {
         // 绘制轨道
         SDL_Color color = LaneColor(lane, keyCount);
@@ -152,58 +210,439 @@ void RenderFrame(SDL_Renderer* renderer, const Game& game, int nowMs, float scro
     SDL_SetRenderDrawColor(renderer, 220, 220, 230, 255);
     SDL_Rect judgeLine{config.offsetX, config.judgeLineY - 2, config.playWidth, 4};
     SDL_RenderFillRect(renderer, &judgeLine);
+}
 
-    const auto& notes = game.GetNotes();
-    for (const auto& note : notes) {
-        // 绘制未判定音符
-        if (note.judged) {
-            continue;
+void DrawMenuBase(SDL_Renderer* renderer) {
+    // 菜单静态底层：背景、标题与固定的按键提示
+    SDL_SetRenderDrawColor(renderer, 14, 14, 20, 255);
+    SDL_RenderClear(renderer);
+
+    SDL_Color titleColor{235, 225, 210, 255};
+    DrawText(renderer, 24, 24, 3, titleColor, "SELECT BEATMAP");
+    SDL_Color hintColor{180, 180, 180, 255};
+    DrawText(renderer, 24, 60, 2, hintColor, "UP/DOWN/PGUP/PGDN: SELECT  ENTER: PLAY  F4: SORT  F6: STARS");
+    DrawText(renderer, 24, 82, 2, hintColor, "CTRL +/-: SPEED  CTRL [/]: OFFSET  F2: CALIBRATE  F3: JUDGE  F11: EDIT");
+    DrawText(renderer, 24, 104, 2, hintColor, "KEYS 4K DFJK  5K DF SPACE JK  6K SDF JKL  7K SDF SPACE JKL");
+}
+
+bool SameLayout(const RenderConfig& a, const RenderConfig& b) {
+    return a.windowWidth == b.windowWidth && a.windowHeight == b.windowHeight && a.playWidth == b.playWidth &&
+           a.playHeight == b.playHeight && a.offsetX == b.offsetX && a.judgeLineY == b.judgeLineY &&
+           a.noteHeight == b.noteHeight && a.lanePadding == b.lanePadding;
+}
+
+void DrawFlatNotes(SDL_Renderer* renderer, const PlayfieldView& view, int nowMs, float scrollSpeed,
+                   const RenderConfig& config) {
+    // 没有皮肤纹理时的回退：音符画成纯色矩形
+    int keyCount = std::max(1, view.keyCount);
+    float laneWidth = static_cast<float>(config.playWidth) / static_cast<float>(keyCount);
+    // 音符按时间递增，超出屏幕顶部即停止；下落距离按真实时间计算，变速时视觉速度不变
+    float pixelsPerChartMs = scrollSpeed / static_cast<float>(view.rate);
+    SDL_SetRenderDrawColor(renderer, 245, 180, 70, 255);
+    for (int lane = 0; lane < keyCount; ++lane) {
+        for (uint32_t i = view.laneStart[lane]; i < view.laneStart[lane + 1]; ++i) {
+            float timeDiff = static_cast<float>(view.noteTimes[i] - nowMs);
+            float y = static_cast<float>(config.judgeLineY) - timeDiff * pixelsPerChartMs;
+            if (y < -config.noteHeight) {
+                break;
+            }
+            if (y > config.playHeight + config.noteHeight) {
+                continue;
+            }
+            SDL_Rect noteRect{
+                static_cast<int>(config.offsetX + lane * laneWidth + config.lanePadding + 4),
+                static_cast<int>(y - config.noteHeight),
+                static_cast<int>(laneWidth - config.lanePadding * 2 - 8),
+                config.noteHeight
+            };
+            SDL_RenderFillRect(renderer, &noteRect);
+        }
+    }
+}
+
+float SpriteHeight(const Skin& skin, SkinSprite sprite, float noteWidth, const RenderConfig& config) {
+    // 内置皮肤沿用配置的音符高度，外部皮肤按图片宽高比缩放到音符宽度
+    const SDL_Rect& rect = skin.Sprite(sprite);
+    if (skin.keepNoteHeight || rect.w <= 0) {
+        return static_cast<float>(config.noteHeight);
+    }
+    return noteWidth * static_cast<float>(rect.h) / static_cast<float>(rect.w);
+}
+
+SkinSprite JudgeSprite(JudgeGrade grade) {
+    switch (grade) {
+        case JudgeGrade::Max:
+            return SkinSprite::JudgeMax;
+        case JudgeGrade::Perfect:
+            return SkinSprite::JudgePerfect;
+        case JudgeGrade::Great:
+            return SkinSprite::JudgeGreat;
+        case JudgeGrade::Good:
+            return SkinSprite::JudgeGood;
+        case JudgeGrade::Bad:
+            return SkinSprite::JudgeBad;
+        default:
+            return SkinSprite::JudgeMiss;
+    }
+}
+
+bool AddPlayfieldSprites(SpriteBatch& batch, const HitEffects& effects, const PlayfieldView& view, int nowMs,
+                         float scrollSpeed, const RenderConfig& config, bool showJudge) {
+    // 按键、光柱、长条、音符与粒子按绘制顺序加入批次；返回判定是否已由判定图画出
+    const Skin& skin = *batch.GetSkin();
+    int keyCount = std::max(1, view.keyCount);
+    float laneWidth = static_cast<float>(config.playWidth) / static_cast<float>(keyCount);
+    float noteWidth = laneWidth - config.lanePadding * 2 - 8;
+    float judgeY = static_cast<float>(config.judgeLineY);
+    float pixelsPerChartMs = scrollSpeed / static_cast<float>(view.rate);
+    float noteHeight = SpriteHeight(skin, SkinSprite::Note, noteWidth, config);
+    float headHeight = SpriteHeight(skin, SkinSprite::HoldHead, noteWidth, config);
+    float tailHeight =
+        skin.Has(SkinSprite::HoldTail) ? SpriteHeight(skin, SkinSprite::HoldTail, noteWidth, config) : 0.0f;
+    const SDL_Color white{255, 255, 255, 255};
+
+    // 按键：判定线下方整条轨道宽，松开时调暗
+    if (skin.Has(SkinSprite::Key)) {
+        for (int lane = 0; lane < keyCount; ++lane) {
+            bool pressed = (view.pressedLanes >> lane) & 1u;
+            SDL_Color tint = pressed ? white : SDL_Color{150, 150, 150, 255};
+            SDL_FRect keyRect{config.offsetX + lane * laneWidth + config.lanePadding, judgeY + 2,
+                              laneWidth - config.lanePadding * 2, static_cast<float>(config.playHeight) - judgeY - 2};
+            batch.Add(SkinSprite::Key, keyRect, tint);
         }
-        float timeDiff = static_cast<float>(note.timeMs - nowMs);
-        float y = static_cast<float>(config.judgeLineY) - timeDiff * scrollSpeed;
-        if (y < -config.noteHeight || y > config.playHeight + config.noteHeight) {
+    }
+
+    // 光柱：按住时淡白色，击中后按判定颜色闪亮，从判定线向上渐隐
+    float beamHeight = judgeY * 0.4f;
+    for (int lane = 0; lane < keyCount; ++lane) {
+        float flash = effects.LaneFlash(lane, nowMs);
+        bool pressed = (view.pressedLanes >> lane) & 1u;
+        if (flash <= 0.0f && !pressed) {
             continue;
         }
-        SDL_Rect noteRect{
-            static_cast<int>(config.offsetX + note.lane * laneWidth + config.lanePadding + 4),
-            static_cast<int>(y - config.noteHeight),
-            static_cast<int>(laneWidth - config.lanePadding * 2 - 8),
-            config.noteHeight
+        SDL_Color bottom = flash > 0.0f ? JudgeColor(effects.LaneFlashGrade(lane)) : white;
+        bottom.a = static_cast<Uint8>(std::max(pressed ? 70.0f : 0.0f, flash * 180.0f));
+        SDL_Color top = bottom;
+        top.a = 0;
+        SDL_FRect beamRect{config.offsetX + lane * laneWidth + config.lanePadding, judgeY - beamHeight,
+                           laneWidth - config.lanePadding * 2, beamHeight};
+        batch.AddGradient(SkinSprite::Beam, beamRect, top, bottom);
+    }
+
+    for (int lane = 0; lane < keyCount; ++lane) {
+        float x = config.offsetX + lane * laneWidth + config.lanePadding + 4;
+        auto yOf = [&](int timeMs) { return judgeY - static_cast<float>(timeMs - nowMs) * pixelsPerChartMs; };
+        // 长条身在头尾之间拉伸，下端不越过判定线
+        auto addHoldBody = [&](float headY, int endMs) {
+            float tailY = yOf(endMs);
+            float bottom = std::min(headY, judgeY);
+            if (bottom > tailY) {
+                batch.Add(SkinSprite::HoldBody, SDL_FRect{x, tailY, noteWidth, bottom - tailY}, white);
+            }
+            if (tailHeight > 0.0f) {
+                batch.Add(SkinSprite::HoldTail, SDL_FRect{x, tailY - tailHeight, noteWidth, tailHeight}, white);
+            }
         };
-        SDL_SetRenderDrawColor(renderer, 245, 180, 70, 255);
-        SDL_RenderFillRect(renderer, &noteRect);
+        if (view.activeHoldEndMs[lane] > nowMs) {
+            addHoldBody(judgeY, view.activeHoldEndMs[lane]);
+        }
+        for (uint32_t i = view.laneStart[lane]; i < view.laneStart[lane + 1]; ++i) {
+            float y = yOf(view.noteTimes[i]);
+            if (y < -noteHeight) {
+                break;
+            }
+            if (y > config.playHeight + noteHeight) {
+                continue;
+            }
+            if (view.noteEndTimes[i] > view.noteTimes[i]) {
+                addHoldBody(y, view.noteEndTimes[i]);
+                batch.Add(SkinSprite::HoldHead, SDL_FRect{x, y - headHeight, noteWidth, headHeight}, white);
+            } else {
+                batch.Add(SkinSprite::Note, SDL_FRect{x, y - noteHeight, noteWidth, noteHeight}, white);
+            }
+        }
+    }
+
+    // 击中粒子：偏移相对所在轨道中心与判定线
+    const ParticleFrame& particles = effects.Visible();
+    for (int i = 0; i < particles.count; ++i) {
+        float centerX = config.offsetX + (particles.lane[i] + 0.5f) * laneWidth;
+        float size = particles.size[i];
+        SDL_Color color = JudgeColor(static_cast<JudgeGrade>(particles.grade[i]));
+        color.a = particles.alpha[i];
+        SDL_FRect rect{centerX + particles.x[i] - size / 2.0f, judgeY + particles.y[i] - size / 2.0f, size, size};
+        batch.Add(SkinSprite::Particle, rect, color);
+    }
+
+    // 判定图按原尺寸居中，过宽时缩小到游玩区宽度的八成
+    SkinSprite judgeSprite = JudgeSprite(view.lastJudge);
+    if (!showJudge || !skin.Has(judgeSprite)) {
+        return false;
+    }
+    const SDL_Rect& rect = skin.Sprite(judgeSprite);
+    float scale = std::min(1.0f, config.playWidth * 0.8f / static_cast<float>(rect.w));
+    float width = rect.w * scale;
+    float height = rect.h * scale;
+    SDL_FRect judgeRect{config.offsetX + (config.playWidth - width) / 2.0f, config.playHeight / 2.0f + 40.0f, width,
+                        height};
+    batch.Add(judgeSprite, judgeRect, white);
+    return true;
+}
+}
+
+bool SpriteBatch::Begin(SDL_Renderer* renderer) {
+    if (!skin_ || !skin_->atlas) {
+        return false;
+    }
+    if (!texture_) {
+        texture_ = SDL_CreateTextureFromSurface(renderer, skin_->atlas.get());
+        if (!texture_) {
+            return false;
+        }
+        SDL_SetTextureBlendMode(texture_, SDL_BLENDMODE_BLEND);
+    }
+    vertices_.clear();
+    indices_.clear();
+    return true;
+}
+
+void SpriteBatch::AddGradient(SkinSprite sprite, const SDL_FRect& dst, SDL_Color top, SDL_Color bottom) {
+    // 每个矩形4个顶点6个索引，纹理坐标按图集尺寸归一化
+    const SDL_Rect& src = skin_->Sprite(sprite);
+    float atlasWidth = static_cast<float>(skin_->atlas->w);
+    float atlasHeight = static_cast<float>(skin_->atlas->h);
+    float u0 = src.x / atlasWidth;
+    float v0 = src.y / atlasHeight;
+    float u1 = (src.x + src.w) / atlasWidth;
+    float v1 = (src.y + src.h) / atlasHeight;
+    int base = static_cast<int>(vertices_.size());
+    vertices_.push_back(SDL_Vertex{SDL_FPoint{dst.x, dst.y}, top, SDL_FPoint{u0, v0}});
+    vertices_.push_back(SDL_Vertex{SDL_FPoint{dst.x + dst.w, dst.y}, top, SDL_FPoint{u1, v0}});
+    vertices_.push_back(SDL_Vertex{SDL_FPoint{dst.x + dst.w, dst.y + dst.h}, bottom, SDL_FPoint{u1, v1}});
+    vertices_.push_back(SDL_Vertex{SDL_FPoint{dst.x, dst.y + dst.h}, bottom, SDL_FPoint{u0, v1}});
+    for (int offset : {0, 1, 2, 2, 3, 0}) {
+        indices_.push_back(base + offset);
+    }
+}
+
+void SpriteBatch::Flush(SDL_Renderer* renderer) {
+    if (!vertices_.empty()) {
+        SDL_RenderGeometry(renderer, texture_, vertices_.data(), static_cast<int>(vertices_.size()), indices_.data(),
+                           static_cast<int>(indices_.size()));
+    }
+    vertices_.clear();
+    indices_.clear();
+}
+
+void SpriteBatch::Invalidate() {
+    if (texture_) {
+        SDL_DestroyTexture(texture_);
+        texture_ = nullptr;
+    }
+}
+
+bool StaticLayers::Prepare(Layer& layer, SDL_Renderer* renderer, const RenderConfig& config, int keyCount) {
+    // 返回true表示纹理需要重绘；纹理无法创建时返回false且texture为空
+    if (layer.valid && layer.keyCount == keyCount && SameLayout(layer.config, config)) {
+        return false;
+    }
+    if (!SDL_RenderTargetSupported(renderer)) {
+        return false;
     }
+    if (!layer.texture || layer.width != config.windowWidth || layer.height != config.windowHeight) {
+        if (layer.texture) {
+            SDL_DestroyTexture(layer.texture);
+        }
+        layer.texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_TARGET,
+                                          config.windowWidth, config.windowHeight);
+        layer.width = config.windowWidth;
+        layer.height = config.windowHeight;
+        if (!layer.texture) {
+            return false;
+        }
+        // 底层不透明，贴图时直接覆盖
+        SDL_SetTextureBlendMode(layer.texture, SDL_BLENDMODE_NONE);
+    }
+    layer.config = config;
+    layer.keyCount = keyCount;
+    layer.valid = true;
+    return true;
+}
+
+void StaticLayers::DrawPlayfield(SDL_Renderer* renderer, const RenderConfig& config, int keyCount) {
+    if (Prepare(playfield_, renderer, config, keyCount)) {
+        SDL_SetRenderTarget(renderer, playfield_.texture);
+        DrawPlayfieldBase(renderer, config, keyCount);
+        SDL_SetRenderTarget(renderer, nullptr);
+    }
+    if (playfield_.texture && playfield_.valid) {
+        SDL_RenderCopy(renderer, playfield_.texture, nullptr, nullptr);
+    } else {
+        DrawPlayfieldBase(renderer, config, keyCount);
+    }
+}
+
+void StaticLayers::DrawMenu(SDL_Renderer* renderer, const RenderConfig& config) {
+    if (Prepare(menu_, renderer, config, 0)) {
+        SDL_SetRenderTarget(renderer, menu_.texture);
+        DrawMenuBase(renderer);
+        SDL_SetRenderTarget(renderer, nullptr);
+    }
+    if (menu_.texture && menu_.valid) {
+        SDL_RenderCopy(renderer, menu_.texture, nullptr, nullptr);
+    } else {
+        DrawMenuBase(renderer);
+    }
+}
+
+void StaticLayers::Invalidate() {
+    // 重置后旧的目标纹理不能再用，销毁后由Prepare按当前布局重新创建并重绘
+    for (Layer* layer : {&playfield_, &menu_}) {
+        if (layer->texture) {
+            SDL_DestroyTexture(layer->texture);
+        }
+        *layer = Layer();
+    }
+}
+
+void BuildPlayfieldView(const Game& game, int nowMs, float scrollSpeed, const RenderConfig& config,
+                        PlayfieldView& out) {
+    // 每条轨道从判定游标整块解码到屏幕顶部之外一段，留出渲染线程外推的余量
+    out.keyCount = std::max(1, game.GetKeyCount());
+    out.rate = game.GetRate();
+    float pixelsPerChartMs = std::max(scrollSpeed, 0.01f) / static_cast<float>(out.rate);
+    int horizonMs = nowMs + static_cast<int>((config.judgeLineY + config.noteHeight) / pixelsPerChartMs) + 250;
+    out.noteTimes.clear();
+    out.noteEndTimes.clear();
+    out.activeHoldEndMs.fill(INT_MIN);
+    out.pressedLanes = 0;
+    std::array<Note, kPackedBlockSize> decoded;
+    for (int lane = 0; lane < out.keyCount; ++lane) {
+        out.laneStart[lane] = static_cast<uint32_t>(out.noteTimes.size());
+        const PackedNoteList& laneNotes = game.GetLaneNotes(lane);
+        // 从游标前一个音符开始解码：它若是还没结束的长条，长条身要继续画
+        size_t cursor = game.GetLaneCursor(lane);
+        size_t index = cursor > 0 ? cursor - 1 : 0;
+        bool beyond = false;
+        while (!beyond && index < laneNotes.Size()) {
+            size_t count = laneNotes.Decode(index, kPackedBlockSize - index % kPackedBlockSize, decoded.data());
+            for (size_t i = 0; i < count; ++i) {
+                const Note& note = decoded[i];
+                if (index + i < cursor) {
+                    if (note.isHold && note.endTimeMs > nowMs) {
+                        out.activeHoldEndMs[lane] = note.endTimeMs;
+                    }
+                    continue;
+                }
+                if (note.timeMs > horizonMs) {
+                    beyond = true;
+                    break;
+                }
+                out.noteTimes.push_back(note.timeMs);
+                out.noteEndTimes.push_back(note.isHold ? note.endTimeMs : note.timeMs);
+            }
+            index += count;
+        }
+    }
+    out.laneStart[out.keyCount] = static_cast<uint32_t>(out.noteTimes.size());
 
     const GameStats& stats = game.GetStats();
-    // HUD: 分数、速度、ACC、连击与判定
+    out.score = game.GetTotalScore();
+    out.combo = stats.combo;
+    out.accuracy = game.GetAccuracy();
+    out.unstableRate = stats.hitError.UnstableRate();
+    out.lastJudge = stats.lastJudge;
+    out.lastJudgeTimeMs = stats.lastJudgeTimeMs;
+    out.histogramRangeMs = stats.hitError.histogramRangeMs;
+    const auto& records = game.GetHitRecords();
+    size_t recentCount = std::min<size_t>(records.size(), 24);
+    out.recentHits.assign(records.end() - static_cast<std::ptrdiff_t>(recentCount), records.end());
+    out.judgeEvents.clear();
+    for (uint64_t sequence = game.GetJudgeEventBegin(); sequence < game.GetJudgeEventEnd(); ++sequence) {
+        out.judgeEvents.push_back(game.GetJudgeEvent(sequence));
+    }
+    out.judgeEventEnd = game.GetJudgeEventEnd();
+}
 
+void RenderFrame(SDL_Renderer* renderer, const PlayfieldView& view, int nowMs, float scrollSpeed,
+                 const RenderConfig& config, bool showStartOverlay, RenderCache* cache) {
+    // 游戏画面渲染：静态底层一次贴图，按键、音符与长条一次批量提交，之后画HUD
+    int keyCount = std::max(1, view.keyCount);
+    if (cache) {
+        cache->layers.DrawPlayfield(renderer, config, keyCount);
+    } else {
+        DrawPlayfieldBase(renderer, config, keyCount);
+    }
+
+    bool showJudge = view.lastJudge != JudgeGrade::None && (nowMs - view.lastJudgeTimeMs) < 1000;
+    bool judgeDrawn = false;
+    if (cache && cache->sprites.Begin(renderer)) {
+        cache->effects.Update(view.judgeEvents, view.judgeEventEnd, nowMs);
+        judgeDrawn = AddPlayfieldSprites(cache->sprites, cache->effects, view, nowMs, scrollSpeed, config, showJudge);
+        cache->sprites.Flush(renderer);
+    } else {
+        DrawFlatNotes(renderer, view, nowMs, scrollSpeed, config);
+    }
+
+    // HUD: 分数、速度、ACC、连击与判定
     SDL_Color textColor{240, 240, 240, 255};
-    int totalScore = game.GetTotalScore();
-    double acc = game.GetAccuracy();
+    int totalScore = view.score;
+    double acc = view.accuracy;
     char scoreText[64];
     char accText[64];
     char speedText[64];
     std::snprintf(scoreText, sizeof(scoreText), "SCORE %d", totalScore);
     std::snprintf(accText, sizeof(accText), "ACC %05.2f%%", acc);
-    std::snprintf(speedText, sizeof(speedText), "SPEED %.2f", scrollSpeed);
+    if (view.rate != 1.0) {
+        std::snprintf(speedText, sizeof(speedText), "SPEED %.2f  %.2fX", scrollSpeed, view.rate);
+    } else {
+        std::snprintf(speedText, sizeof(speedText), "SPEED %.2f", scrollSpeed);
+    }
 
     DrawText(renderer, config.offsetX + 16, 16, 2, textColor, scoreText);
     DrawText(renderer, config.offsetX + 16, 40, 2, textColor, speedText);
     int accWidth = static_cast<int>(std::string(accText).size()) * 12;
     DrawText(renderer, config.offsetX + config.playWidth - accWidth - 16, 16, 2, textColor, accText);
 
+    char urText[64];
+    std::snprintf(urText, sizeof(urText), "UR %.1f", view.unstableRate);
+    int urWidth = static_cast<int>(std::string(urText).size()) * 12;
+    DrawText(renderer, config.offsetX + config.playWidth - urWidth - 16, 40, 2, textColor, urText);
+
+    // 判定线下方的偏差条：中线为0，最近的击中偏差以短竖线表示
+    int barHalfWidth = 120;
+    int barCenterX = config.offsetX + config.playWidth / 2;
+    int barY = config.judgeLineY + 30;
+    SDL_SetRenderDrawColor(renderer, 90, 90, 100, 255);
+    SDL_Rect barRect{barCenterX - barHalfWidth, barY, barHalfWidth * 2, 2};
+    SDL_RenderFillRect(renderer, &barRect);
+    SDL_Rect centerTick{barCenterX - 1, barY - 8, 2, 18};
+    SDL_SetRenderDrawColor(renderer, 240, 240, 240, 255);
+    SDL_RenderFillRect(renderer, &centerTick);
+    int range = std::max(1, view.histogramRangeMs);
+    for (const HitRecord& record : view.recentHits) {
+        if (record.grade == JudgeGrade::Miss) {
+            continue;
+        }
+        int offset = std::max(-range, std::min(range, record.offsetMs));
+        SDL_Color color = JudgeColor(record.grade);
+        SDL_SetRenderDrawColor(renderer, color.r, color.g, color.b, 255);
+        SDL_Rect tick{barCenterX + offset * barHalfWidth / range - 1, barY - 6, 2, 14};
+        SDL_RenderFillRect(renderer, &tick);
+    }
+
     char comboText[64];
-    std::snprintf(comboText, sizeof(comboText), "COMBO %d", stats.combo);
+    std::snprintf(comboText, sizeof(comboText), "COMBO %d", view.combo);
     int comboWidth = static_cast<int>(std::string(comboText).size()) * 12;
     DrawText(renderer, config.offsetX + config.playWidth / 2 - comboWidth / 2, 56, 2, textColor, comboText);
 
-    if (stats.lastJudge != JudgeGrade::None && (nowMs - stats.lastJudgeTimeMs) < 1000) {
-        std::string judgeText = JudgeToString(stats.lastJudge);
+    if (showJudge && !judgeDrawn) {
+        std::string judgeText = JudgeToString(view.lastJudge);
         int judgeScale = 3;
         int judgeWidth = static_cast<int>(judgeText.size()) * 6 * judgeScale;
         int judgeX = config.offsetX + config.playWidth / 2 - judgeWidth / 2;
         int judgeY = config.playHeight / 2 + 40;
-        DrawText(renderer, judgeX, judgeY, judgeScale, JudgeColor(stats.lastJudge), judgeText);
+        DrawText(renderer, judgeX, judgeY, judgeScale, JudgeColor(view.lastJudge), judgeText);
     }
 
     if (showStartOverlay) {
@@ -230,33 +669,186 @@ void RenderFrame(SDL_Renderer* renderer, const Game& game, int nowMs, float scro
 
 }
 
-void RenderMenu(SDL_Renderer* renderer, const RenderConfig& config,
-                const std::vector<std::string>& items, int selectedIndex) {
-    // 菜单渲染
-    SDL_SetRenderDrawColor(renderer, 14, 14, 20, 255);
-    SDL_RenderClear(renderer);
+void BuildEditorView(const ChartEditor& editor, float scrollSpeed, const RenderConfig& config, EditorView& out) {
+    // 游标固定在判定线上：取屏幕底部到顶部对应的时间范围，两端各留一个音符高度的余量
+    out.keyCount = std::max(1, editor.GetKeyCount());
+    out.cursorMs = editor.GetCursorMs();
+    float pixelsPerMs = std::max(scrollSpeed, 0.01f);
+    int fromMs = out.cursorMs -
+                 static_cast<int>((config.playHeight - config.judgeLineY + config.noteHeight) / pixelsPerMs) - 1;
+    int toMs = out.cursorMs + static_cast<int>((config.judgeLineY + config.noteHeight) / pixelsPerMs) + 1;
+    out.noteTimes.clear();
+    out.noteEndTimes.clear();
+    for (int lane = 0; lane < out.keyCount; ++lane) {
+        out.laneStart[lane] = static_cast<uint32_t>(out.noteTimes.size());
+        out.scratch.clear();
+        editor.CollectNotes(lane, fromMs, toMs, out.scratch);
+        for (const EditNote& note : out.scratch) {
+            out.noteTimes.push_back(note.timeMs);
+            out.noteEndTimes.push_back(note.endTimeMs);
+        }
+    }
+    out.laneStart[out.keyCount] = static_cast<uint32_t>(out.noteTimes.size());
+    out.gridTimes.clear();
+    out.gridBeats.clear();
+    editor.CollectGrid(fromMs, toMs, out.gridTimes, out.gridBeats);
 
-    SDL_Color titleColor{235, 225, 210, 255};
-    DrawText(renderer, 24, 24, 3, titleColor, "SELECT BEATMAP");
+    char statusText[128];
+    std::snprintf(statusText, sizeof(statusText), "%d:%02d.%03d  1/%d  NOTES %zu  UNDO %zu  REDO %zu%s",
+                  out.cursorMs / 60000, out.cursorMs / 1000 % 60, out.cursorMs % 1000, editor.GetDivisor(),
+                  editor.GetNoteCount(), editor.GetUndoDepth(), editor.GetRedoDepth(),
+                  editor.IsDirty() ? "  UNSAVED" : "");
+    out.status = statusText;
+}
+
+void RenderEditor(SDL_Renderer* renderer, const EditorView& view, float scrollSpeed, const RenderConfig& config,
+                  RenderCache* cache) {
+    // 编辑画面：轨道底层、网格线、音符与长条，最后画状态与按键提示
+    int keyCount = std::max(1, view.keyCount);
+    if (cache) {
+        cache->layers.DrawPlayfield(renderer, config, keyCount);
+    } else {
+        DrawPlayfieldBase(renderer, config, keyCount);
+    }
+    float laneWidth = static_cast<float>(config.playWidth) / static_cast<float>(keyCount);
+    float noteWidth = laneWidth - config.lanePadding * 2 - 8;
+    float judgeY = static_cast<float>(config.judgeLineY);
+    float pixelsPerMs = std::max(scrollSpeed, 0.01f);
+    auto yOf = [&](int timeMs) { return judgeY - static_cast<float>(timeMs - view.cursorMs) * pixelsPerMs; };
+
+    // 网格线：整拍线较亮较粗
+    SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
+    for (size_t i = 0; i < view.gridTimes.size(); ++i) {
+        bool beat = view.gridBeats[i] != 0;
+        int y = static_cast<int>(yOf(view.gridTimes[i]));
+        if (beat) {
+            SDL_SetRenderDrawColor(renderer, 210, 210, 225, 150);
+        } else {
+            SDL_SetRenderDrawColor(renderer, 120, 120, 150, 90);
+        }
+        SDL_Rect line{config.offsetX, y - (beat ? 1 : 0), config.playWidth, beat ? 2 : 1};
+        SDL_RenderFillRect(renderer, &line);
+    }
+
+    // 音符：长条身从头画到尾，不在判定线处截断；没有皮肤纹理时画纯色矩形
+    bool batched = cache && cache->sprites.Begin(renderer);
+    const SDL_Color white{255, 255, 255, 255};
+    float noteHeight = static_cast<float>(config.noteHeight);
+    float headHeight = noteHeight;
+    float tailHeight = 0.0f;
+    if (batched) {
+        const Skin& skin = *cache->sprites.GetSkin();
+        noteHeight = SpriteHeight(skin, SkinSprite::Note, noteWidth, config);
+        headHeight = SpriteHeight(skin, SkinSprite::HoldHead, noteWidth, config);
+        tailHeight = skin.Has(SkinSprite::HoldTail) ? SpriteHeight(skin, SkinSprite::HoldTail, noteWidth, config)
+                                                    : 0.0f;
+    }
+    auto addRect = [&](SkinSprite sprite, const SDL_FRect& rect, SDL_Color flatColor) {
+        if (batched) {
+            cache->sprites.Add(sprite, rect, white);
+            return;
+        }
+        SDL_SetRenderDrawColor(renderer, flatColor.r, flatColor.g, flatColor.b, flatColor.a);
+        SDL_RenderFillRectF(renderer, &rect);
+    };
+    const SDL_Color noteColor{245, 180, 70, 255};
+    const SDL_Color bodyColor{245, 180, 70, 140};
+    for (int lane = 0; lane < keyCount; ++lane) {
+        float x = config.offsetX + lane * laneWidth + config.lanePadding + 4;
+        for (uint32_t i = view.laneStart[lane]; i < view.laneStart[lane + 1]; ++i) {
+            float y = yOf(view.noteTimes[i]);
+            if (view.noteEndTimes[i] > view.noteTimes[i]) {
+                float tailY = yOf(view.noteEndTimes[i]);
+                addRect(SkinSprite::HoldBody, SDL_FRect{x, tailY, noteWidth, y - tailY}, bodyColor);
+                if (tailHeight > 0.0f) {
+                    addRect(SkinSprite::HoldTail, SDL_FRect{x, tailY - tailHeight, noteWidth, tailHeight}, bodyColor);
+                }
+                addRect(SkinSprite::HoldHead, SDL_FRect{x, y - headHeight, noteWidth, headHeight}, noteColor);
+            } else {
+                addRect(SkinSprite::Note, SDL_FRect{x, y - noteHeight, noteWidth, noteHeight}, noteColor);
+            }
+        }
+    }
+    if (batched) {
+        cache->sprites.Flush(renderer);
+    }
+
+    SDL_Color textColor{240, 240, 240, 255};
+    SDL_Color hintColor{150, 150, 170, 255};
+    DrawText(renderer, config.offsetX + 16, 16, 2, textColor, view.status);
+    if (!view.message.empty()) {
+        DrawText(renderer, config.offsetX + 16, 40, 2, SDL_Color{240, 200, 80, 255}, view.message);
+    }
+    int hintY = config.playHeight - 48;
+    DrawText(renderer, config.offsetX + 16, hintY, 2, hintColor, "UP/DOWN: GRID  PGUP/PGDN: MEASURE  LEFT/RIGHT: 1/N");
+    DrawText(renderer, config.offsetX + 16, hintY + 22, 2, hintColor,
+             "LANE KEY: NOTE  HOLD + MOVE: LONG  CTRL Z/Y: UNDO/REDO  CTRL S: SAVE");
+}
+
+void RenderMenu(SDL_Renderer* renderer, const RenderConfig& config, const MenuView& view, RenderCache* cache) {
+    // 菜单渲染（只拿到可见行，条目数不影响每帧开销；标题与固定提示来自缓存的底层）
+    if (cache) {
+        cache->layers.DrawMenu(renderer, config);
+    } else {
+        DrawMenuBase(renderer);
+    }
+
+    if (!view.status.empty()) {
+        SDL_Color statusColor{240, 200, 80, 255};
+        int statusWidth = static_cast<int>(view.status.size()) * 12;
+        DrawText(renderer, config.windowWidth - statusWidth - 24, 30, 2, statusColor, view.status);
+    }
 
     SDL_Color hintColor{180, 180, 180, 255};
-    DrawText(renderer, 24, 60, 2, hintColor, "UP/DOWN: SELECT  ENTER: PLAY");
-    DrawText(renderer, 24, 82, 2, hintColor, "CTRL +/-: SPEED  F5: RESOLUTION  ESC: QUIT");
-    DrawText(renderer, 24, 104, 2, hintColor, "KEYS 4K DFJK  5K DF SPACE JK  6K SDF JKL  7K SDF SPACE JKL");
+    DrawText(renderer, 24, config.windowHeight - 30, 2, hintColor, view.footer + "  F5: RESOLUTION");
 
-    if (items.empty()) {
+    char countText[32];
+    std::snprintf(countText, sizeof(countText), "%d / %d", view.totalRows, view.libraryCount);
+    int countWidth = static_cast<int>(std::string(countText).size()) * 12;
+    SDL_Color searchColor{120, 200, 240, 255};
+    if (view.query.empty()) {
+        DrawText(renderer, 24, 132, 2, hintColor, "TYPE TO SEARCH  ESC: QUIT  F7/F8: RATE  F10: PITCH");
+    } else {
+        DrawText(renderer, 24, 132, 2, searchColor, "SEARCH: " + view.query);
+        SDL_Rect caret{24 + static_cast<int>(view.query.size() + 8) * 12, 132, 10, 14};
+        SDL_RenderFillRect(renderer, &caret);
+    }
+    DrawText(renderer, config.windowWidth - countWidth - 24, 132, 2, hintColor, countText);
+
+    if (view.totalRows == 0) {
         SDL_Color warnColor{220, 120, 120, 255};
-        DrawText(renderer, 24, 80, 2, warnColor, "NO OSU FILES FOUND");
+        DrawText(renderer, 40, 164, 2, warnColor, view.libraryCount == 0 ? "NO OSU FILES FOUND" : "NO MATCHES");
         return;
     }
 
-    int startY = 140;
-    for (int i = 0; i < static_cast<int>(items.size()); ++i) {
-        SDL_Color color = (i == selectedIndex) ? SDL_Color{240, 200, 80, 255}
-                                                : SDL_Color{220, 220, 220, 255};
-        DrawText(renderer, 40, startY + i * 26, 2, color, items[i]);
+    int startY = 164;
+    int rows = MenuVisibleRows(config);
+    size_t maxChars = static_cast<size_t>(std::max(1, (config.windowWidth - 80) / 12));
+    for (size_t i = 0; i < view.rows.size(); ++i) {
+        int row = view.firstRow + static_cast<int>(i);
+        SDL_Color color = (row == view.selectedIndex) ? SDL_Color{240, 200, 80, 255}
+                                                       : SDL_Color{220, 220, 220, 255};
+        const std::string& label = view.rows[i];
+        int y = startY + static_cast<int>(i) * 26;
+        DrawText(renderer, 40, y, 2, color, label.size() > maxChars ? label.substr(0, maxChars) : label);
     }
 
+    // 滚动条：长度与位置按可见比例
+    if (view.totalRows > rows) {
+        int trackHeight = rows * 26;
+        int thumbHeight = std::max(12, trackHeight * rows / view.totalRows);
+        int thumbY = startY + (trackHeight - thumbHeight) * view.firstRow / (view.totalRows - rows);
+        SDL_SetRenderDrawColor(renderer, 50, 50, 60, 255);
+        SDL_Rect track{config.windowWidth - 16, startY, 6, trackHeight};
+        SDL_RenderFillRect(renderer, &track);
+        SDL_SetRenderDrawColor(renderer, 150, 150, 170, 255);
+        SDL_Rect thumb{config.windowWidth - 16, thumbY, 6, thumbHeight};
+        SDL_RenderFillRect(renderer, &thumb);
+    }
+}
+
+int MenuVisibleRows(const RenderConfig& config) {
+    return std::max(1, (config.windowHeight - 164 - 44) / 26);
 }
 
 void RenderPauseMenu(SDL_Renderer* renderer, const RenderConfig& config, int selectedIndex) {
@@ -297,3 +889,198 @@ void RenderCountdown(SDL_Renderer* renderer, const RenderConfig& config, int num
     int y = config.windowHeight / 2 - (7 * scale) / 2;
     DrawText(renderer, x, y, scale, color, text);
 }
+
+void RenderCalibrationResult(SDL_Renderer* renderer, const RenderConfig& config,
+                             const CalibrationResult& result, double currentOffsetMs) {
+    // 校准结果：当前偏移、推荐偏移与置信区间
+    SDL_SetRenderDrawColor(renderer, 14, 14, 20, 255);
+    SDL_RenderClear(renderer);
+
+    SDL_Color titleColor{235, 225, 210, 255};
+    SDL_Color textColor{220, 220, 220, 255};
+    SDL_Color hintColor{180, 180, 180, 255};
+    int x = config.windowWidth / 2 - 220;
+    int y = config.windowHeight / 2 - 110;
+    DrawText(renderer, x, y, 3, titleColor, "OFFSET CALIBRATION");
+
+    char line[96];
+    std::snprintf(line, sizeof(line), "HITS %d  STDDEV %.1fMS", result.samples, result.stdDevMs);
+    DrawText(renderer, x, y + 50, 2, textColor, line);
+    std::snprintf(line, sizeof(line), "CURRENT OFFSET %+.0fMS", currentOffsetMs);
+    DrawText(renderer, x, y + 76, 2, textColor, line);
+
+    if (result.valid) {
+        std::snprintf(line, sizeof(line), "RECOMMENDED %+.1fMS", currentOffsetMs + result.meanMs);
+        DrawText(renderer, x, y + 110, 2, JudgeColor(JudgeGrade::Perfect), line);
+        std::snprintf(line, sizeof(line), "95%% RANGE %+.1f TO %+.1fMS",
+                      currentOffsetMs + result.lowMs, currentOffsetMs + result.highMs);
+        DrawText(renderer, x, y + 136, 2, textColor, line);
+        DrawText(renderer, x, y + 180, 2, hintColor, "ENTER: APPLY  ESC: DISCARD");
+    } else {
+        DrawText(renderer, x, y + 110, 2, JudgeColor(JudgeGrade::Miss), "NOT ENOUGH HITS");
+        DrawText(renderer, x, y + 180, 2, hintColor, "ENTER/ESC: BACK");
+    }
+}
+
+ResultsView BuildResultsView(const Game& game, const RenderConfig& config) {
+    // 统计、偏差直方图、ACC曲线与分轨道明细
+    ResultsView view;
+    const GameStats& stats = game.GetStats();
+    const auto& records = game.GetHitRecords();
+    SDL_Color titleColor{235, 225, 210, 255};
+    SDL_Color textColor{220, 220, 220, 255};
+    SDL_Color hintColor{180, 180, 180, 255};
+    SDL_Color frameColor{90, 90, 100, 255};
+    SDL_Color perfectColor = JudgeColor(JudgeGrade::Perfect);
+    const JudgeTable& table = game.GetJudgeTable();
+
+    const Chart& chart = game.GetChart();
+    std::string title = chart.title.empty() ? std::string("RESULTS") : std::string(chart.title);
+    if (!chart.version.empty()) {
+        title += " - ";
+        title += chart.version;
+    }
+    AppendText(view, 40, 24, 3, titleColor, title);
+
+    char line[96];
+    int leftX = 40;
+    int y = 72;
+    if (game.GetRate() != 1.0) {
+        std::snprintf(line, sizeof(line), "SCORE %d  %.2fX", game.GetTotalScore(), game.GetRate());
+    } else {
+        std::snprintf(line, sizeof(line), "SCORE %d", game.GetTotalScore());
+    }
+    AppendText(view, leftX, y, 2, textColor, line);
+    std::snprintf(line, sizeof(line), "ACC %05.2f%%", game.GetAccuracy());
+    AppendText(view, leftX, y + 24, 2, textColor, line);
+    std::snprintf(line, sizeof(line), "MAX COMBO %d / %d", stats.maxCombo, stats.totalNotes);
+    AppendText(view, leftX, y + 48, 2, textColor, line);
+    // 判定数量分两列，每列三档
+    for (int i = 0; i < kJudgeGradeCount - 1; ++i) {
+        JudgeGrade grade = static_cast<JudgeGrade>(i + 1);
+        std::snprintf(line, sizeof(line), "%s %d", JudgeToString(grade).c_str(),
+                      stats.gradeCounts[static_cast<int>(grade)]);
+        AppendText(view, leftX + (i / 3) * 190, y + 78 + (i % 3) * 24, 2, JudgeColor(grade), line);
+    }
+    std::snprintf(line, sizeof(line), "UR %.1f  MEAN %+.1fMS", stats.hitError.UnstableRate(), stats.hitError.mean);
+    AppendText(view, leftX, y + 156, 2, textColor, line);
+
+    // 右侧上方：偏差直方图
+    float boxW = 390.0f;
+    float boxH = 130.0f;
+    float boxX = static_cast<float>(config.windowWidth) - boxW - 40.0f;
+    float histY = 96.0f;
+    AppendText(view, static_cast<int>(boxX), static_cast<int>(histY) - 16, 1, hintColor, "HIT ERROR");
+    AppendFrame(view, frameColor, boxX, histY, boxW, boxH);
+    AppendRect(view, frameColor, boxX + boxW / 2.0f, histY, 1.0f, boxH);
+    int maxBin = 1;
+    for (int count : stats.hitError.histogram) {
+        maxBin = std::max(maxBin, count);
+    }
+    float binW = (boxW - 2.0f) / kHitErrorBins;
+    for (int i = 0; i < kHitErrorBins; ++i) {
+        int count = stats.hitError.histogram[i];
+        if (count <= 0) {
+            continue;
+        }
+        float h = (boxH - 4.0f) * static_cast<float>(count) / static_cast<float>(maxBin);
+        int center = kHitErrorBins / 2;
+        int distance = i > center ? i - center : center - i;
+        SDL_Color color = JudgeColor(table.Classify(distance * stats.hitError.histogramRangeMs * 2 / kHitErrorBins));
+        AppendRect(view, color, boxX + 1.0f + i * binW, histY + boxH - 1.0f - h, std::max(1.0f, binW - 1.0f), h);
+    }
+    std::snprintf(line, sizeof(line), "-%dMS", stats.hitError.histogramRangeMs);
+    AppendText(view, static_cast<int>(boxX), static_cast<int>(histY + boxH) + 6, 1, hintColor, line);
+    std::snprintf(line, sizeof(line), "+%dMS", stats.hitError.histogramRangeMs);
+    AppendText(view, static_cast<int>(boxX + boxW) - static_cast<int>(std::string(line).size()) * 6,
+               static_cast<int>(histY + boxH) + 6, 1, hintColor, line);
+
+    // 右侧下方：ACC随时间变化（由游玩时记录的累计ACC分得出）
+    float graphY = histY + boxH + 44.0f;
+    AppendText(view, static_cast<int>(boxX), static_cast<int>(graphY) - 16, 1, hintColor, "ACCURACY OVER TIME");
+    AppendFrame(view, frameColor, boxX, graphY, boxW, boxH);
+    if (!records.empty()) {
+        double minAcc = 100.0;
+        for (size_t i = 0; i < records.size(); ++i) {
+            double acc = records[i].accuracyPoints / (static_cast<double>(i + 1) * table.maxAccuracyWeight) * 100.0;
+            minAcc = std::min(minAcc, acc);
+        }
+        minAcc = std::max(0.0, std::floor(minAcc / 5.0) * 5.0 - 5.0);
+        double span = std::max(1.0, 100.0 - minAcc);
+        int endMs = std::max(1, game.GetChartEndMs());
+        size_t step = std::max<size_t>(1, records.size() / 300);
+        LineStrip strip{perfectColor, {}};
+        strip.points.reserve(records.size() / step + 2);
+        for (size_t i = 0; i < records.size(); i += step) {
+            double acc = records[i].accuracyPoints / (static_cast<double>(i + 1) * table.maxAccuracyWeight) * 100.0;
+            float px = boxX + 1.0f + (boxW - 2.0f) * static_cast<float>(std::max(0, records[i].noteTimeMs)) / endMs;
+            float py = graphY + boxH - 2.0f - (boxH - 4.0f) * static_cast<float>((acc - minAcc) / span);
+            strip.points.push_back(SDL_FPoint{px, py});
+        }
+        view.lines.push_back(std::move(strip));
+        std::snprintf(line, sizeof(line), "%.0f%%", minAcc);
+        AppendText(view, static_cast<int>(boxX), static_cast<int>(graphY + boxH) + 6, 1, hintColor, line);
+    }
+
+    // 左侧下方：每轨道的判定分布与平均偏差
+    int keyCount = std::max(1, game.GetKeyCount());
+    float laneY = graphY;
+    float laneBoxW = boxW;
+    AppendText(view, leftX, static_cast<int>(laneY) - 16, 1, hintColor, "PER LANE");
+    AppendFrame(view, frameColor, static_cast<float>(leftX), laneY, laneBoxW, boxH);
+    std::vector<std::array<int, kJudgeGradeCount>> laneGrades(keyCount);
+    for (const auto& record : records) {
+        int lane = std::max(0, std::min(keyCount - 1, record.lane));
+        laneGrades[lane][static_cast<int>(record.grade)] += 1;
+    }
+    float columnW = (laneBoxW - 2.0f) / keyCount;
+    for (int lane = 0; lane < keyCount; ++lane) {
+        int total = 0;
+        for (int count : laneGrades[lane]) {
+            total += count;
+        }
+        if (total <= 0) {
+            continue;
+        }
+        // 从下往上按判定等级堆叠
+        float x = leftX + 1.0f + lane * columnW + 2.0f;
+        float w = std::max(1.0f, columnW - 4.0f);
+        float bottom = laneY + boxH - 1.0f;
+        float fullH = boxH - 4.0f;
+        for (int g = 1; g < kJudgeGradeCount; ++g) {
+            float h = fullH * laneGrades[lane][g] / total;
+            if (h <= 0.0f) {
+                continue;
+            }
+            bottom -= h;
+            AppendRect(view, JudgeColor(static_cast<JudgeGrade>(g)), x, bottom, w, h);
+        }
+        if (columnW >= 30.0f && lane < kMaxLanes) {
+            std::snprintf(line, sizeof(line), "%+.0f", stats.hitError.laneMean[lane]);
+            AppendText(view, static_cast<int>(x), static_cast<int>(laneY + boxH) + 6, 1, hintColor, line);
+        }
+    }
+
+    AppendText(view, leftX, config.windowHeight - 40, 2, hintColor, "ENTER: BACK TO MENU");
+    return view;
+}
+
+void RenderResults(SDL_Renderer* renderer, const ResultsView& view) {
+    // 结算画面
+    SDL_SetRenderDrawColor(renderer, 14, 14, 20, 255);
+    SDL_RenderClear(renderer);
+    for (const auto& batch : view.batches) {
+        if (batch.rects.empty()) {
+            continue;
+        }
+        SDL_SetRenderDrawColor(renderer, batch.color.r, batch.color.g, batch.color.b, batch.color.a);
+        SDL_RenderFillRectsF(renderer, batch.rects.data(), static_cast<int>(batch.rects.size()));
+    }
+    for (const auto& strip : view.lines) {
+        if (strip.points.size() < 2) {
+            continue;
+        }
+        SDL_SetRenderDrawColor(renderer, strip.color.r, strip.color.g, strip.color.b, strip.color.a);
+        SDL_RenderDrawLinesF(renderer, strip.points.data(), static_cast<int>(strip.points.size()));
+    }
+}
@@ -2,10 +2,17 @@
 
 #include <SDL.h>
 
+#include <array>
+#include <cstdint>
+#include <memory>
 #include <string>
 #include <vector>
 
+#include "Calibration.h"
+#include "ChartEditor.h"
 #include "Game.h"
+#include "HitEffects.h"
+#include "Skin.h"
 
 struct RenderConfig {
     // 窗口与游玩区域布局
@@ -19,16 +26,186 @@ struct RenderConfig {
     int lanePadding = 2;
 };
 
-// 渲染游玩界面
-void RenderFrame(SDL_Renderer* renderer, const Game& game, int nowMs, float scrollSpeed,
-                 const RenderConfig& config, bool showStartOverlay);
+class StaticLayers {
+public:
+    // 不随帧变化的底层（游玩区的背景、轨道与判定线；菜单的背景、标题与固定提示）缓存在目标纹理里，
+    // 只在布局或键数变化时重绘；渲染器不支持目标纹理时每帧直接绘制
+    StaticLayers() = default;
+    StaticLayers(const StaticLayers&) = delete;
+    StaticLayers& operator=(const StaticLayers&) = delete;
+
+    void DrawPlayfield(SDL_Renderer* renderer, const RenderConfig& config, int keyCount);
+    void DrawMenu(SDL_Renderer* renderer, const RenderConfig& config);
+    // 渲染目标或设备重置后销毁纹理，下次使用时重新创建并重绘
+    void Invalidate();
+    // 纹理属于渲染器，必须在销毁渲染器之前释放
+    void Release() { Invalidate(); }
+
+private:
+    struct Layer {
+        SDL_Texture* texture = nullptr;
+        int width = 0;
+        int height = 0;
+        // 上次绘制时的布局，任一项变化即重绘
+        RenderConfig config;
+        int keyCount = 0;
+        bool valid = false;
+    };
+
+    bool Prepare(Layer& layer, SDL_Renderer* renderer, const RenderConfig& config, int keyCount);
+
+    Layer playfield_;
+    Layer menu_;
+};
+
+class SpriteBatch {
+public:
+    // 皮肤图集纹理与每帧复用的顶点缓冲：一帧的按键、音符、长条与判定图累积后一次SDL_RenderGeometry提交
+    SpriteBatch() = default;
+    SpriteBatch(const SpriteBatch&) = delete;
+    SpriteBatch& operator=(const SpriteBatch&) = delete;
+
+    void SetSkin(std::shared_ptr<const Skin> skin) { skin_ = std::move(skin); }
+    const Skin* GetSkin() const { return skin_.get(); }
+    // 在当前渲染器上准备图集纹理并清空批次；没有皮肤或纹理创建失败时返回false
+    bool Begin(SDL_Renderer* renderer);
+    void Add(SkinSprite sprite, const SDL_FRect& dst, SDL_Color tint) { AddGradient(sprite, dst, tint, tint); }
+    // 上下两条边分别染色（光柱从判定线向上渐隐）
+    void AddGradient(SkinSprite sprite, const SDL_FRect& dst, SDL_Color top, SDL_Color bottom);
+    void Flush(SDL_Renderer* renderer);
+    // 设备重置后纹理失效，下次Begin时重新上传
+    void Invalidate();
+    void Release() { Invalidate(); }
+
+private:
+    std::shared_ptr<const Skin> skin_;
+    SDL_Texture* texture_ = nullptr;
+    std::vector<SDL_Vertex> vertices_;
+    std::vector<int> indices_;
+};
+
+struct RenderCache {
+    // 渲染线程独占的资源：静态底层与皮肤批次（都要在销毁渲染器之前Release），以及击中特效
+    StaticLayers layers;
+    SpriteBatch sprites;
+    HitEffects effects;
+
+    void Invalidate() {
+        layers.Invalidate();
+        sprites.Invalidate();
+    }
+    void Release() {
+        layers.Release();
+        sprites.Release();
+    }
+};
+
+struct RectBatch {
+    // 同色矩形批次（文本像素也拆成矩形预先存好）
+    SDL_Color color{255, 255, 255, 255};
+    std::vector<SDL_FRect> rects;
+};
+
+struct LineStrip {
+    // 同色折线
+    SDL_Color color{255, 255, 255, 255};
+    std::vector<SDL_FPoint> points;
+};
+
+struct ResultsView {
+    // 结算画面：进入时一次性生成，逐帧只提交缓冲
+    std::vector<RectBatch> batches;
+    std::vector<LineStrip> lines;
+};
+
+struct PlayfieldView {
+    // 游玩画面所需的全部状态：游戏线程生成，渲染线程只读，不再回头访问Game
+    int keyCount = 4;
+    double rate = 1.0;
+    // 屏幕内（含少量余量）尚未判定的音符时间与结束时间（单键两者相同），按轨道连续存放
+    std::vector<int> noteTimes;
+    std::vector<int> noteEndTimes;
+    std::array<uint32_t, kMaxLanes + 1> laneStart{};
+    // 已判定但仍未结束的长条的结束时间（没有时为INT_MIN），长条身从判定线画起
+    std::array<int, kMaxLanes> activeHoldEndMs{};
+    // 按住的轨道（按位）
+    uint32_t pressedLanes = 0;
+    // 最近的判定事件及最后一个事件之后的序号，特效据此只生成新事件的粒子
+    std::vector<JudgeEvent> judgeEvents;
+    uint64_t judgeEventEnd = 0;
+    int score = 0;
+    int combo = 0;
+    double accuracy = 100.0;
+    double unstableRate = 0.0;
+    JudgeGrade lastJudge = JudgeGrade::None;
+    int lastJudgeTimeMs = 0;
+    int histogramRangeMs = 1;
+    // 偏差条上显示的最近几次判定
+    std::vector<HitRecord> recentHits;
+};
+
+struct MenuView {
+    // 菜单画面：只含当前可见的行，条目总数只用于计数与滚动条
+    std::vector<std::string> rows;
+    int firstRow = 0;
+    int selectedIndex = 0;
+    int totalRows = 0;
+    int libraryCount = 0;
+    std::string query;
+    // 底部状态行与右上角状态
+    std::string footer;
+    std::string status;
+};
+
+struct EditorView {
+    // 编辑器画面：可见范围内的音符（按轨道连续存放）、网格线与状态文字，游标固定在判定线上
+    int keyCount = 4;
+    int cursorMs = 0;
+    std::vector<int> noteTimes;
+    std::vector<int> noteEndTimes;
+    std::array<uint32_t, kMaxLanes + 1> laneStart{};
+    std::vector<int> gridTimes;
+    // 1为整拍线，0为细分线
+    std::vector<uint8_t> gridBeats;
+    std::string status;
+    std::string message;
+    // 生成时逐轨道查询的临时缓冲
+    std::vector<EditNote> scratch;
+};
+
+// 从游戏状态生成游玩画面（复用out的容量，稳定后不分配内存）
+void BuildPlayfieldView(const Game& game, int nowMs, float scrollSpeed, const RenderConfig& config,
+                        PlayfieldView& out);
+
+// 渲染游玩界面（cache为空时静态底层逐帧绘制，音符画成纯色矩形，没有击中特效）
+void RenderFrame(SDL_Renderer* renderer, const PlayfieldView& view, int nowMs, float scrollSpeed,
+                 const RenderConfig& config, bool showStartOverlay, RenderCache* cache);
+
+// 从编辑器状态生成编辑画面（复用out的容量）
+void BuildEditorView(const ChartEditor& editor, float scrollSpeed, const RenderConfig& config, EditorView& out);
+
+// 渲染编辑器（长条不在判定线处截断，判定线以下也画出已过的音符）
+void RenderEditor(SDL_Renderer* renderer, const EditorView& view, float scrollSpeed, const RenderConfig& config,
+                  RenderCache* cache);
 
 // 渲染谱面选择菜单
-void RenderMenu(SDL_Renderer* renderer, const RenderConfig& config,
-                const std::vector<std::string>& items, int selectedIndex);
+void RenderMenu(SDL_Renderer* renderer, const RenderConfig& config, const MenuView& view, RenderCache* cache);
+
+// 菜单列表一屏可显示的行数
+int MenuVisibleRows(const RenderConfig& config);
 
 // 渲染暂停菜单
 void RenderPauseMenu(SDL_Renderer* renderer, const RenderConfig& config, int selectedIndex);
 
 // 渲染倒计时数字
 void RenderCountdown(SDL_Renderer* renderer, const RenderConfig& config, int number);
+
+// 渲染偏移校准结果
+void RenderCalibrationResult(SDL_Renderer* renderer, const RenderConfig& config,
+                             const CalibrationResult& result, double currentOffsetMs);
+
+// 根据本局统计生成结算画面的绘制缓冲
+ResultsView BuildResultsView(const Game& game, const RenderConfig& config);
+
+// 渲染结算画面（只提交预先生成的缓冲）
+void RenderResults(SDL_Renderer* renderer, const ResultsView& view);
@@ -0,0 +1,166 @@
+#include "SearchIndex.h"
+
+#include <algorithm>
+
+#include "Profiler.h"
+
+namespace {
+uint32_t TrigramKey(const char* text) {
+    return (static_cast<uint32_t>(static_cast<unsigned char>(text[0])) << 16) |
+           (static_cast<uint32_t>(static_cast<unsigned char>(text[1])) << 8) |
+           static_cast<uint32_t>(static_cast<unsigned char>(text[2]));
+}
+
+// 依次取出空格分隔的词
+template <typename Callback>
+void ForEachWord(std::string_view text, Callback callback) {
+    size_t pos = 0;
+    while (pos < text.size()) {
+        while (pos < text.size() && text[pos] == ' ') {
+            ++pos;
+        }
+        size_t end = text.find(' ', pos);
+        if (end == std::string_view::npos) {
+            end = text.size();
+        }
+        if (end > pos) {
+            callback(text.substr(pos, end - pos));
+        }
+        pos = end;
+    }
+}
+
+void IntersectInto(std::vector<int>& result, const int* begin, const int* end, std::vector<int>& scratch) {
+    scratch.clear();
+    std::set_intersection(result.begin(), result.end(), begin, end, std::back_inserter(scratch));
+    result.swap(scratch);
+}
+}
+
+std::string NormalizeSearchText(std::string_view text) {
+    // ASCII字母转小写，其余非字母数字字符（含标点）视为分隔；UTF-8多字节字符原样保留
+    std::string result;
+    result.reserve(text.size());
+    for (char c : text) {
+        unsigned char u = static_cast<unsigned char>(c);
+        if (u >= 'A' && u <= 'Z') {
+            result.push_back(static_cast<char>(u - 'A' + 'a'));
+        } else if ((u >= 'a' && u <= 'z') || (u >= '0' && u <= '9') || u >= 0x80) {
+            result.push_back(c);
+        } else {
+            result.push_back(' ');
+        }
+    }
+    return result;
+}
+
+void ChartSearchIndex::Build(const std::vector<ChartEntry>& entries) {
+    PROFILE_ZONE("ChartSearchIndex::Build");
+    texts_.clear();
+    texts_.reserve(entries.size());
+    words_.clear();
+
+    std::vector<std::pair<uint32_t, int>> pairs;
+    for (size_t i = 0; i < entries.size(); ++i) {
+        const ChartEntry& entry = entries[i];
+        int id = static_cast<int>(i);
+        texts_.push_back(NormalizeSearchText(entry.label + " " + entry.title + " " + entry.artist + " " +
+                                             entry.version));
+        size_t firstPair = pairs.size();
+        ForEachWord(texts_.back(), [&](std::string_view word) {
+            words_.emplace_back(std::string(word), id);
+            for (size_t k = 0; k + 3 <= word.size(); ++k) {
+                pairs.emplace_back(TrigramKey(word.data() + k), id);
+            }
+        });
+        // 同一条目内重复的trigram只保留一次
+        std::sort(pairs.begin() + firstPair, pairs.end());
+        pairs.erase(std::unique(pairs.begin() + firstPair, pairs.end()), pairs.end());
+    }
+
+    std::sort(words_.begin(), words_.end());
+    words_.erase(std::unique(words_.begin(), words_.end()), words_.end());
+
+    // 条目按下标顺序加入，排序后每个trigram的条目列表自然升序
+    std::stable_sort(pairs.begin(), pairs.end(),
+                     [](const auto& a, const auto& b) { return a.first < b.first; });
+    trigramKeys_.clear();
+    trigramOffsets_.clear();
+    trigramPostings_.clear();
+    trigramPostings_.reserve(pairs.size());
+    for (size_t i = 0; i < pairs.size(); ++i) {
+        if (i == 0 || pairs[i].first != pairs[i - 1].first) {
+            trigramKeys_.push_back(pairs[i].first);
+            trigramOffsets_.push_back(static_cast<uint32_t>(trigramPostings_.size()));
+        }
+        trigramPostings_.push_back(pairs[i].second);
+    }
+    trigramOffsets_.push_back(static_cast<uint32_t>(trigramPostings_.size()));
+}
+
+void ChartSearchIndex::Query(std::string_view query, std::vector<int>& out) const {
+    // 各关键词结果取交集，任一关键词无结果即提前返回
+    out.clear();
+    std::string normalized = NormalizeSearchText(query);
+    std::vector<int> wordResult;
+    std::vector<int> scratch;
+    bool first = true;
+    bool empty = false;
+    ForEachWord(normalized, [&](std::string_view word) {
+        if (empty) {
+            return;
+        }
+        QueryWord(word, wordResult);
+        if (first) {
+            out.swap(wordResult);
+            first = false;
+        } else {
+            IntersectInto(out, wordResult.data(), wordResult.data() + wordResult.size(), scratch);
+        }
+        empty = out.empty();
+    });
+}
+
+void ChartSearchIndex::QueryWord(std::string_view word, std::vector<int>& out) const {
+    out.clear();
+    if (word.size() < 3) {
+        // 短词：在排序后的词表里取前缀范围
+        auto it = std::lower_bound(words_.begin(), words_.end(), word,
+                                   [](const auto& entry, std::string_view value) { return entry.first < value; });
+        for (; it != words_.end() && it->first.compare(0, word.size(), word) == 0; ++it) {
+            out.push_back(it->second);
+        }
+        std::sort(out.begin(), out.end());
+        out.erase(std::unique(out.begin(), out.end()), out.end());
+        return;
+    }
+
+    // 长词：从最短的trigram列表开始求交，最后逐条确认子串（trigram只保证必要条件）
+    struct Range {
+        uint32_t begin;
+        uint32_t end;
+    };
+    std::vector<Range> ranges;
+    ranges.reserve(word.size() - 2);
+    for (size_t k = 0; k + 3 <= word.size(); ++k) {
+        uint32_t key = TrigramKey(word.data() + k);
+        auto it = std::lower_bound(trigramKeys_.begin(), trigramKeys_.end(), key);
+        if (it == trigramKeys_.end() || *it != key) {
+            return;
+        }
+        size_t index = static_cast<size_t>(it - trigramKeys_.begin());
+        ranges.push_back(Range{trigramOffsets_[index], trigramOffsets_[index + 1]});
+    }
+    std::sort(ranges.begin(), ranges.end(),
+              [](const Range& a, const Range& b) { return a.end - a.begin < b.end - b.begin; });
+
+    out.assign(trigramPostings_.begin() + ranges[0].begin, trigramPostings_.begin() + ranges[0].end);
+    std::vector<int> scratch;
+    for (size_t r = 1; r < ranges.size() && !out.empty(); ++r) {
+        IntersectInto(out, trigramPostings_.data() + ranges[r].begin, trigramPostings_.data() + ranges[r].end,
+                      scratch);
+    }
+    out.erase(std::remove_if(out.begin(), out.end(),
+                             [&](int id) { return texts_[id].find(word) == std::string::npos; }),
+              out.end());
+}
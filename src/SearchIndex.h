@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "Library.h"
+
+class ChartSearchIndex {
+public:
+    // 对标题、艺术家、难度名建立索引：3字符以上按子串（trigram倒排），1~2字符按词首
+    void Build(const std::vector<ChartEntry>& entries);
+    // 返回同时匹配所有关键词的条目下标（升序），大小写不敏感
+    void Query(std::string_view query, std::vector<int>& out) const;
+    size_t Size() const { return texts_.size(); }
+
+private:
+    void QueryWord(std::string_view word, std::vector<int>& out) const;
+
+    // 归一化后的检索文本（小写，非字母数字替换为空格）
+    std::vector<std::string> texts_;
+    // trigram倒排表（CSR）：keys_排序，postings_[offsets_[i], offsets_[i+1])为对应条目
+    std::vector<uint32_t> trigramKeys_;
+    std::vector<uint32_t> trigramOffsets_;
+    std::vector<int> trigramPostings_;
+    // 按字典序排序的(词, 条目)，用于短前缀查询
+    std::vector<std::pair<std::string, int>> words_;
+};
+
+// 查询字符串与检索文本使用相同的归一化
+std::string NormalizeSearchText(std::string_view text);
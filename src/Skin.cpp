@@ -0,0 +1,159 @@
+#include "Skin.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+namespace {
+using SurfacePtr = std::unique_ptr<SDL_Surface, SurfaceDeleter>;
+
+// 每张图四周复制的边缘像素
+constexpr int kPadding = 1;
+
+const char* kSpriteFiles[kSkinSpriteCount] = {
+    "note.bmp", "hold_head.bmp", "hold_body.bmp", "hold_tail.bmp", "key.bmp", "beam.bmp", "particle.bmp",
+    "judge_max.bmp", "judge_perfect.bmp", "judge_great.bmp", "judge_good.bmp", "judge_bad.bmp", "judge_miss.bmp"};
+
+int Index(SkinSprite sprite) {
+    return static_cast<int>(sprite);
+}
+
+SurfacePtr LoadSprite(const std::string& path) {
+    // 统一转成ARGB8888；不带透明通道的图先把品红设为透明色，转换时变为alpha 0
+    SurfacePtr loaded(SDL_LoadBMP(path.c_str()));
+    if (!loaded) {
+        return nullptr;
+    }
+    if (loaded->format->Amask == 0) {
+        SDL_SetColorKey(loaded.get(), SDL_TRUE, SDL_MapRGB(loaded->format, 255, 0, 255));
+    }
+    return SurfacePtr(SDL_ConvertSurfaceFormat(loaded.get(), SDL_PIXELFORMAT_ARGB8888, 0));
+}
+
+SurfacePtr SolidSprite(int width, int height, uint32_t argb) {
+    SurfacePtr surface(SDL_CreateRGBSurfaceWithFormat(0, width, height, 32, SDL_PIXELFORMAT_ARGB8888));
+    if (surface) {
+        for (int y = 0; y < height; ++y) {
+            uint32_t* row = reinterpret_cast<uint32_t*>(static_cast<unsigned char*>(surface->pixels) + y * surface->pitch);
+            std::fill(row, row + width, argb);
+        }
+    }
+    return surface;
+}
+
+int NextPowerOfTwo(int value) {
+    int result = 1;
+    while (result < value) {
+        result <<= 1;
+    }
+    return result;
+}
+
+bool PackAtlas(const std::array<SurfacePtr, kSkinSpriteCount>& images, Skin& out, std::string& error) {
+    // 按高度从高到低逐行排放（shelf），宽度取最宽图与总面积平方根的较大者，宽高都取2的幂
+    std::vector<int> order;
+    int area = 0;
+    int maxWidth = 1;
+    for (int i = 0; i < kSkinSpriteCount; ++i) {
+        if (images[i]) {
+            order.push_back(i);
+            area += (images[i]->w + kPadding * 2) * (images[i]->h + kPadding * 2);
+            maxWidth = std::max(maxWidth, images[i]->w + kPadding * 2);
+        }
+    }
+    std::stable_sort(order.begin(), order.end(), [&](int a, int b) { return images[a]->h > images[b]->h; });
+    int width = NextPowerOfTwo(std::max(maxWidth, static_cast<int>(std::ceil(std::sqrt(static_cast<double>(area))))));
+
+    std::array<SDL_Point, kSkinSpriteCount> positions{};
+    int x = 0;
+    int y = 0;
+    int rowHeight = 0;
+    for (int index : order) {
+        int paddedWidth = images[index]->w + kPadding * 2;
+        int paddedHeight = images[index]->h + kPadding * 2;
+        if (x + paddedWidth > width) {
+            x = 0;
+            y += rowHeight;
+            rowHeight = 0;
+        }
+        positions[index] = SDL_Point{x, y};
+        x += paddedWidth;
+        rowHeight = std::max(rowHeight, paddedHeight);
+    }
+    int height = NextPowerOfTwo(std::max(1, y + rowHeight));
+
+    out.atlas.reset(SDL_CreateRGBSurfaceWithFormat(0, width, height, 32, SDL_PIXELFORMAT_ARGB8888));
+    if (!out.atlas) {
+        error = std::string("Failed to create skin atlas: ") + SDL_GetError();
+        return false;
+    }
+    SDL_Surface* atlas = out.atlas.get();
+    for (int index : order) {
+        const SDL_Surface* image = images[index].get();
+        SDL_Point origin = positions[index];
+        // 超出图片范围的一圈取最近的边缘像素
+        for (int dy = -kPadding; dy < image->h + kPadding; ++dy) {
+            int sy = std::clamp(dy, 0, image->h - 1);
+            const uint32_t* src = reinterpret_cast<const uint32_t*>(
+                static_cast<const unsigned char*>(image->pixels) + sy * image->pitch);
+            uint32_t* dst = reinterpret_cast<uint32_t*>(
+                static_cast<unsigned char*>(atlas->pixels) + (origin.y + kPadding + dy) * atlas->pitch);
+            for (int dx = -kPadding; dx < image->w + kPadding; ++dx) {
+                dst[origin.x + kPadding + dx] = src[std::clamp(dx, 0, image->w - 1)];
+            }
+        }
+        out.sprites[index] = SDL_Rect{origin.x + kPadding, origin.y + kPadding, image->w, image->h};
+    }
+    return true;
+}
+}
+
+bool LoadSkin(const std::string& directory, Skin& out, std::string& error) {
+    std::array<SurfacePtr, kSkinSpriteCount> images;
+    for (int i = 0; i < kSkinSpriteCount; ++i) {
+        images[i] = LoadSprite(directory + "/" + kSpriteFiles[i]);
+    }
+    if (!images[Index(SkinSprite::Note)]) {
+        error = "Skin has no note.bmp: " + directory;
+        return false;
+    }
+    // 光柱与粒子按判定颜色染色，缺少时用白色方块
+    for (SkinSprite sprite : {SkinSprite::Beam, SkinSprite::Particle}) {
+        if (!images[Index(sprite)]) {
+            images[Index(sprite)] = SolidSprite(4, 4, 0xFFFFFFFFu);
+        }
+    }
+    Skin skin;
+    if (!PackAtlas(images, skin, error)) {
+        return false;
+    }
+    // 缺少长条头与长条身时沿用音符图，缺少长条尾时不画
+    if (!images[Index(SkinSprite::HoldHead)]) {
+        skin.sprites[Index(SkinSprite::HoldHead)] = skin.Sprite(SkinSprite::Note);
+    }
+    if (!images[Index(SkinSprite::HoldBody)]) {
+        skin.sprites[Index(SkinSprite::HoldBody)] = skin.Sprite(SkinSprite::Note);
+    }
+    out = std::move(skin);
+    return true;
+}
+
+Skin BuildDefaultSkin() {
+    // 与原先的纯色绘制一致：橙色音符，长条身半透明，按键区为暗灰
+    std::array<SurfacePtr, kSkinSpriteCount> images;
+    images[Index(SkinSprite::Note)] = SolidSprite(4, 4, 0xFFF5B446u);
+    images[Index(SkinSprite::HoldBody)] = SolidSprite(4, 4, 0x96F5B446u);
+    images[Index(SkinSprite::Key)] = SolidSprite(4, 4, 0xFF282834u);
+    images[Index(SkinSprite::Beam)] = SolidSprite(4, 4, 0xFFFFFFFFu);
+    images[Index(SkinSprite::Particle)] = SolidSprite(4, 4, 0xFFFFFFFFu);
+    Skin skin;
+    std::string error;
+    if (!PackAtlas(images, skin, error)) {
+        return skin;
+    }
+    skin.sprites[Index(SkinSprite::HoldHead)] = skin.Sprite(SkinSprite::Note);
+    skin.sprites[Index(SkinSprite::HoldTail)] = skin.Sprite(SkinSprite::Note);
+    skin.keepNoteHeight = true;
+    return skin;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <SDL.h>
+
+#include <array>
+#include <memory>
+#include <string>
+
+enum class SkinSprite {
+    Note,
+    HoldHead,
+    HoldBody,
+    HoldTail,
+    Key,
+    Beam,
+    Particle,
+    JudgeMax,
+    JudgePerfect,
+    JudgeGreat,
+    JudgeGood,
+    JudgeBad,
+    JudgeMiss
+};
+
+constexpr int kSkinSpriteCount = 13;
+
+struct SurfaceDeleter {
+    void operator()(SDL_Surface* surface) const { SDL_FreeSurface(surface); }
+};
+
+struct Skin {
+    // 所有皮肤图片打进一张ARGB图集（每张图四周复制1像素边缘，拉伸时不会采到邻图）；
+    // 载入后只读，游戏线程与渲染线程共享
+    std::unique_ptr<SDL_Surface, SurfaceDeleter> atlas;
+    // 各图在图集中的位置，w为0表示皮肤没有这张图（判定图缺失时回退为文字）
+    std::array<SDL_Rect, kSkinSpriteCount> sprites{};
+    // 内置皮肤沿用配置的音符高度，外部皮肤按音符图的宽高比缩放
+    bool keepNoteHeight = false;
+
+    const SDL_Rect& Sprite(SkinSprite sprite) const { return sprites[static_cast<int>(sprite)]; }
+    bool Has(SkinSprite sprite) const { return Sprite(sprite).w > 0; }
+};
+
+// 从目录读取note.bmp、hold_head.bmp、hold_body.bmp、hold_tail.bmp、key.bmp、beam.bmp、particle.bmp与judge_*.bmp并打包；
+// 无透明通道的图片以品红(255,0,255)为透明色。缺少note.bmp时返回false
+bool LoadSkin(const std::string& directory, Skin& out, std::string& error);
+
+// 内置皮肤：纯色音符、长条与按键，白色光柱与粒子，判定使用文字
+Skin BuildDefaultSkin();
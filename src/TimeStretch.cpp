@@ -0,0 +1,127 @@
+#include "TimeStretch.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+constexpr double kPi = 3.14159265358979323846;
+
+// 取一帧的某个声道，越界返回0
+inline float SampleAt(const int16_t* source, size_t sourceFrames, int channels, long long frame, int channel) {
+    if (frame < 0 || static_cast<size_t>(frame) >= sourceFrames) {
+        return 0.0f;
+    }
+    return static_cast<float>(source[static_cast<size_t>(frame) * channels + channel]);
+}
+
+// 把[start, start+count)混成单声道
+void DownmixMono(const int16_t* source, size_t sourceFrames, int channels, long long start, int count, float* out) {
+    float scale = 1.0f / static_cast<float>(channels);
+    for (int i = 0; i < count; ++i) {
+        float sum = 0.0f;
+        for (int c = 0; c < channels; ++c) {
+            sum += SampleAt(source, sourceFrames, channels, start + i, c);
+        }
+        out[i] = sum * scale;
+    }
+}
+
+// 8路独立累加，编译器可直接映射到SIMD寄存器
+float Dot(const float* a, const float* b, int count) {
+    float acc[8] = {};
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        for (int j = 0; j < 8; ++j) {
+            acc[j] += a[i + j] * b[i + j];
+        }
+    }
+    float sum = (acc[0] + acc[1]) + (acc[2] + acc[3]) + (acc[4] + acc[5]) + (acc[6] + acc[7]);
+    for (; i < count; ++i) {
+        sum += a[i] * b[i];
+    }
+    return sum;
+}
+}
+
+void TimeStretch::Configure(int freq, int channels) {
+    channels_ = std::max(1, channels);
+    // 跳距取8的倍数，点积没有尾巴
+    hop_ = std::max(64, (freq / 200 + 7) / 8 * 8);
+    search_ = std::max(32, freq * 3 / 1000);
+    window_.resize(static_cast<size_t>(hop_) * 2);
+    for (int i = 0; i < hop_ * 2; ++i) {
+        // 周期汉宁窗：半窗重叠时两段权重之和恒为1
+        window_[i] = static_cast<float>(0.5 - 0.5 * std::cos(2.0 * kPi * i / (hop_ * 2)));
+    }
+    tail_.assign(static_cast<size_t>(hop_) * channels_, 0.0f);
+    output_.assign(static_cast<size_t>(hop_) * channels_, 0.0f);
+    template_.assign(static_cast<size_t>(hop_), 0.0f);
+    region_.assign(static_cast<size_t>(search_ * 2 + hop_ + 1), 0.0f);
+    Reset(0.0);
+}
+
+void TimeStretch::Reset(double sourceFrame) {
+    std::fill(tail_.begin(), tail_.end(), 0.0f);
+    outputPos_ = hop_;
+    nominal_ = sourceFrame;
+    hasPrevious_ = false;
+}
+
+void TimeStretch::Process(const int16_t* source, size_t sourceFrames, double rate, int16_t* out, size_t frames) {
+    size_t written = 0;
+    while (written < frames) {
+        if (outputPos_ >= hop_) {
+            NextHop(source, sourceFrames, rate);
+        }
+        size_t count = std::min(frames - written, static_cast<size_t>(hop_ - outputPos_));
+        const float* from = output_.data() + static_cast<size_t>(outputPos_) * channels_;
+        int16_t* to = out + written * channels_;
+        for (size_t i = 0; i < count * channels_; ++i) {
+            to[i] = static_cast<int16_t>(std::clamp(from[i], -32768.0f, 32767.0f));
+        }
+        outputPos_ += static_cast<int>(count);
+        written += count;
+    }
+}
+
+void TimeStretch::NextHop(const int16_t* source, size_t sourceFrames, double rate) {
+    long long nominal = static_cast<long long>(std::floor(nominal_ + 0.5));
+    long long start = nominal;
+    if (hasPrevious_) {
+        // 模板是上一段自然延续的那一段，新段的前半应与它对齐
+        DownmixMono(source, sourceFrames, channels_, previousStart_ + hop_, hop_, template_.data());
+        DownmixMono(source, sourceFrames, channels_, nominal - search_, search_ * 2 + hop_, region_.data());
+        start = nominal - search_ + BestOffset();
+    }
+    for (int i = 0; i < hop_; ++i) {
+        float rise = window_[i];
+        float fall = window_[hop_ + i];
+        for (int c = 0; c < channels_; ++c) {
+            size_t slot = static_cast<size_t>(i) * channels_ + c;
+            output_[slot] = tail_[slot] + rise * SampleAt(source, sourceFrames, channels_, start + i, c);
+            tail_[slot] = fall * SampleAt(source, sourceFrames, channels_, start + hop_ + i, c);
+        }
+    }
+    previousStart_ = start;
+    hasPrevious_ = true;
+    nominal_ += hop_ * rate;
+    outputPos_ = 0;
+}
+
+int TimeStretch::BestOffset() const {
+    // 候选段能量滑动更新，每个候选只剩一次点积
+    float energy = Dot(region_.data(), region_.data(), hop_);
+    int best = search_;
+    float bestScore = -1e30f;
+    for (int offset = 0; offset <= search_ * 2; ++offset) {
+        float score = Dot(template_.data(), region_.data() + offset, hop_) / std::sqrt(std::max(energy, 0.0f) + 1.0f);
+        if (score > bestScore) {
+            bestScore = score;
+            best = offset;
+        }
+        float leaving = region_[offset];
+        float entering = region_[offset + hop_];
+        energy += entering * entering - leaving * leaving;
+    }
+    return best;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class TimeStretch {
+public:
+    // WSOLA变速不变调：5ms跳距、10ms汉宁窗、±3ms内找与上一段最相似的位置拼接，
+    // 源数据可随机访问，因此只引入一个跳距的延迟
+    void Configure(int freq, int channels);
+    // 从源位置sourceFrame重新开始（定位、换曲或改速后调用），丢弃重叠缓冲
+    void Reset(double sourceFrame);
+    // 按rate写出frames帧交错S16；源共sourceFrames帧，越界部分按静音处理
+    void Process(const int16_t* source, size_t sourceFrames, double rate, int16_t* out, size_t frames);
+    // 当前位置之后还需要多少源帧才能生成下一段输出
+    size_t LookaheadFrames() const { return static_cast<size_t>(search_ + hop_ * 3); }
+
+private:
+    void NextHop(const int16_t* source, size_t sourceFrames, double rate);
+    // 在搜索区间里找与模板归一化互相关最大的偏移
+    int BestOffset() const;
+
+    int channels_ = 2;
+    int hop_ = 240;
+    int search_ = 144;
+    std::vector<float> window_;
+    // 上一段后半（已加窗），与下一段前半叠加
+    std::vector<float> tail_;
+    // 当前跳距的输出，outputPos_为已取走的帧数
+    std::vector<float> output_;
+    int outputPos_ = 0;
+    // 单声道的模板与搜索区间，供互相关使用
+    std::vector<float> template_;
+    std::vector<float> region_;
+    double nominal_ = 0.0;
+    long long previousStart_ = 0;
+    bool hasPrevious_ = false;
+};
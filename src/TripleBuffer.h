@@ -0,0 +1,38 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+
+template <typename T>
+class TripleBuffer {
+public:
+    // 单写单读的无锁三缓冲：写端与读端各占一个槽，中间槽通过一次原子交换传递，
+    // 双方都不会等待对方；槽会被反复复用，容器容量稳定后不再分配内存
+
+    // 写端：在返回的槽上原地填写，填完后Publish
+    T& WriteSlot() { return slots_[back_]; }
+    void Publish() {
+        int previous = middle_.exchange(back_ | kFresh, std::memory_order_acq_rel);
+        back_ = previous & kIndexMask;
+    }
+
+    // 读端：有新数据时换到最新的槽并返回true，否则保留上一次的槽
+    bool Acquire() {
+        if ((middle_.load(std::memory_order_relaxed) & kFresh) == 0) {
+            return false;
+        }
+        int previous = middle_.exchange(front_, std::memory_order_acq_rel);
+        front_ = previous & kIndexMask;
+        return true;
+    }
+    const T& ReadSlot() const { return slots_[front_]; }
+
+private:
+    static constexpr int kIndexMask = 3;
+    static constexpr int kFresh = 4;
+
+    std::array<T, 3> slots_;
+    int back_ = 0;
+    std::atomic<int> middle_{1};
+    int front_ = 2;
+};
@@ -0,0 +1,426 @@
+#include "VideoExport.h"
+
+#include <SDL.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#endif
+
+#include "Game.h"
+#include "Package.h"
+#include "Profiler.h"
+#include "Renderer.h"
+
+namespace {
+// 每个线程一批渲染的帧数
+constexpr int kFramesPerThreadBatch = 8;
+// 第一个音符之前与最后一个音符之后留出的时间
+constexpr int kLeadInMs = 2000;
+constexpr int kTailMs = 1500;
+
+struct FrameJob {
+    // 一帧的全部输入（游玩画面或结算画面）与编码后的输出
+    PlayfieldView view;
+    int nowMs = 0;
+    bool results = false;
+    std::vector<unsigned char> encoded;
+};
+
+struct WorkerContext {
+    // 每个线程独占一块画布与软件渲染器
+    SDL_Surface* surface = nullptr;
+    SDL_Renderer* renderer = nullptr;
+    RenderCache cache;
+};
+
+RenderConfig MakeExportConfig(const ExportOptions& options) {
+    RenderConfig config;
+    config.windowWidth = options.width;
+    config.windowHeight = options.height;
+    config.playWidth = std::min(900, options.width);
+    config.playHeight = options.height;
+    config.offsetX = (config.windowWidth - config.playWidth) / 2;
+    config.judgeLineY = config.playHeight - 80;
+    return config;
+}
+
+void PutBigEndian32(std::vector<unsigned char>& out, uint32_t value) {
+    out.push_back(static_cast<unsigned char>(value >> 24));
+    out.push_back(static_cast<unsigned char>(value >> 16));
+    out.push_back(static_cast<unsigned char>(value >> 8));
+    out.push_back(static_cast<unsigned char>(value));
+}
+
+void PutPngChunk(std::vector<unsigned char>& out, const char* type, const unsigned char* data, size_t size) {
+    PutBigEndian32(out, static_cast<uint32_t>(size));
+    size_t typeStart = out.size();
+    out.insert(out.end(), type, type + 4);
+    out.insert(out.end(), data, data + size);
+    PutBigEndian32(out, Crc32(0, out.data() + typeStart, size + 4));
+}
+
+inline void UnpackPixel(uint32_t pixel, int& r, int& g, int& b) {
+    r = static_cast<int>((pixel >> 16) & 0xFF);
+    g = static_cast<int>((pixel >> 8) & 0xFF);
+    b = static_cast<int>(pixel & 0xFF);
+}
+
+inline const uint32_t* SurfaceRow(const SDL_Surface* surface, int y) {
+    return reinterpret_cast<const uint32_t*>(static_cast<const unsigned char*>(surface->pixels) + y * surface->pitch);
+}
+
+void EncodeRaw(const SDL_Surface* surface, std::vector<unsigned char>& out) {
+    // RGB24逐行紧密排列
+    out.resize(static_cast<size_t>(surface->w) * surface->h * 3);
+    unsigned char* dst = out.data();
+    for (int y = 0; y < surface->h; ++y) {
+        const uint32_t* row = SurfaceRow(surface, y);
+        for (int x = 0; x < surface->w; ++x) {
+            int r, g, b;
+            UnpackPixel(row[x], r, g, b);
+            *dst++ = static_cast<unsigned char>(r);
+            *dst++ = static_cast<unsigned char>(g);
+            *dst++ = static_cast<unsigned char>(b);
+        }
+    }
+}
+
+void EncodeY4m(const SDL_Surface* surface, std::vector<unsigned char>& out) {
+    // 全范围BT.601，色度按2x2取平均（4:2:0）
+    int w = surface->w;
+    int h = surface->h;
+    static const char kFrameTag[] = "FRAME\n";
+    size_t lumaSize = static_cast<size_t>(w) * h;
+    size_t chromaSize = lumaSize / 4;
+    out.resize(sizeof(kFrameTag) - 1 + lumaSize + chromaSize * 2);
+    std::copy(kFrameTag, kFrameTag + sizeof(kFrameTag) - 1, out.begin());
+    unsigned char* luma = out.data() + sizeof(kFrameTag) - 1;
+    unsigned char* cb = luma + lumaSize;
+    unsigned char* cr = cb + chromaSize;
+    for (int y = 0; y < h; ++y) {
+        const uint32_t* row = SurfaceRow(surface, y);
+        for (int x = 0; x < w; ++x) {
+            int r, g, b;
+            UnpackPixel(row[x], r, g, b);
+            luma[static_cast<size_t>(y) * w + x] = static_cast<unsigned char>((77 * r + 150 * g + 29 * b + 128) >> 8);
+        }
+    }
+    for (int y = 0; y < h; y += 2) {
+        const uint32_t* top = SurfaceRow(surface, y);
+        const uint32_t* bottom = SurfaceRow(surface, y + 1);
+        for (int x = 0; x < w; x += 2) {
+            int sumR = 0, sumG = 0, sumB = 0;
+            for (uint32_t pixel : {top[x], top[x + 1], bottom[x], bottom[x + 1]}) {
+                int r, g, b;
+                UnpackPixel(pixel, r, g, b);
+                sumR += r;
+                sumG += g;
+                sumB += b;
+            }
+            size_t index = static_cast<size_t>(y / 2) * (w / 2) + x / 2;
+            cb[index] = static_cast<unsigned char>(std::clamp((-43 * sumR - 85 * sumG + 128 * sumB + 512) / 1024 + 128, 0, 255));
+            cr[index] = static_cast<unsigned char>(std::clamp((128 * sumR - 107 * sumG - 21 * sumB + 512) / 1024 + 128, 0, 255));
+        }
+    }
+}
+
+void EncodePng(const SDL_Surface* surface, std::vector<unsigned char>& out) {
+    // 最简PNG：RGB8、无滤波，zlib流只用不压缩的存储块（编码成本只是拷贝）
+    int w = surface->w;
+    int h = surface->h;
+    size_t stride = static_cast<size_t>(w) * 3 + 1;
+    std::vector<unsigned char> raw(stride * h);
+    for (int y = 0; y < h; ++y) {
+        unsigned char* dst = raw.data() + stride * y;
+        *dst++ = 0;
+        const uint32_t* row = SurfaceRow(surface, y);
+        for (int x = 0; x < w; ++x) {
+            int r, g, b;
+            UnpackPixel(row[x], r, g, b);
+            *dst++ = static_cast<unsigned char>(r);
+            *dst++ = static_cast<unsigned char>(g);
+            *dst++ = static_cast<unsigned char>(b);
+        }
+    }
+
+    std::vector<unsigned char> zlib;
+    zlib.reserve(raw.size() + raw.size() / 65535 * 5 + 16);
+    zlib.push_back(0x78);
+    zlib.push_back(0x01);
+    uint32_t adlerA = 1;
+    uint32_t adlerB = 0;
+    size_t offset = 0;
+    do {
+        size_t blockSize = std::min<size_t>(65535, raw.size() - offset);
+        bool last = offset + blockSize == raw.size();
+        zlib.push_back(last ? 1 : 0);
+        zlib.push_back(static_cast<unsigned char>(blockSize & 0xFF));
+        zlib.push_back(static_cast<unsigned char>(blockSize >> 8));
+        zlib.push_back(static_cast<unsigned char>(~blockSize & 0xFF));
+        zlib.push_back(static_cast<unsigned char>((~blockSize >> 8) & 0xFF));
+        zlib.insert(zlib.end(), raw.begin() + offset, raw.begin() + offset + blockSize);
+        for (size_t i = offset; i < offset + blockSize; ++i) {
+            adlerA = (adlerA + raw[i]) % 65521;
+            adlerB = (adlerB + adlerA) % 65521;
+        }
+        offset += blockSize;
+    } while (offset < raw.size());
+    PutBigEndian32(zlib, (adlerB << 16) | adlerA);
+
+    static const unsigned char kSignature[] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    out.assign(kSignature, kSignature + sizeof(kSignature));
+    std::vector<unsigned char> header;
+    PutBigEndian32(header, static_cast<uint32_t>(w));
+    PutBigEndian32(header, static_cast<uint32_t>(h));
+    header.insert(header.end(), {8, 2, 0, 0, 0});
+    PutPngChunk(out, "IHDR", header.data(), header.size());
+    PutPngChunk(out, "IDAT", zlib.data(), zlib.size());
+    PutPngChunk(out, "IEND", nullptr, 0);
+}
+
+bool WriteBytes(std::FILE* file, const std::vector<unsigned char>& data) {
+    return std::fwrite(data.data(), 1, data.size(), file) == data.size();
+}
+
+struct FramePattern {
+    // PNG帧文件名：帧号前后的文字与补零宽度（0为不补零）
+    std::string prefix;
+    std::string suffix;
+    int zeroPadWidth = 0;
+};
+
+// 文件名模式只认一个%d或%0Nd（%%是字面的%），其余的%一律拒绝，不把用户输入当作printf格式串
+bool ParseFramePattern(const std::string& pattern, FramePattern& out) {
+    FramePattern result;
+    std::string* text = &result.prefix;
+    bool found = false;
+    for (size_t i = 0; i < pattern.size(); ++i) {
+        if (pattern[i] != '%') {
+            *text += pattern[i];
+            continue;
+        }
+        if (i + 1 < pattern.size() && pattern[i + 1] == '%') {
+            *text += '%';
+            ++i;
+            continue;
+        }
+        size_t j = i + 1;
+        int width = 0;
+        if (j < pattern.size() && pattern[j] == '0') {
+            ++j;
+            while (j < pattern.size() && pattern[j] >= '0' && pattern[j] <= '9' && width < 100) {
+                width = width * 10 + (pattern[j++] - '0');
+            }
+            if (width == 0 || width > 20) {
+                return false;
+            }
+        }
+        if (found || j >= pattern.size() || pattern[j] != 'd') {
+            return false;
+        }
+        found = true;
+        result.zeroPadWidth = width;
+        text = &result.suffix;
+        i = j;
+    }
+    if (!found) {
+        return false;
+    }
+    out = std::move(result);
+    return true;
+}
+
+std::string FormatFramePath(const FramePattern& pattern, int frame) {
+    std::string number = std::to_string(frame);
+    if (static_cast<int>(number.size()) < pattern.zeroPadWidth) {
+        number.insert(0, pattern.zeroPadWidth - number.size(), '0');
+    }
+    return pattern.prefix + number + pattern.suffix;
+}
+}
+
+bool ExportVideo(Chart&& chart, const ExportOptions& options, ExportStats& stats, std::string& error) {
+    PROFILE_ZONE("ExportVideo");
+    if (options.width <= 0 || options.height <= 0 || options.width % 2 != 0 || options.height % 2 != 0) {
+        error = "Export size must be positive and even.";
+        return false;
+    }
+    if (options.fps <= 0 || options.rate <= 0.0) {
+        error = "Export fps and rate must be positive.";
+        return false;
+    }
+    FramePattern framePattern;
+    if (options.format == ExportFormat::Png && !ParseFramePattern(options.output, framePattern)) {
+        error = "PNG output needs a file pattern with exactly one %d or %0Nd, such as frame_%06d.png.";
+        return false;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    RenderConfig config = MakeExportConfig(options);
+    Game game;
+    game.SetJudgePreset(options.judgePreset);
+    game.LoadChart(std::move(chart));
+    game.SetRate(options.rate);
+    const ArenaVector<Note>& notes = game.GetChart().notes;
+    int firstMs = notes.empty() ? 0 : notes.front().timeMs;
+    int startMs = std::min(0, firstMs - kLeadInMs);
+    int endMs = game.GetChartEndMs() + kTailMs;
+    double frameStepMs = 1000.0 * options.rate / options.fps;
+    int playFrames = static_cast<int>((endMs - startMs) / frameStepMs) + 1;
+    int totalFrames = playFrames + options.resultsSeconds * options.fps;
+
+    std::FILE* stream = nullptr;
+    if (options.format != ExportFormat::Png) {
+        stream = options.output == "-" ? stdout : std::fopen(options.output.c_str(), "wb");
+        if (!stream) {
+            error = "Failed to open export output: " + options.output;
+            return false;
+        }
+#ifdef _WIN32
+        // Windows下标准输出默认是文本模式，会改写换行字节
+        if (stream == stdout) {
+            _setmode(_fileno(stdout), _O_BINARY);
+        }
+#endif
+        if (options.format == ExportFormat::Y4m) {
+            std::fprintf(stream, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C420jpeg\n", options.width, options.height,
+                         options.fps);
+        }
+    }
+
+    unsigned int threadCount = options.threads > 0 ? static_cast<unsigned int>(options.threads)
+                                                   : std::max(1u, std::thread::hardware_concurrency());
+    std::vector<WorkerContext> workers(threadCount);
+    bool ok = true;
+    // 皮肤只读，所有线程共享同一份图集（各自上传到自己的渲染器）
+    auto skin = std::make_shared<Skin>();
+    std::string skinError;
+    if (options.skinDirectory.empty() || !LoadSkin(options.skinDirectory, *skin, skinError)) {
+        if (!skinError.empty()) {
+            std::fprintf(stderr, "Using built-in skin (%s)\n", skinError.c_str());
+        }
+        *skin = BuildDefaultSkin();
+    }
+    for (WorkerContext& worker : workers) {
+        worker.cache.sprites.SetSkin(skin);
+        worker.surface = SDL_CreateRGBSurfaceWithFormat(0, options.width, options.height, 32, SDL_PIXELFORMAT_ARGB8888);
+        worker.renderer = worker.surface ? SDL_CreateSoftwareRenderer(worker.surface) : nullptr;
+        if (!worker.renderer) {
+            error = std::string("Failed to create software renderer: ") + SDL_GetError();
+            ok = false;
+            break;
+        }
+    }
+
+    // 自动游玩：每个音符在自己的时刻按下，判定随帧顺序推进
+    size_t nextNote = 0;
+    auto advanceTo = [&](int nowMs) {
+        while (nextNote < notes.size() && notes[nextNote].timeMs <= nowMs) {
+            const Note& note = notes[nextNote++];
+            game.HandleInput(std::clamp(note.lane, 0, game.GetKeyCount() - 1), note.timeMs);
+        }
+        game.Update(nowMs);
+    };
+
+    std::vector<FrameJob> batch(static_cast<size_t>(threadCount) * kFramesPerThreadBatch);
+    ResultsView resultsView;
+    bool resultsBuilt = false;
+    int frameIndex = 0;
+    while (ok && frameIndex < totalFrames) {
+        // 顺序推进判定并记下每帧的画面状态
+        int batchCount = std::min(static_cast<int>(batch.size()), totalFrames - frameIndex);
+        for (int i = 0; i < batchCount; ++i) {
+            FrameJob& job = batch[i];
+            int frame = frameIndex + i;
+            job.results = frame >= playFrames;
+            if (job.results) {
+                if (!resultsBuilt) {
+                    resultsView = BuildResultsView(game, config);
+                    resultsBuilt = true;
+                }
+                continue;
+            }
+            job.nowMs = startMs + static_cast<int>(frame * frameStepMs);
+            advanceTo(job.nowMs);
+            BuildPlayfieldView(game, job.nowMs, options.scrollSpeed, config, job.view);
+        }
+
+        // 绘制与编码互不依赖，按帧下标分给各线程
+        std::atomic<int> nextJob{0};
+        auto renderJobs = [&](WorkerContext& worker) {
+            for (int i = nextJob.fetch_add(1); i < batchCount; i = nextJob.fetch_add(1)) {
+                FrameJob& job = batch[i];
+                if (job.results) {
+                    RenderResults(worker.renderer, resultsView);
+                } else {
+                    RenderFrame(worker.renderer, job.view, job.nowMs, options.scrollSpeed, config, false, &worker.cache);
+                }
+                SDL_RenderFlush(worker.renderer);
+                if (options.format == ExportFormat::Y4m) {
+                    EncodeY4m(worker.surface, job.encoded);
+                } else if (options.format == ExportFormat::Raw) {
+                    EncodeRaw(worker.surface, job.encoded);
+                } else {
+                    EncodePng(worker.surface, job.encoded);
+                }
+            }
+        };
+        std::vector<std::thread> threads;
+        for (unsigned int t = 1; t < threadCount; ++t) {
+            threads.emplace_back([&, t]() {
+                PROFILE_THREAD_NAME("Export");
+                renderJobs(workers[t]);
+            });
+        }
+        renderJobs(workers[0]);
+        for (auto& thread : threads) {
+            thread.join();
+        }
+
+        // 按帧序写出
+        for (int i = 0; i < batchCount && ok; ++i) {
+            if (options.format == ExportFormat::Png) {
+                std::string path = FormatFramePath(framePattern, frameIndex + i);
+                std::FILE* file = std::fopen(path.c_str(), "wb");
+                ok = file && WriteBytes(file, batch[i].encoded);
+                if (file) {
+                    std::fclose(file);
+                }
+                if (!ok) {
+                    error = "Failed to write frame: " + path;
+                }
+            } else if (!WriteBytes(stream, batch[i].encoded)) {
+                error = "Failed to write export stream.";
+                ok = false;
+            }
+        }
+        frameIndex += batchCount;
+    }
+
+    for (WorkerContext& worker : workers) {
+        if (worker.renderer) {
+            worker.cache.Release();
+            SDL_DestroyRenderer(worker.renderer);
+        }
+        if (worker.surface) {
+            SDL_FreeSurface(worker.surface);
+        }
+    }
+    if (stream && stream != stdout) {
+        std::fclose(stream);
+    } else if (stream) {
+        std::fflush(stream);
+    }
+    stats.frames = frameIndex;
+    stats.elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return ok;
+}
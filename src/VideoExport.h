@@ -0,0 +1,39 @@
+#pragma once
+
+#include <string>
+
+#include "Chart.h"
+#include "JudgeTable.h"
+
+enum class ExportFormat {
+    Y4m,
+    Raw,
+    Png
+};
+
+struct ExportOptions {
+    // 视频导出参数：固定帧步长、分辨率（宽高需为偶数）与输出格式
+    int width = 1280;
+    int height = 720;
+    int fps = 60;
+    float scrollSpeed = 1.0f;
+    double rate = 1.0;
+    JudgePreset judgePreset = JudgePreset::ChartOD;
+    ExportFormat format = ExportFormat::Y4m;
+    // "-"为标准输出（可直接接ffmpeg）；PNG序列为含%d的文件名模板
+    std::string output = "-";
+    int threads = 0;
+    // 结尾附加的结算画面时长
+    int resultsSeconds = 3;
+    // 皮肤目录，为空或载入失败时使用内置皮肤
+    std::string skinDirectory;
+};
+
+struct ExportStats {
+    int frames = 0;
+    double elapsedMs = 0.0;
+};
+
+// 自动游玩整张谱面并用软件渲染器逐帧离屏绘制；每帧只取决于时间与判定状态，
+// 判定按帧顺序推进，绘制与编码按批分给多个线程，写出仍按帧序
+bool ExportVideo(Chart&& chart, const ExportOptions& options, ExportStats& stats, std::string& error);
@@ -5,24 +5,30 @@
 #endif
 
 #include <algorithm>
+#include <array>
+#include <cmath>
 #include <cstdio>
-#include <filesystem>
 #include <string>
 #include <vector>
 
+#include "Audio.h"
+#include "Calibration.h"
+#include "ChartBinary.h"
+#include "ChartEditor.h"
+#include "ChartStream.h"
+#include "ChartWatcher.h"
+#include "Difficulty.h"
+#include "EvdevInput.h"
 #include "Game.h"
-#include "OsuParser.h"
+#include "Library.h"
+#include "Prefetcher.h"
+#include "Profiler.h"
+#include "RenderThread.h"
 #include "Renderer.h"
+#include "SearchIndex.h"
+#include "Skin.h"
 
 namespace {
-std::string GetDirectory(const std::string& path) {
-    size_t pos = path.find_last_of("/\\");
-    if (pos == std::string::npos) {
-        return "";
-    }
-    return path.substr(0, pos + 1);
-}
-
 std::vector<SDL_Scancode> BuildKeyMap(int keyCount) {
     if (keyCount == 4) {
         return {SDL_SCANCODE_D, SDL_SCANCODE_F, SDL_SCANCODE_J, SDL_SCANCODE_K};
@@ -60,64 +66,27 @@ double GetNowMs() {
            static_cast<double>(SDL_GetPerformanceFrequency());
 }
 
-struct ChartEntry {
-    std::string label;
-    std::string path;
-};
-
 struct ResolutionOption {
     int width = 0;
     int height = 0;
 };
 
-std::vector<ChartEntry> ScanCharts(const std::string& rootPath) {
-    std::vector<ChartEntry> entries;
-    std::error_code error;
-    if (!std::filesystem::exists(rootPath, error)) {
-        std::filesystem::create_directories(rootPath, error);
-        return entries;
-    }
-
-    for (const auto& dirEntry : std::filesystem::directory_iterator(rootPath)) {
-        if (!dirEntry.is_directory()) {
-            continue;
-        }
-        std::string folder = dirEntry.path().filename().string();
-        for (const auto& fileEntry : std::filesystem::directory_iterator(dirEntry.path())) {
-            if (!fileEntry.is_regular_file()) {
-                continue;
-            }
-            if (fileEntry.path().extension() == ".osu") {
-                ChartEntry entry;
-                entry.path = fileEntry.path().string();
-                Chart metadata;
-                std::string errorText;
-                if (ParseOsuFile(entry.path, metadata, errorText)) {
-                    if (!metadata.title.empty() && !metadata.version.empty()) {
-                        entry.label = metadata.title + " - " + metadata.version;
-                    } else if (!metadata.title.empty()) {
-                        entry.label = metadata.title;
-                    }
-                }
-                if (entry.label.empty()) {
-                    entry.label = fileEntry.path().stem().string();
-                }
-                entries.push_back(entry);
-            }
-        }
-    }
-
-    std::sort(entries.begin(), entries.end(), [](const ChartEntry& a, const ChartEntry& b) {
-        return a.label < b.label;
-    });
-    return entries;
-}
-
 }
 
 int main(int argc, char* argv[]) {
     // 主入口：初始化SDL、加载菜单与游戏循环
-    std::string osuPath = argc > 1 ? argv[1] : "";
+    PROFILE_THREAD_NAME("Main");
+    // 参数：[--evdev] [谱面路径]
+    std::string osuPath;
+    bool useEvdev = false;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--evdev") {
+            useEvdev = true;
+        } else {
+            osuPath = arg;
+        }
+    }
 
     if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO | SDL_INIT_TIMER) != 0) {
         std::printf("SDL init failed: %s\n", SDL_GetError());
@@ -153,40 +122,97 @@ int main(int argc, char* argv[]) {
         return 1;
     }
 
-    SDL_Renderer* renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED);
-    if (!renderer) {
-        std::printf("Renderer creation failed: %s\n", SDL_GetError());
-        SDL_DestroyWindow(window);
-        SDL_Quit();
-        return 1;
+    // 渲染与Present放在独立线程，主线程只处理输入、判定与音频，不会被垂直同步阻塞
+    const int targetFps = 165;
+    RenderThread renderThread;
+    {
+        // skin目录缺失或不完整时使用内置皮肤
+        auto skin = std::make_shared<Skin>();
+        std::string skinError;
+        if (!LoadSkin("skin", *skin, skinError)) {
+            std::printf("Using built-in skin (%s)\n", skinError.c_str());
+            *skin = BuildDefaultSkin();
+        }
+        renderThread.SetSkin(std::move(skin));
+        std::string renderError;
+        if (!renderThread.Start(window, targetFps, renderError)) {
+            std::printf("%s\n", renderError.c_str());
+            SDL_DestroyWindow(window);
+            SDL_Quit();
+            return 1;
+        }
     }
 
 #ifdef USE_SDL_MIXER
-    Mix_Music* music = nullptr;
     Mix_Init(MIX_INIT_MP3 | MIX_INIT_OGG);
     if (Mix_OpenAudio(48000, MIX_DEFAULT_FORMAT, 2, 4096) != 0) {
         std::printf("Mix_OpenAudio failed: %s\n", Mix_GetError());
     }
-#else
-    SDL_AudioDeviceID audioDevice = 0;
-    SDL_AudioSpec wavSpec{};
-    Uint8* wavBuffer = nullptr;
-    Uint32 wavLength = 0;
 #endif
+    // 歌曲预先解码成设备格式PCM，播放、暂停与定位都只是移动缓存中的帧位置
+    AudioPlayer audioPlayer;
+    {
+        std::string audioError;
+        if (!audioPlayer.Open(audioError)) {
+            std::printf("%s\n", audioError.c_str());
+        }
+    }
 
     enum class AppState {
         Menu,
         Ready,
         Countdown,
         Playing,
-        Paused
+        Paused,
+        CalibrationDone,
+        Results,
+        Editor
     };
 
-    // 扫描assets子目录下的osu谱面
-    std::vector<ChartEntry> chartEntries = ScanCharts("assets");
+    // 扫描assets子目录下的osu谱面（难度由库索引缓存，变更的谱面并行重算）
+    std::vector<ChartEntry> chartEntries = ScanCharts("assets", "assets/library.idx");
+    // 外部编辑器保存谱面后增量更新库，正在游玩的谱面就地换上新音符
+    ChartWatcher chartWatcher;
+    {
+        std::string watchError;
+        if (!chartWatcher.Start("assets", watchError)) {
+            std::printf("Chart hot reload disabled: %s\n", watchError.c_str());
+        }
+    }
+    // --evdev：游玩中的轨道按键改由evdev线程读取，按内核时间戳判定；打不开设备时仍用SDL键盘状态
+    EvdevInput evdevInput;
+    if (useEvdev) {
+        std::string evdevError;
+        if (evdevInput.Start(evdevError)) {
+            std::printf("Raw keyboard input from %d evdev devices\n", evdevInput.GetDeviceCount());
+        } else {
+            std::printf("Raw keyboard input disabled: %s\n", evdevError.c_str());
+        }
+    }
+    std::vector<EvdevKeyEvent> evdevEvents;
+    std::vector<std::string> changedChartPaths;
+    double lastWatchPollMs = 0.0;
+    // 文件变化的检查间隔
+    const double chartWatchIntervalMs = 200.0;
+    // 菜单显示顺序：按排序与难度筛选后的chartEntries下标
+    std::vector<int> menuOrder;
+    // 显示文本与两种排序只在扫描后生成一次，之后筛选只是过一遍下标
+    std::vector<std::string> menuLabels;
+    std::vector<int> starsOrder;
+    ChartSearchIndex searchIndex;
+    std::string searchQuery;
+    std::vector<int> searchMatches;
+    std::vector<char> matchMask;
+    int menuScroll = 0;
+    bool sortByStars = false;
+    int minStarsIndex = 0;
+    static const double kMinStars[] = {0.0, 2.0, 3.0, 4.0, 5.0};
+    static const char* kMinStarsNames[] = {"ALL", "2+", "3+", "4+", "5+"};
     int selectedIndex = 0;
-    Chart chart;
+    DifficultyInfo difficulty;
     Game game;
+    // 当前载入的谱面文件（校准谱面与菜单中为空），热重载据此判断
+    std::string loadedChartPath;
     std::vector<SDL_Scancode> keyMap;
     float scrollSpeed = 1.0f;
     double startTimeMs = 0.0;
@@ -194,74 +220,279 @@ int main(int argc, char* argv[]) {
     double countdownStartMs = 0.0;
     double timeOffsetMs = 0.0;
     double pausedGameTimeMs = 0.0;
+    // 全局音频/输入偏移：从谱面时间中扣除，判定与渲染共用
+    double globalOffsetMs = 0.0;
+    // 练习用播放速率，谱面时间按速率缩放；校准谱面总是1倍速
+    double playbackRate = 1.0;
+    bool preservePitch = true;
+    // 练习用A–B循环：loopEndMs大于loopStartMs时，播放到B点自动跳回A点
+    int loopStartMs = -1;
+    int loopEndMs = -1;
+    bool calibrating = false;
+    CalibrationResult calibrationResult;
+    // 结算画面缓冲只生成一次，快照之间共享
+    std::shared_ptr<const ResultsView> resultsView;
+    // 后台预取选中谱面及其邻居（解析、难度与解码好的音频），Enter时直接取用
+    ChartPrefetcher prefetcher(audioPlayer.Format(), 256u << 20, 8);
+    int prefetchedEntry = -1;
+    // 库里记录的音符数达到此值的.osu谱面流式载入：元数据解析完即可开始，音符由后台线程陆续送来
+    const int streamParseMinNotes = 200000;
+    ChartStreamer chartStreamer;
+    std::vector<Note> streamedNotes;
+    double selectionChangedMs = 0.0;
+    std::string previewPath;
+    // 选中项停留多久后开始预览
+    const double previewDelayMs = 250.0;
     bool countdownFromPause = false;
     SDL_Rect playButton = GetPlayButtonRect(renderConfig);
     AppState state = AppState::Menu;
     int pauseMenuIndex = 0;
+    // 编辑器：轨道键按下时记录游标，松开时游标没动则放单键，动过则放长条
+    ChartEditor editor;
+    std::array<int, kMaxLanes> editorPressMs{};
+    std::string editorMessage;
+    bool editorDiscardArmed = false;
     const int countdownDurationMs = 3000;
+    // 最后一个音符之后多久进入结算
+    const int resultsDelayMs = 1500;
 
     // 释放当前音频资源
     auto unloadAudio = [&]() {
-#ifdef USE_SDL_MIXER
-        if (music) {
-            Mix_HaltMusic();
-            Mix_FreeMusic(music);
-            music = nullptr;
+        audioPlayer.SetClip(nullptr);
+        audioPlayer.SetLoop(false);
+    };
+
+    // 解码内存中的音频文件并交给播放器（开头同步解码，其余在后台继续）
+    auto loadAudio = [&](std::shared_ptr<const std::vector<unsigned char>> data) {
+        std::string audioError;
+        std::shared_ptr<AudioClip> clip = AudioClip::Decode(std::move(data), audioPlayer.Format(), audioError);
+        if (!clip) {
+            std::printf("Audio load failed: %s\n", audioError.c_str());
         }
-#else
-        if (audioDevice != 0) {
-            SDL_CloseAudioDevice(audioDevice);
-            audioDevice = 0;
+        audioPlayer.SetClip(std::move(clip));
+    };
+
+    // 把当前速率同步给判定、渲染与音频
+    auto applyPlaybackRate = [&]() {
+        double rate = calibrating ? 1.0 : playbackRate;
+        game.SetRate(rate);
+        audioPlayer.SetRate(rate, preservePitch);
+    };
+
+    // 换上谱面的音频（停止预览；预览的正是这首时直接接着用同一份解码结果）
+    auto useChartAudio = [&](std::shared_ptr<AudioClip> clip, const std::string& audioFilename) {
+        unloadAudio();
+        previewPath.clear();
+        if (clip) {
+            audioPlayer.SetClip(std::move(clip));
+        } else if (!audioFilename.empty()) {
+            std::printf("Audio file not found: %s\n", audioFilename.c_str());
         }
-        if (wavBuffer) {
-            SDL_FreeWAV(wavBuffer);
-            wavBuffer = nullptr;
-            wavLength = 0;
+    };
+
+    // 流式载入：同步解析元数据与时间点后交给Game，星级沿用库里的（完整难度要等全部音符）
+    auto streamChart = [&](const std::string& path, double starRating) -> bool {
+        Chart header;
+        size_t expectedNotes = 0;
+        std::string error;
+        if (!chartStreamer.Start(path, header, expectedNotes, error)) {
+            std::printf("Streaming load failed, loading synchronously: %s\n", error.c_str());
+            return false;
         }
-#endif
+        std::string audioFilename(header.audioFilename);
+        useChartAudio(LoadChartAudio(path, audioFilename, audioPlayer.Format()), audioFilename);
+        difficulty = DifficultyInfo();
+        difficulty.starRating = starRating;
+        game.BeginStream(std::move(header), expectedNotes);
+        return true;
     };
 
     // 读取谱面与音频资源
     auto loadChart = [&](const std::string& path) -> bool {
-        Chart nextChart;
-        std::string error;
-        if (!ParseOsuFile(path, nextChart, error)) {
-            std::printf("Failed to load chart: %s\n", error.c_str());
+        PROFILE_ZONE("loadChart");
+        chartStreamer.Stop();
+        auto entry = std::find_if(chartEntries.begin(), chartEntries.end(),
+                                  [&](const ChartEntry& candidate) { return candidate.path == path; });
+        bool streamable =
+            entry != chartEntries.end() && entry->noteCount >= streamParseMinNotes && !IsChartBinaryPath(path);
+        // 优先使用预取结果（可流式载入的谱面不等待进行中的预取），未命中时在主线程载入
+        PreparedChart prepared;
+        bool loaded = prefetcher.Take(path, prepared, !streamable);
+        if (!loaded && streamable && streamChart(path, entry->starRating)) {
+            loadedChartPath = path;
+            keyMap = BuildKeyMap(game.GetKeyCount());
+            calibrating = false;
+            applyPlaybackRate();
+            return true;
+        }
+        if (!loaded) {
+            prepared = PrepareChart(path, audioPlayer.Format());
+        }
+        if (!prepared.ok) {
+            std::printf("Failed to load chart: %s\n", prepared.error.c_str());
             return false;
         }
 
+        useChartAudio(std::move(prepared.audio), std::string(prepared.chart.audioFilename));
+        difficulty = prepared.difficulty;
+        // 谱面连同arena整体移交给Game，不做复制
+        game.LoadChart(std::move(prepared.chart));
+        loadedChartPath = path;
+        keyMap = BuildKeyMap(game.GetKeyCount());
+        calibrating = false;
+        applyPlaybackRate();
+        return true;
+    };
+
+    // 载入节拍器谱面与内存中生成的点击音轨
+    auto loadCalibration = [&]() {
+        chartStreamer.Stop();
         unloadAudio();
-        std::string audioPath;
-        if (!nextChart.audioFilename.empty()) {
-            audioPath = GetDirectory(path) + nextChart.audioFilename;
-        }
+        Chart calibrationChart = BuildCalibrationChart();
+        loadAudio(std::make_shared<std::vector<unsigned char>>(BuildClickTrackWav(calibrationChart)));
+        game.LoadChart(std::move(calibrationChart));
+        loadedChartPath.clear();
+        keyMap = BuildKeyMap(game.GetKeyCount());
+        calibrating = true;
+        applyPlaybackRate();
+    };
 
-#ifdef USE_SDL_MIXER
-        if (!audioPath.empty()) {
-            music = Mix_LoadMUS(audioPath.c_str());
-            if (!music) {
-                std::printf("Failed to load music: %s\n", Mix_GetError());
+    // 按当前排序与筛选重建菜单顺序，尽量保持选中项不变
+    auto rebuildMenu = [&]() {
+        int selectedEntry = selectedIndex < static_cast<int>(menuOrder.size()) ? menuOrder[selectedIndex] : -1;
+        bool filtering = !searchQuery.empty();
+        if (filtering) {
+            searchIndex.Query(searchQuery, searchMatches);
+            std::fill(matchMask.begin(), matchMask.end(), 0);
+            for (int index : searchMatches) {
+                matchMask[index] = 1;
             }
         }
-#else
-        if (!audioPath.empty()) {
-            if (SDL_LoadWAV(audioPath.c_str(), &wavSpec, &wavBuffer, &wavLength)) {
-                audioDevice = SDL_OpenAudioDevice(nullptr, 0, &wavSpec, nullptr, 0);
-            } else {
-                std::printf("Audio load failed (WAV only in this build): %s\n", SDL_GetError());
+        menuOrder.clear();
+        for (int i = 0; i < static_cast<int>(chartEntries.size()); ++i) {
+            int index = sortByStars ? starsOrder[i] : i;
+            if (chartEntries[index].starRating >= kMinStars[minStarsIndex] && (!filtering || matchMask[index])) {
+                menuOrder.push_back(index);
             }
         }
-#endif
+        auto it = std::find(menuOrder.begin(), menuOrder.end(), selectedEntry);
+        selectedIndex = it != menuOrder.end() ? static_cast<int>(it - menuOrder.begin()) : 0;
+    };
 
-        chart = nextChart;
-        game.LoadChart(chart);
+    // 谱面库变化后重建显示文本、排序与搜索索引
+    auto rebuildLibrary = [&]() {
+        menuLabels.clear();
+        menuLabels.reserve(chartEntries.size());
+        char label[320];
+        for (const ChartEntry& entry : chartEntries) {
+            std::snprintf(label, sizeof(label), "%dK %5.2f  %s", entry.keyCount, entry.starRating,
+                          entry.label.c_str());
+            menuLabels.push_back(label);
+        }
+        starsOrder.resize(chartEntries.size());
+        for (int i = 0; i < static_cast<int>(starsOrder.size()); ++i) {
+            starsOrder[i] = i;
+        }
+        std::stable_sort(starsOrder.begin(), starsOrder.end(), [&](int a, int b) {
+            return chartEntries[a].starRating < chartEntries[b].starRating;
+        });
+        searchIndex.Build(chartEntries);
+        matchMask.assign(chartEntries.size(), 0);
+        rebuildMenu();
+    };
+    rebuildLibrary();
+
+    // 当前谱面时间（已扣除暂停与全局偏移，按播放速率缩放；偏移按真实时间计）
+    auto chartTimeAt = [&](double realMs) {
+        return (realMs - startTimeMs - timeOffsetMs - globalOffsetMs) * game.GetRate();
+    };
+    auto getChartTimeMs = [&]() { return chartTimeAt(GetNowMs()); };
+
+    // 跳转到谱面时间targetMs：判定与统计回退，计时与音频重新对齐（暂停中音频不动，继续时按暂停位置定位）
+    auto seekTo = [&](int targetMs) {
+        targetMs = std::clamp(targetMs, 0, game.GetChartEndMs());
+        game.Seek(targetMs);
+        if (state == AppState::Paused) {
+            // 计时对齐到暂停时刻的目标位置，继续时补上暂停时长后正好从目标处开始
+            pausedGameTimeMs = targetMs;
+            timeOffsetMs = pauseStartMs - startTimeMs - globalOffsetMs - targetMs / game.GetRate();
+            return;
+        }
+        timeOffsetMs = GetNowMs() - startTimeMs - globalOffsetMs - targetMs / game.GetRate();
+        audioPlayer.Seek(targetMs + globalOffsetMs * game.GetRate());
+    };
+
+    // 重新读取正在游玩的谱面并换上新音符：谱面时间、暂停与倒计时状态不变，没改动的音符保留判定
+    auto hotReloadChart = [&]() {
+        if (state == AppState::Results || state == AppState::CalibrationDone) {
+            return;
+        }
+        Chart chart;
+        std::string error;
+        if (!LoadChartFile(loadedChartPath, chart, error)) {
+            std::printf("Hot reload failed: %s\n", error.c_str());
+            return;
+        }
+        // 流式载入尚未完成时改用整张重新解析的结果
+        chartStreamer.Stop();
+        DifficultyInfo reloadedDifficulty = ComputeDifficulty(chart);
+        int nowMs = 0;
+        if (state == AppState::Playing) {
+            nowMs = static_cast<int>(getChartTimeMs());
+        } else if (state == AppState::Paused || (state == AppState::Countdown && countdownFromPause)) {
+            nowMs = static_cast<int>(pausedGameTimeMs);
+        }
+        ChartReloadResult result = game.ReloadChart(std::move(chart), nowMs);
+        difficulty = reloadedDifficulty;
         keyMap = BuildKeyMap(game.GetKeyCount());
-        return true;
+        std::printf("Reloaded %s: %d notes kept, %d added, %d removed, %d judgements kept\n",
+                    loadedChartPath.c_str(), result.keptNotes, result.addedNotes, result.removedNotes,
+                    result.keptJudgements);
+    };
+
+    // 谱面文件变化：增量更新库与菜单（选中项按路径保持），丢弃过期的预取，正在游玩的谱面热重载
+    auto applyChartChanges = [&](const std::vector<std::string>& paths, bool rescan) {
+        std::string selectedPath = menuOrder.empty() ? "" : chartEntries[menuOrder[selectedIndex]].path;
+        bool changed = true;
+        if (rescan) {
+            chartEntries = ScanCharts("assets", "assets/library.idx");
+        } else {
+            changed = RefreshLibraryEntries(paths, chartEntries);
+            if (changed) {
+                SaveLibraryIndex("assets/library.idx", chartEntries);
+            }
+        }
+        for (const std::string& path : paths) {
+            prefetcher.Invalidate(path);
+        }
+        if (changed) {
+            rebuildLibrary();
+            auto it = std::find_if(menuOrder.begin(), menuOrder.end(),
+                                   [&](int index) { return chartEntries[index].path == selectedPath; });
+            if (it != menuOrder.end()) {
+                selectedIndex = static_cast<int>(it - menuOrder.begin());
+            }
+            prefetchedEntry = -1;
+        }
+        // 变化的是正在游玩的谱面本身，或它所在的.osz包
+        bool loadedChanged = std::any_of(paths.begin(), paths.end(), [&](const std::string& path) {
+            return loadedChartPath == path || loadedChartPath.compare(0, path.size() + 1, path + "/") == 0;
+        });
+        if (!loadedChartPath.empty() && (rescan || loadedChanged)) {
+            hotReloadChart();
+        }
     };
 
     // 返回菜单并重置状态
     auto returnToMenu = [&]() {
+        chartStreamer.Stop();
         unloadAudio();
+        // 谱面arena与打包音符整块释放
+        game.Unload();
+        loadedChartPath.clear();
+        // 回到菜单后重新预取并预览当前选中项
+        previewPath.clear();
+        prefetchedEntry = -1;
         startTimeMs = 0.0;
         pauseStartMs = 0.0;
         countdownStartMs = 0.0;
@@ -269,9 +500,40 @@ int main(int argc, char* argv[]) {
         pausedGameTimeMs = 0;
         countdownFromPause = false;
         pauseMenuIndex = 0;
+        loopStartMs = -1;
+        loopEndMs = -1;
+        calibrating = false;
+        applyPlaybackRate();
         state = AppState::Menu;
     };
 
+    // 打开选中谱面进入编辑器（停止预览，编辑时不播放音频）
+    auto openEditor = [&](const std::string& path) {
+        std::string editorError;
+        if (!editor.Open(path, editorError)) {
+            std::printf("Failed to open chart for editing: %s\n", editorError.c_str());
+            return;
+        }
+        unloadAudio();
+        previewPath.clear();
+        keyMap = BuildKeyMap(editor.GetKeyCount());
+        editorPressMs.fill(-1);
+        editorMessage.clear();
+        editorDiscardArmed = false;
+        state = AppState::Editor;
+    };
+
+    auto saveEditor = [&]() {
+        std::string editorError;
+        if (editor.Save(editorError)) {
+            std::printf("Saved chart: %s\n", editor.GetPath().c_str());
+            editorMessage = "SAVED";
+        } else {
+            std::printf("Failed to save chart: %s\n", editorError.c_str());
+            editorMessage = "SAVE FAILED";
+        }
+    };
+
     auto startCountdown = [&](bool fromPause) {
         countdownFromPause = fromPause;
         countdownStartMs = GetNowMs();
@@ -279,57 +541,61 @@ int main(int argc, char* argv[]) {
             startTimeMs = countdownStartMs;
             timeOffsetMs = 0;
             pausedGameTimeMs = 0;
+            loopStartMs = -1;
+            loopEndMs = -1;
         }
         state = AppState::Countdown;
     };
 
+    // 开始或继续播放：音频位置按谱面时间重新定位，暂停前后的误差不会累积
+    auto audioStartMs = [&](bool restart) {
+        return restart ? 0.0 : pausedGameTimeMs + globalOffsetMs * game.GetRate();
+    };
     auto startAudio = [&](bool restart) {
-#ifdef USE_SDL_MIXER
-        if (music) {
-            if (restart) {
-                Mix_HaltMusic();
-                Mix_RewindMusic();
-                Mix_PlayMusic(music, 0);
-            } else if (Mix_PausedMusic()) {
-                Mix_ResumeMusic();
-            } else if (!Mix_PlayingMusic()) {
-                Mix_PlayMusic(music, 0);
-            }
-        }
-#else
-        if (audioDevice != 0 && wavBuffer) {
-            if (restart) {
-                SDL_ClearQueuedAudio(audioDevice);
-                SDL_QueueAudio(audioDevice, wavBuffer, wavLength);
-            }
-            SDL_PauseAudioDevice(audioDevice, 0);
+        audioPlayer.Seek(audioStartMs(restart));
+        audioPlayer.Play();
+    };
+
+    // 用预取缓存里的音频播放选歌预览（循环播放，从预览点开始）
+    auto startPreview = [&](const std::string& path, std::shared_ptr<AudioClip> clip, int previewTimeMs) {
+        unloadAudio();
+        previewPath = path;
+        if (!clip) {
+            return;
         }
-#endif
+        audioPlayer.SetClip(std::move(clip));
+        audioPlayer.SetLoop(true);
+        audioPlayer.Seek(previewTimeMs);
+        audioPlayer.Play();
     };
 
     auto pauseAudio = [&]() {
-#ifdef USE_SDL_MIXER
-        if (music) {
-            Mix_PauseMusic();
-        }
-#else
-        if (audioDevice != 0) {
-            SDL_PauseAudioDevice(audioDevice, 1);
-        }
-#endif
+        audioPlayer.Pause();
     };
 
     // 切换窗口分辨率（宽度固定900，增加高度）
-    auto applyResolution = [&]() {
+    auto applyResolution = [&]() -> bool {
         renderConfig.windowWidth = resolutions[resolutionIndex].width;
         renderConfig.windowHeight = resolutions[resolutionIndex].height;
         renderConfig.playWidth = 900;
         renderConfig.playHeight = renderConfig.windowHeight;
         renderConfig.offsetX = (renderConfig.windowWidth - renderConfig.playWidth) / 2;
         renderConfig.judgeLineY = renderConfig.playHeight - 80;
+        // 窗口事件推送时渲染器的事件监视就在本线程上改视口：改大小期间先停下渲染线程，处理完事件再重建渲染器
+        renderThread.Stop();
         SDL_SetWindowSize(window, renderConfig.windowWidth, renderConfig.windowHeight);
         SDL_SetWindowPosition(window, SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED);
+        SDL_PumpEvents();
+        std::string renderError;
+        if (!renderThread.Start(window, targetFps, renderError)) {
+            std::printf("%s\n", renderError.c_str());
+            return false;
+        }
         playButton = GetPlayButtonRect(renderConfig);
+        if (state == AppState::Results) {
+            resultsView = std::make_shared<ResultsView>(BuildResultsView(game, renderConfig));
+        }
+        return true;
     };
 
     if (!osuPath.empty()) {
@@ -337,200 +603,550 @@ int main(int argc, char* argv[]) {
             state = AppState::Ready;
         }
     }
-    const int targetFps = 165;
-    const int targetFrameMs = 1000 / targetFps;
+    // 输入循环约1ms一轮，按键在按下后的下一轮就完成判定
+    const double inputPollMs = 1.0;
+    std::string windowTitle;
     std::vector<Uint8> prevKeys(SDL_NUM_SCANCODES, 0);
     bool running = true;
     // 主循环
     while (running) {
-        // 帧起始时间（高精度计时）
+        PROFILE_ZONE("Frame");
+        // 本轮起始时间（高精度计时）
         double frameStartMs = GetNowMs();
         // SDL事件处理（退出/菜单/暂停）
-        SDL_Event event;
-        while (SDL_PollEvent(&event)) {
-            if (event.type == SDL_QUIT) {
-                running = false;
-            } else if (event.type == SDL_MOUSEBUTTONDOWN && event.button.button == SDL_BUTTON_LEFT) {
-                if (state == AppState::Ready) {
-                    SDL_Point point{event.button.x, event.button.y};
-                    if (SDL_PointInRect(&point, &playButton)) {
-                        startCountdown(false);
+        {
+            PROFILE_ZONE("Events");
+            SDL_Event event;
+            while (SDL_PollEvent(&event)) {
+                if (event.type == SDL_QUIT) {
+                    running = false;
+                } else if (event.type == SDL_RENDER_TARGETS_RESET || event.type == SDL_RENDER_DEVICE_RESET) {
+                    renderThread.InvalidateTextures();
+                } else if (event.type == SDL_MOUSEBUTTONDOWN && event.button.button == SDL_BUTTON_LEFT) {
+                    if (state == AppState::Ready) {
+                        SDL_Point point{event.button.x, event.button.y};
+                        if (SDL_PointInRect(&point, &playButton)) {
+                            startCountdown(false);
+                        }
                     }
-                }
-            } else if (event.type == SDL_KEYDOWN) {
-                SDL_Scancode code = event.key.keysym.scancode;
-                if (code == SDL_SCANCODE_ESCAPE) {
-                    if (state == AppState::Menu) {
-                        running = false;
-                    } else if (state == AppState::Countdown) {
-                        break;
-                    } else if (state == AppState::Playing) {
-                        pauseStartMs = GetNowMs();
-                        pausedGameTimeMs = pauseStartMs - startTimeMs - timeOffsetMs;
+                } else if (event.type == SDL_MOUSEWHEEL && state == AppState::Editor) {
+                    editor.Step(event.wheel.y);
+                } else if (event.type == SDL_KEYDOWN) {
+                    SDL_Scancode code = event.key.keysym.scancode;
+                    bool modifierDown = (event.key.keysym.mod & (KMOD_CTRL | KMOD_ALT | KMOD_GUI)) != 0;
+                    if (state == AppState::Menu && !modifierDown) {
+                        // 菜单中字母数字直接输入搜索词（文本输入被禁用，这里按扫描码转换）
+                        char typed = 0;
+                        if (code >= SDL_SCANCODE_A && code <= SDL_SCANCODE_Z) {
+                            typed = static_cast<char>('a' + (code - SDL_SCANCODE_A));
+                        } else if (code >= SDL_SCANCODE_1 && code <= SDL_SCANCODE_9) {
+                            typed = static_cast<char>('1' + (code - SDL_SCANCODE_1));
+                        } else if (code == SDL_SCANCODE_0) {
+                            typed = '0';
+                        } else if (code == SDL_SCANCODE_SPACE && !searchQuery.empty()) {
+                            typed = ' ';
+                        }
+                        if (typed != 0 && searchQuery.size() < 48) {
+                            searchQuery.push_back(typed);
+                            rebuildMenu();
+                        } else if (code == SDL_SCANCODE_BACKSPACE && !searchQuery.empty()) {
+                            searchQuery.pop_back();
+                            rebuildMenu();
+                        }
+                        int pageRows = MenuVisibleRows(renderConfig);
+                        int lastIndex = std::max(0, static_cast<int>(menuOrder.size()) - 1);
+                        if (code == SDL_SCANCODE_PAGEUP) {
+                            selectedIndex = std::max(0, selectedIndex - pageRows);
+                        } else if (code == SDL_SCANCODE_PAGEDOWN) {
+                            selectedIndex = std::min(lastIndex, selectedIndex + pageRows);
+                        } else if (code == SDL_SCANCODE_HOME) {
+                            selectedIndex = 0;
+                        } else if (code == SDL_SCANCODE_END) {
+                            selectedIndex = lastIndex;
+                        }
+                    }
+                    if (state == AppState::Editor) {
+                        // 编辑器导航跟随按键重复；Ctrl组合键撤销、重做与保存
+                        bool ctrlHeld = (event.key.keysym.mod & KMOD_CTRL) != 0;
+                        bool shiftHeld = (event.key.keysym.mod & KMOD_SHIFT) != 0;
+                        if (code != SDL_SCANCODE_ESCAPE) {
+                            editorDiscardArmed = false;
+                        }
+                        if (code == SDL_SCANCODE_UP) {
+                            editor.Step(1);
+                        } else if (code == SDL_SCANCODE_DOWN) {
+                            editor.Step(-1);
+                        } else if (code == SDL_SCANCODE_PAGEUP) {
+                            editor.StepMeasure(1);
+                        } else if (code == SDL_SCANCODE_PAGEDOWN) {
+                            editor.StepMeasure(-1);
+                        } else if (code == SDL_SCANCODE_HOME) {
+                            editor.SetCursor(0);
+                        } else if (code == SDL_SCANCODE_END) {
+                            editor.SetCursor(editor.GetLastNoteMs());
+                        } else if (code == SDL_SCANCODE_LEFT) {
+                            editor.CycleDivisor(-1);
+                        } else if (code == SDL_SCANCODE_RIGHT) {
+                            editor.CycleDivisor(1);
+                        } else if (ctrlHeld && code == SDL_SCANCODE_Z) {
+                            editorMessage.clear();
+                            if (shiftHeld) {
+                                editor.Redo();
+                            } else {
+                                editor.Undo();
+                            }
+                        } else if (ctrlHeld && code == SDL_SCANCODE_Y) {
+                            editorMessage.clear();
+                            editor.Redo();
+                        } else if (ctrlHeld && code == SDL_SCANCODE_S && !event.key.repeat) {
+                            saveEditor();
+                        }
+                    }
+                    if (code == SDL_SCANCODE_ESCAPE) {
+                        if (state == AppState::Menu && !searchQuery.empty()) {
+                            searchQuery.clear();
+                            rebuildMenu();
+                        } else if (state == AppState::Menu) {
+                            running = false;
+                        } else if (state == AppState::Countdown) {
+                            break;
+                        } else if (state == AppState::Playing) {
+                            pauseStartMs = GetNowMs();
+                            pausedGameTimeMs = (pauseStartMs - startTimeMs - timeOffsetMs - globalOffsetMs) * game.GetRate();
+                            pauseMenuIndex = 0;
+                            pauseAudio();
+                            state = AppState::Paused;
+                        } else if (state == AppState::Paused) {
+                            startCountdown(true);
+                        } else if (state == AppState::Editor && editor.IsDirty() && !editorDiscardArmed) {
+                            // 有未保存的修改时第一次ESC只提示
+                            editorDiscardArmed = true;
+                            editorMessage = "UNSAVED CHANGES - ESC AGAIN TO DISCARD";
+                        } else if (state == AppState::Editor) {
+                            editor.Close();
+                            returnToMenu();
+                        } else {
+                            returnToMenu();
+                        }
+                    } else if (code == SDL_SCANCODE_F2 && state == AppState::Menu) {
+                        loadCalibration();
+                        state = AppState::Ready;
                         pauseMenuIndex = 0;
-                        pauseAudio();
-                        state = AppState::Paused;
-                    } else if (state == AppState::Paused) {
-                        startCountdown(true);
-                    } else {
-                        returnToMenu();
+                    } else if (code == SDL_SCANCODE_F3 && state == AppState::Menu) {
+                        int next = (static_cast<int>(game.GetJudgePreset()) + 1) % kJudgePresetCount;
+                        game.SetJudgePreset(static_cast<JudgePreset>(next));
+                    } else if (code == SDL_SCANCODE_F4 && state == AppState::Menu) {
+                        sortByStars = !sortByStars;
+                        rebuildMenu();
+                    } else if (code == SDL_SCANCODE_F6 && state == AppState::Menu) {
+                        minStarsIndex = (minStarsIndex + 1) % 5;
+                        rebuildMenu();
+                    } else if ((code == SDL_SCANCODE_F7 || code == SDL_SCANCODE_F8) && state == AppState::Menu) {
+                        double step = code == SDL_SCANCODE_F7 ? -0.05 : 0.05;
+                        playbackRate = std::clamp(std::round((playbackRate + step) * 20.0) / 20.0, 0.5, 2.0);
+                        applyPlaybackRate();
+                    } else if (code == SDL_SCANCODE_F11 && state == AppState::Menu && !menuOrder.empty()) {
+                        openEditor(chartEntries[menuOrder[selectedIndex]].path);
+                    } else if (code == SDL_SCANCODE_F10 && state == AppState::Menu) {
+                        preservePitch = !preservePitch;
+                        applyPlaybackRate();
+                    } else if (code == SDL_SCANCODE_F5) {
+                        resolutionIndex = (resolutionIndex + 1) % static_cast<int>(resolutions.size());
+                        running = applyResolution() && running;
+                    } else if (code == SDL_SCANCODE_F9) {
+                        // 导出性能trace（仅在启用profiler的构建中生效）
+                        PROFILE_DUMP("simplemania_trace.json");
                     }
-                } else if (code == SDL_SCANCODE_F5) {
-                    resolutionIndex = (resolutionIndex + 1) % static_cast<int>(resolutions.size());
-                    applyResolution();
                 }
             }
         }
 
-        // 轮询键盘状态，用于游戏判定与菜单控制
-        const Uint8* keys = SDL_GetKeyboardState(nullptr);
-        Uint16 mods = SDL_GetModState();
-        bool ctrlDown = (mods & KMOD_CTRL) != 0;
-        // 速度调节：Ctrl +/-
-        if (state != AppState::Menu && ctrlDown) {
-            if ((keys[SDL_SCANCODE_EQUALS] && !prevKeys[SDL_SCANCODE_EQUALS]) ||
-                (keys[SDL_SCANCODE_KP_PLUS] && !prevKeys[SDL_SCANCODE_KP_PLUS])) {
-                scrollSpeed = std::min(3.0f, scrollSpeed + 0.1f);
-            } else if ((keys[SDL_SCANCODE_MINUS] && !prevKeys[SDL_SCANCODE_MINUS]) ||
-                       (keys[SDL_SCANCODE_KP_MINUS] && !prevKeys[SDL_SCANCODE_KP_MINUS])) {
-                scrollSpeed = std::max(0.1f, scrollSpeed - 0.1f);
+        // 流式载入中：把后台解析好的音符追加给判定（Game只在主线程上修改）
+        if (game.IsStreaming()) {
+            bool streamDone = chartStreamer.Take(streamedNotes);
+            if (!streamedNotes.empty()) {
+                game.AppendNotes(streamedNotes);
+            }
+            if (streamDone) {
+                game.FinishStream();
+                std::printf("Streamed %d notes: %s\n", game.GetTotalNotes(), loadedChartPath.c_str());
             }
         }
 
-        // 主菜单选择
-        if (state == AppState::Menu && !chartEntries.empty()) {
-            if (keys[SDL_SCANCODE_UP] && !prevKeys[SDL_SCANCODE_UP]) {
-                selectedIndex = std::max(0, selectedIndex - 1);
-            } else if (keys[SDL_SCANCODE_DOWN] && !prevKeys[SDL_SCANCODE_DOWN]) {
-                selectedIndex = std::min(static_cast<int>(chartEntries.size()) - 1,
-                                         selectedIndex + 1);
-            } else if ((keys[SDL_SCANCODE_RETURN] && !prevKeys[SDL_SCANCODE_RETURN]) ||
-                       (keys[SDL_SCANCODE_SPACE] && !prevKeys[SDL_SCANCODE_SPACE])) {
-                if (loadChart(chartEntries[selectedIndex].path)) {
-                    state = AppState::Ready;
-                    pauseMenuIndex = 0;
-                }
+        // 谱面文件变化（队列溢出时整体重新扫描）
+        if (frameStartMs - lastWatchPollMs >= chartWatchIntervalMs) {
+            lastWatchPollMs = frameStartMs;
+            changedChartPaths.clear();
+            bool complete = chartWatcher.Poll(changedChartPaths);
+            if (!complete || !changedChartPaths.empty()) {
+                applyChartChanges(changedChartPaths, !complete);
             }
         }
 
-        // 进入倒计时
-        if (state == AppState::Ready) {
-            if ((keys[SDL_SCANCODE_RETURN] && !prevKeys[SDL_SCANCODE_RETURN]) ||
-                (keys[SDL_SCANCODE_SPACE] && !prevKeys[SDL_SCANCODE_SPACE])) {
-                startCountdown(false);
-            }
+        // 轮询键盘状态，用于游戏判定与菜单控制（evdev事件每轮都取走，不在游玩中的直接丢弃）
+        const Uint8* keys = SDL_GetKeyboardState(nullptr);
+        evdevInput.Poll(evdevEvents);
+        // 设备全部断开或读取线程出错：释放设备，轨道按键退回SDL键盘状态
+        if (!evdevInput.IsActive() && evdevInput.GetDeviceCount() > 0) {
+            evdevInput.Stop();
+            std::printf("Raw keyboard input lost, using SDL keyboard state\n");
         }
+        {
+            PROFILE_ZONE("Input");
+            Uint16 mods = SDL_GetModState();
+            bool ctrlDown = (mods & KMOD_CTRL) != 0;
+            // 速度调节：Ctrl +/-
+            if (state != AppState::Menu && ctrlDown) {
+                if ((keys[SDL_SCANCODE_EQUALS] && !prevKeys[SDL_SCANCODE_EQUALS]) ||
+                    (keys[SDL_SCANCODE_KP_PLUS] && !prevKeys[SDL_SCANCODE_KP_PLUS])) {
+                    scrollSpeed = std::min(3.0f, scrollSpeed + 0.1f);
+                } else if ((keys[SDL_SCANCODE_MINUS] && !prevKeys[SDL_SCANCODE_MINUS]) ||
+                           (keys[SDL_SCANCODE_KP_MINUS] && !prevKeys[SDL_SCANCODE_KP_MINUS])) {
+                    scrollSpeed = std::max(0.1f, scrollSpeed - 0.1f);
+                }
+            }
+            // 全局偏移手动调节：Ctrl [ / ]，每次5ms
+            if (ctrlDown) {
+                if (keys[SDL_SCANCODE_RIGHTBRACKET] && !prevKeys[SDL_SCANCODE_RIGHTBRACKET]) {
+                    globalOffsetMs = std::min(500.0, globalOffsetMs + 5.0);
+                } else if (keys[SDL_SCANCODE_LEFTBRACKET] && !prevKeys[SDL_SCANCODE_LEFTBRACKET]) {
+                    globalOffsetMs = std::max(-500.0, globalOffsetMs - 5.0);
+                }
+            }
 
-        // 暂停菜单选择
-        if (state == AppState::Paused) {
-            if (keys[SDL_SCANCODE_UP] && !prevKeys[SDL_SCANCODE_UP]) {
-                pauseMenuIndex = std::max(0, pauseMenuIndex - 1);
-            } else if (keys[SDL_SCANCODE_DOWN] && !prevKeys[SDL_SCANCODE_DOWN]) {
-                pauseMenuIndex = std::min(1, pauseMenuIndex + 1);
-            } else if ((keys[SDL_SCANCODE_RETURN] && !prevKeys[SDL_SCANCODE_RETURN]) ||
-                       (keys[SDL_SCANCODE_SPACE] && !prevKeys[SDL_SCANCODE_SPACE])) {
-                if (pauseMenuIndex == 0) {
-                    startCountdown(true);
-                } else {
+            // 练习：Left/Right 前后跳转5秒，[ 设A点，] 设B点并开始循环，Backspace 取消循环
+            if ((state == AppState::Playing || state == AppState::Paused) && !calibrating && !ctrlDown) {
+                int currentMs = state == AppState::Paused ? static_cast<int>(pausedGameTimeMs)
+                                                          : static_cast<int>(getChartTimeMs());
+                if (keys[SDL_SCANCODE_LEFT] && !prevKeys[SDL_SCANCODE_LEFT]) {
+                    seekTo(currentMs - 5000);
+                } else if (keys[SDL_SCANCODE_RIGHT] && !prevKeys[SDL_SCANCODE_RIGHT]) {
+                    seekTo(currentMs + 5000);
+                } else if (keys[SDL_SCANCODE_LEFTBRACKET] && !prevKeys[SDL_SCANCODE_LEFTBRACKET]) {
+                    loopStartMs = currentMs;
+                    loopEndMs = -1;
+                } else if (keys[SDL_SCANCODE_RIGHTBRACKET] && !prevKeys[SDL_SCANCODE_RIGHTBRACKET] &&
+                           loopStartMs >= 0 && currentMs > loopStartMs) {
+                    loopEndMs = currentMs;
+                    seekTo(loopStartMs);
+                } else if (keys[SDL_SCANCODE_BACKSPACE] && !prevKeys[SDL_SCANCODE_BACKSPACE]) {
+                    loopStartMs = -1;
+                    loopEndMs = -1;
+                }
+            }
+
+            // 主菜单选择
+            if (state == AppState::Menu && !menuOrder.empty()) {
+                if (keys[SDL_SCANCODE_UP] && !prevKeys[SDL_SCANCODE_UP]) {
+                    selectedIndex = std::max(0, selectedIndex - 1);
+                } else if (keys[SDL_SCANCODE_DOWN] && !prevKeys[SDL_SCANCODE_DOWN]) {
+                    selectedIndex = std::min(static_cast<int>(menuOrder.size()) - 1,
+                                             selectedIndex + 1);
+                } else if ((keys[SDL_SCANCODE_RETURN] && !prevKeys[SDL_SCANCODE_RETURN]) ||
+                           (keys[SDL_SCANCODE_SPACE] && !prevKeys[SDL_SCANCODE_SPACE] && searchQuery.empty())) {
+                    if (loadChart(chartEntries[menuOrder[selectedIndex]].path)) {
+                        state = AppState::Ready;
+                        pauseMenuIndex = 0;
+                    }
+                }
+            }
+
+            // 选中项变化时预取它和前后各两项，停留片刻后从缓存播放预览
+            if (state == AppState::Menu && !menuOrder.empty()) {
+                int entryIndex = menuOrder[selectedIndex];
+                if (entryIndex != prefetchedEntry) {
+                    prefetchedEntry = entryIndex;
+                    selectionChangedMs = GetNowMs();
+                    std::vector<std::string> paths;
+                    for (int delta : {0, 1, -1, 2, -2}) {
+                        int row = selectedIndex + delta;
+                        if (row >= 0 && row < static_cast<int>(menuOrder.size())) {
+                            paths.push_back(chartEntries[menuOrder[row]].path);
+                        }
+                    }
+                    prefetcher.Request(paths);
+                }
+                const std::string& selectedPath = chartEntries[entryIndex].path;
+                if (previewPath != selectedPath && GetNowMs() - selectionChangedMs > previewDelayMs) {
+                    int previewTimeMs = 0;
+                    auto audio = prefetcher.PeekAudio(selectedPath, previewTimeMs);
+                    if (audio) {
+                        startPreview(selectedPath, std::move(audio), previewTimeMs);
+                    }
+                }
+            }
+
+            // 校准结果：Enter应用推荐偏移
+            if (state == AppState::CalibrationDone) {
+                if ((keys[SDL_SCANCODE_RETURN] && !prevKeys[SDL_SCANCODE_RETURN]) ||
+                    (keys[SDL_SCANCODE_SPACE] && !prevKeys[SDL_SCANCODE_SPACE])) {
+                    if (calibrationResult.valid) {
+                        globalOffsetMs = std::clamp(globalOffsetMs + calibrationResult.meanMs, -500.0, 500.0);
+                    }
                     returnToMenu();
                 }
             }
-        }
 
-        // 倒计时结束后开始播放
-        if (state == AppState::Countdown) {
-            double elapsed = GetNowMs() - countdownStartMs;
-            if (elapsed >= countdownDurationMs) {
-                if (countdownFromPause) {
-                    timeOffsetMs += GetNowMs() - pauseStartMs;
-                } else {
-                    timeOffsetMs += countdownDurationMs;
+            // 结算画面：Enter返回菜单
+            if (state == AppState::Results) {
+                if ((keys[SDL_SCANCODE_RETURN] && !prevKeys[SDL_SCANCODE_RETURN]) ||
+                    (keys[SDL_SCANCODE_SPACE] && !prevKeys[SDL_SCANCODE_SPACE])) {
+                    returnToMenu();
                 }
-                startAudio(!countdownFromPause);
-                countdownFromPause = false;
-                state = AppState::Playing;
             }
-        }
 
-        // 游玩判定输入
-        if (state == AppState::Playing) {
-            for (int lane = 0; lane < static_cast<int>(keyMap.size()); ++lane) {
-                SDL_Scancode scancode = keyMap[lane];
-                if (scancode != SDL_SCANCODE_UNKNOWN && keys[scancode] && !prevKeys[scancode]) {
-                    int nowMs = static_cast<int>(GetNowMs() - startTimeMs - timeOffsetMs);
-                    game.HandleInput(lane, nowMs);
+            // 进入倒计时
+            if (state == AppState::Ready) {
+                if ((keys[SDL_SCANCODE_RETURN] && !prevKeys[SDL_SCANCODE_RETURN]) ||
+                    (keys[SDL_SCANCODE_SPACE] && !prevKeys[SDL_SCANCODE_SPACE])) {
+                    startCountdown(false);
+                }
+            }
+
+            // 暂停菜单选择
+            if (state == AppState::Paused) {
+                if (keys[SDL_SCANCODE_UP] && !prevKeys[SDL_SCANCODE_UP]) {
+                    pauseMenuIndex = std::max(0, pauseMenuIndex - 1);
+                } else if (keys[SDL_SCANCODE_DOWN] && !prevKeys[SDL_SCANCODE_DOWN]) {
+                    pauseMenuIndex = std::min(1, pauseMenuIndex + 1);
+                } else if ((keys[SDL_SCANCODE_RETURN] && !prevKeys[SDL_SCANCODE_RETURN]) ||
+                           (keys[SDL_SCANCODE_SPACE] && !prevKeys[SDL_SCANCODE_SPACE])) {
+                    if (pauseMenuIndex == 0) {
+                        startCountdown(true);
+                    } else {
+                        returnToMenu();
+                    }
+                }
+            }
+
+            // 倒计时结束后开始播放
+            if (state == AppState::Countdown) {
+                double elapsed = GetNowMs() - countdownStartMs;
+                if (elapsed >= countdownDurationMs && !audioPlayer.IsBuffered(audioStartMs(!countdownFromPause))) {
+                    // 音频开头还没解码出来：倒计时停在最后一秒，谱面计时一并顺延，开始后音画仍然对齐
+                    double heldMs = elapsed - countdownDurationMs;
+                    countdownStartMs += heldMs;
+                    if (!countdownFromPause) {
+                        startTimeMs += heldMs;
+                    }
+                } else if (elapsed >= countdownDurationMs) {
+                    if (countdownFromPause) {
+                        timeOffsetMs += GetNowMs() - pauseStartMs;
+                    } else {
+                        timeOffsetMs += countdownDurationMs;
+                    }
+                    startAudio(!countdownFromPause);
+                    countdownFromPause = false;
+                    state = AppState::Playing;
+                }
+            }
+
+            // 游玩判定输入
+            if (state == AppState::Editor) {
+                for (int lane = 0; lane < static_cast<int>(keyMap.size()); ++lane) {
+                    SDL_Scancode scancode = keyMap[lane];
+                    if (scancode == SDL_SCANCODE_UNKNOWN) {
+                        continue;
+                    }
+                    if (keys[scancode] && !prevKeys[scancode] && !ctrlDown) {
+                        editorPressMs[lane] = editor.GetCursorMs();
+                        editorDiscardArmed = false;
+                        editorMessage.clear();
+                    } else if (!keys[scancode] && prevKeys[scancode] && editorPressMs[lane] >= 0) {
+                        if (editorPressMs[lane] == editor.GetCursorMs()) {
+                            editor.ToggleNote(lane);
+                        } else {
+                            editor.PlaceHold(lane, editorPressMs[lane], editor.GetCursorMs());
+                        }
+                        editorPressMs[lane] = -1;
+                    }
                 }
             }
-        }
 
+            if (state == AppState::Playing && evdevInput.IsActive()) {
+                // evdev不区分窗口，只在窗口有键盘焦点时判定；SDL_Scancode取值即USB HID用法码，
+                // 内核单调时钟与SDL计时器的差每轮重新取，事件时间换算到谱面时间
+                bool focused = SDL_GetKeyboardFocus() == window;
+                double clockOffsetMs = GetNowMs() - MonotonicNowMs();
+                for (const EvdevKeyEvent& event : evdevEvents) {
+                    if (!event.pressed || !focused) {
+                        continue;
+                    }
+                    for (int lane = 0; lane < static_cast<int>(keyMap.size()); ++lane) {
+                        if (keyMap[lane] != SDL_SCANCODE_UNKNOWN && static_cast<int>(keyMap[lane]) == event.usage) {
+                            game.HandleInput(lane, static_cast<int>(chartTimeAt(event.timeMs + clockOffsetMs)));
+                        }
+                    }
+                }
+            } else if (state == AppState::Playing) {
+                for (int lane = 0; lane < static_cast<int>(keyMap.size()); ++lane) {
+                    SDL_Scancode scancode = keyMap[lane];
+                    if (scancode != SDL_SCANCODE_UNKNOWN && keys[scancode] && !prevKeys[scancode]) {
+                        int nowMs = static_cast<int>(getChartTimeMs());
+                        game.HandleInput(lane, nowMs);
+                    }
+                }
+            }
+        }
 
-        // 游戏更新与渲染
+        // 游戏更新
         int nowMs = 0;
         if (state == AppState::Playing) {
-            nowMs = static_cast<int>(GetNowMs() - startTimeMs - timeOffsetMs);
+            PROFILE_ZONE("Update");
+            nowMs = static_cast<int>(getChartTimeMs());
+            // A–B循环：越过B点时先跳回A点，B点之后的音符不会被判Miss
+            if (loopEndMs > loopStartMs && loopStartMs >= 0 && nowMs >= loopEndMs) {
+                seekTo(loopStartMs);
+                nowMs = static_cast<int>(getChartTimeMs());
+            }
             game.Update(nowMs);
-            RenderFrame(renderer, game, nowMs, scrollSpeed, renderConfig, false);
-        } else if (state == AppState::Ready) {
-            RenderFrame(renderer, game, 0, scrollSpeed, renderConfig, true);
-        } else if (state == AppState::Countdown) {
-            int renderTime = countdownFromPause ? static_cast<int>(pausedGameTimeMs) : 0;
-            RenderFrame(renderer, game, renderTime, scrollSpeed, renderConfig, false);
-            int remaining = countdownDurationMs - static_cast<int>(GetNowMs() - countdownStartMs);
-            int number = std::max(1, (remaining + 999) / 1000);
-            RenderCountdown(renderer, renderConfig, number);
-        } else if (state == AppState::Paused) {
-            RenderFrame(renderer, game, static_cast<int>(pausedGameTimeMs), scrollSpeed, renderConfig, false);
-            RenderPauseMenu(renderer, renderConfig, pauseMenuIndex);
-        } else {
-            std::vector<std::string> labels;
-            labels.reserve(chartEntries.size());
-            for (const auto& entry : chartEntries) {
-                labels.push_back(entry.label);
+            // 校准谱面全部判定后计算推荐偏移（练习中跳过的音符不计入判定数，按游标判断）
+            bool allJudged = game.IsFinished();
+            if (calibrating && allJudged) {
+                calibrationResult = ComputeCalibration(game.GetStats().hitError);
+                pauseAudio();
+                state = AppState::CalibrationDone;
+            } else if (allJudged && nowMs > game.GetChartEndMs() + resultsDelayMs) {
+                // 结算画面的绘制缓冲只在这里生成一次
+                resultsView = std::make_shared<ResultsView>(BuildResultsView(game, renderConfig));
+                pauseAudio();
+                state = AppState::Results;
             }
-            RenderMenu(renderer, renderConfig, labels, selectedIndex);
         }
 
-        SDL_RenderPresent(renderer);
+        // 生成本轮快照交给渲染线程（复用槽内容器，不分配内存）
+        {
+            PROFILE_ZONE("Snapshot");
+            FrameSnapshot& frame = renderThread.BeginFrame();
+            frame.config = renderConfig;
+            frame.scrollSpeed = scrollSpeed;
+            frame.advancing = false;
+            frame.capturedAtMs = GetNowMs();
+            frame.showStartOverlay = false;
+            frame.countdownNumber = 0;
+            frame.pauseMenuIndex = -1;
+            if (state == AppState::Playing || state == AppState::Ready || state == AppState::Countdown ||
+                state == AppState::Paused) {
+                frame.screen = FrameScreen::Playfield;
+                if (state == AppState::Playing) {
+                    frame.nowMs = static_cast<int>(getChartTimeMs());
+                    frame.advancing = true;
+                } else if (state == AppState::Ready) {
+                    frame.nowMs = 0;
+                    frame.showStartOverlay = true;
+                } else if (state == AppState::Countdown) {
+                    frame.nowMs = countdownFromPause ? static_cast<int>(pausedGameTimeMs)
+                                                     : static_cast<int>(-globalOffsetMs * game.GetRate());
+                    int remaining = countdownDurationMs - static_cast<int>(GetNowMs() - countdownStartMs);
+                    frame.countdownNumber = std::max(1, (remaining + 999) / 1000);
+                } else {
+                    frame.nowMs = static_cast<int>(pausedGameTimeMs);
+                    frame.pauseMenuIndex = pauseMenuIndex;
+                }
+                BuildPlayfieldView(game, frame.nowMs, scrollSpeed, renderConfig, frame.playfield);
+                if (state == AppState::Playing) {
+                    for (int lane = 0; lane < static_cast<int>(keyMap.size()); ++lane) {
+                        if (keyMap[lane] != SDL_SCANCODE_UNKNOWN && keys[keyMap[lane]]) {
+                            frame.playfield.pressedLanes |= 1u << lane;
+                        }
+                    }
+                }
+            } else if (state == AppState::Editor) {
+                frame.screen = FrameScreen::Editor;
+                BuildEditorView(editor, scrollSpeed, renderConfig, frame.editor);
+                frame.editor.message = editorMessage;
+            } else if (state == AppState::CalibrationDone) {
+                frame.screen = FrameScreen::Calibration;
+                frame.calibration = calibrationResult;
+                frame.globalOffsetMs = globalOffsetMs;
+            } else if (state == AppState::Results) {
+                frame.screen = FrameScreen::Results;
+                frame.results = resultsView;
+            } else {
+                // 滚动位置跟随选中项，保持其在可见范围内
+                int rows = MenuVisibleRows(renderConfig);
+                if (selectedIndex < menuScroll) {
+                    menuScroll = selectedIndex;
+                } else if (selectedIndex >= menuScroll + rows) {
+                    menuScroll = selectedIndex - rows + 1;
+                }
+                menuScroll = std::max(0, std::min(menuScroll, static_cast<int>(menuOrder.size()) - rows));
+                MenuView& menu = frame.menu;
+                frame.screen = FrameScreen::Menu;
+                int lastRow = std::min(static_cast<int>(menuOrder.size()), menuScroll + rows);
+                menu.rows.resize(static_cast<size_t>(std::max(0, lastRow - menuScroll)));
+                for (int row = menuScroll; row < lastRow; ++row) {
+                    menu.rows[row - menuScroll] = menuLabels[menuOrder[row]];
+                }
+                menu.firstRow = menuScroll;
+                menu.selectedIndex = selectedIndex;
+                menu.totalRows = static_cast<int>(menuOrder.size());
+                menu.libraryCount = static_cast<int>(menuLabels.size());
+                menu.query = searchQuery;
+                char footer[128];
+                std::snprintf(footer, sizeof(footer), "JUDGE: %s  OFFSET: %+.0fMS  SORT: %s  STARS: %s",
+                              JudgePresetName(game.GetJudgePreset()), globalOffsetMs,
+                              sortByStars ? "STARS" : "NAME", kMinStarsNames[minStarsIndex]);
+                menu.footer = footer;
+                char status[48] = "";
+                if (playbackRate != 1.0) {
+                    std::snprintf(status, sizeof(status), "RATE %.2fX%s", playbackRate, preservePitch ? "" : " (PITCH SHIFT)");
+                }
+                menu.status = status;
+            }
+            renderThread.Submit();
+        }
 
         const GameStats& stats = game.GetStats();
         char title[256];
         if (state == AppState::Menu) {
-            std::snprintf(title, sizeof(title), "SimpleMania | Select Beatmap");
+            std::snprintf(title, sizeof(title), "SimpleMania | Select Beatmap | Offset %+.0fms", globalOffsetMs);
         } else if (state == AppState::Ready) {
-            std::snprintf(title, sizeof(title), "SimpleMania | Click Play or Press Space");
+            std::snprintf(title, sizeof(title), "SimpleMania | %s [%s] %.2f* %.2fx | Click Play or Press Space",
+                          game.GetChart().title.c_str(), game.GetChart().version.c_str(), difficulty.starRating,
+                          game.GetRate());
         } else if (state == AppState::Paused) {
             std::snprintf(title, sizeof(title), "SimpleMania | Paused");
+        } else if (state == AppState::CalibrationDone) {
+            std::snprintf(title, sizeof(title), "SimpleMania | Calibration");
+        } else if (state == AppState::Editor) {
+            std::snprintf(title, sizeof(title), "SimpleMania | Editing %s%s", editor.GetChart().version.c_str(),
+                          editor.IsDirty() ? " *" : "");
+        } else if (state == AppState::Results) {
+            std::snprintf(title, sizeof(title), "SimpleMania | Results | Score %d | Acc %.2f%%",
+                          game.GetTotalScore(), game.GetAccuracy());
+        } else if (loopEndMs > loopStartMs && loopStartMs >= 0) {
+            std::snprintf(title, sizeof(title), "SimpleMania | Score %d | Combo %d | Loop %.1fs-%.1fs",
+                          game.GetTotalScore(), stats.combo, loopStartMs / 1000.0, loopEndMs / 1000.0);
         } else {
             std::snprintf(title, sizeof(title), "SimpleMania | Score %d | Combo %d | Speed %.2f",
                           game.GetTotalScore(), stats.combo, scrollSpeed);
         }
-        SDL_SetWindowTitle(window, title);
+        // 标题只在内容变化时更新，避免每轮都调用窗口系统
+        if (windowTitle != title) {
+            windowTitle = title;
+            SDL_SetWindowTitle(window, title);
+        }
 
-        // 帧率限制
+        // 输入轮询间隔
         double frameElapsed = GetNowMs() - frameStartMs;
-        if (frameElapsed < targetFrameMs) {
-            SDL_Delay(static_cast<Uint32>(targetFrameMs - frameElapsed));
+        if (frameElapsed < inputPollMs) {
+            PROFILE_ZONE("InputWait");
+            SDL_Delay(1);
         }
 
         // 记录上一帧键盘状态
         std::copy(keys, keys + SDL_NUM_SCANCODES, prevKeys.begin());
     }
 
+    PROFILE_DUMP("simplemania_trace.json");
+
+    audioPlayer.Close();
 #ifdef USE_SDL_MIXER
-    if (music) {
-        Mix_FreeMusic(music);
-    }
     Mix_CloseAudio();
     Mix_Quit();
-#else
-    if (audioDevice != 0) {
-        SDL_CloseAudioDevice(audioDevice);
-    }
-    if (wavBuffer) {
-        SDL_FreeWAV(wavBuffer);
-    }
 #endif
-    SDL_DestroyRenderer(renderer);
+    renderThread.Stop();
     SDL_DestroyWindow(window);
     SDL_Quit();
     return 0;